@@ -0,0 +1,379 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "shell.h"
+#include "sim.h"
+#include "bbv.h"
+#include "fpu.h"
+
+/*
+ * Seleccion de intervalos representativos al estilo SimPoint.
+ *
+ * Durante la ejecucion funcional se cuenta cuantas instrucciones se
+ * ejecutan en cada bloque basico dentro de intervalos de largo fijo. Cada
+ * vector de bloques (normalizado por el largo del intervalo) se proyecta
+ * al vuelo sobre BBV_DIMS dimensiones aleatorias, asi solo se guardan
+ * BBV_DIMS numeros por intervalo. Al pedir el reporte se agrupan los
+ * intervalos con k-means para k = 1..max_k, se elige k con el BIC como
+ * SimPoint y de cada cluster se reporta el intervalo mas cercano al
+ * centroide, con peso igual a la fraccion de instrucciones del cluster.
+ */
+
+#define BBV_DIMS            15
+#define BBV_KMEANS_ITERS    100
+#define BBV_SEED            0x5EEDULL
+
+typedef struct {
+    uint64_t pc;            /* PC + 1 (0 = vacio) */
+    uint32_t id;
+} block_slot_t;
+
+typedef struct {
+    uint64_t start;         /* primera instruccion del intervalo */
+    uint64_t length;
+    double vector[BBV_DIMS];
+} interval_t;
+
+int BBV_ENABLED = FALSE;
+
+static uint64_t INTERVAL_LENGTH;
+
+static block_slot_t *BLOCK_SLOTS;
+static uint64_t BLOCK_SLOTS_CAPACITY;
+static uint32_t NBLOCKS;
+static uint64_t *BLOCK_PCS;         /* id -> PC del bloque */
+
+/* cuentas del intervalo en curso */
+static uint64_t *COUNTS;            /* id -> instrucciones en el intervalo */
+static uint32_t *TOUCHED;           /* ids con cuenta distinta de 0 */
+static uint32_t NTOUCHED;
+static uint64_t COUNTS_CAPACITY;
+static uint64_t INTERVAL_INSTRUCTIONS, TOTAL_INSTRUCTIONS;
+
+static interval_t *INTERVALS;
+static uint64_t NINTERVALS, INTERVALS_CAPACITY;
+
+static int BLOCK_OPEN;
+static uint32_t CURRENT_BLOCK;
+
+
+/* splitmix64: generador determinista para la proyeccion y k-means++ */
+static uint64_t mix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+/* Componente d de la direccion aleatoria del bloque en [-1, 1). */
+static double projection(uint64_t pc, int d) {
+    return (double)(mix64(pc * BBV_DIMS + d) >> 11) / (double)(1ULL << 52) - 1.0;
+}
+
+static uint32_t block_id(uint64_t pc) {
+    uint64_t i = (mix64(pc) & (BLOCK_SLOTS_CAPACITY - 1));
+
+    while (BLOCK_SLOTS[i].pc != 0 && BLOCK_SLOTS[i].pc != pc + 1)
+        i = (i + 1) & (BLOCK_SLOTS_CAPACITY - 1);
+    if (BLOCK_SLOTS[i].pc != 0)
+        return BLOCK_SLOTS[i].id;
+
+    if (NBLOCKS == COUNTS_CAPACITY) {
+        COUNTS_CAPACITY *= 2;
+        COUNTS = realloc(COUNTS, COUNTS_CAPACITY * sizeof(uint64_t));
+        TOUCHED = realloc(TOUCHED, COUNTS_CAPACITY * sizeof(uint32_t));
+        BLOCK_PCS = realloc(BLOCK_PCS, COUNTS_CAPACITY * sizeof(uint64_t));
+    }
+    COUNTS[NBLOCKS] = 0;
+    BLOCK_PCS[NBLOCKS] = pc;
+    BLOCK_SLOTS[i].pc = pc + 1;
+    BLOCK_SLOTS[i].id = NBLOCKS++;
+
+    if (2 * (uint64_t)NBLOCKS > BLOCK_SLOTS_CAPACITY) {
+        block_slot_t *old = BLOCK_SLOTS;
+        uint64_t old_capacity = BLOCK_SLOTS_CAPACITY;
+        BLOCK_SLOTS_CAPACITY *= 2;
+        BLOCK_SLOTS = calloc(BLOCK_SLOTS_CAPACITY, sizeof(block_slot_t));
+        for (uint64_t j = 0; j < old_capacity; j++) {
+            if (old[j].pc == 0) continue;
+            uint64_t k = mix64(old[j].pc - 1) & (BLOCK_SLOTS_CAPACITY - 1);
+            while (BLOCK_SLOTS[k].pc != 0)
+                k = (k + 1) & (BLOCK_SLOTS_CAPACITY - 1);
+            BLOCK_SLOTS[k] = old[j];
+        }
+        free(old);
+    }
+    return NBLOCKS - 1;
+}
+
+/**
+ * Cierra el intervalo en curso: proyecta su vector de bloques
+ * normalizado y reinicia las cuentas.
+ */
+static void close_interval() {
+    interval_t *iv;
+
+    if (INTERVAL_INSTRUCTIONS == 0)
+        return;
+    if (NINTERVALS == INTERVALS_CAPACITY) {
+        INTERVALS_CAPACITY = INTERVALS_CAPACITY ? 2 * INTERVALS_CAPACITY : 64;
+        INTERVALS = realloc(INTERVALS, INTERVALS_CAPACITY * sizeof(interval_t));
+    }
+    iv = &INTERVALS[NINTERVALS++];
+    iv->start = TOTAL_INSTRUCTIONS - INTERVAL_INSTRUCTIONS;
+    iv->length = INTERVAL_INSTRUCTIONS;
+    memset(iv->vector, 0, sizeof(iv->vector));
+
+    for (uint32_t i = 0; i < NTOUCHED; i++) {
+        uint32_t id = TOUCHED[i];
+        double frequency = (double)COUNTS[id] / INTERVAL_INSTRUCTIONS;
+        for (int d = 0; d < BBV_DIMS; d++)
+            iv->vector[d] += frequency * projection(BLOCK_PCS[id], d);
+        COUNTS[id] = 0;
+    }
+    NTOUCHED = 0;
+    INTERVAL_INSTRUCTIONS = 0;
+}
+
+
+/**
+ * Descarta los vectores anteriores y empieza a contar bloques.
+ *
+ * Params: interval_length (uint64_t): Instrucciones por intervalo.
+ */
+void bbv_start(uint64_t interval_length) {
+    free(BLOCK_SLOTS);
+    free(BLOCK_PCS);
+    free(COUNTS);
+    free(TOUCHED);
+    free(INTERVALS);
+
+    INTERVAL_LENGTH = interval_length;
+    BLOCK_SLOTS_CAPACITY = 1024;
+    BLOCK_SLOTS = calloc(BLOCK_SLOTS_CAPACITY, sizeof(block_slot_t));
+    COUNTS_CAPACITY = 256;
+    COUNTS = calloc(COUNTS_CAPACITY, sizeof(uint64_t));
+    TOUCHED = malloc(COUNTS_CAPACITY * sizeof(uint32_t));
+    BLOCK_PCS = malloc(COUNTS_CAPACITY * sizeof(uint64_t));
+    NBLOCKS = NTOUCHED = 0;
+    INTERVALS = NULL;
+    NINTERVALS = INTERVALS_CAPACITY = 0;
+    INTERVAL_INSTRUCTIONS = TOTAL_INSTRUCTIONS = 0;
+    BLOCK_OPEN = FALSE;
+    BBV_ENABLED = TRUE;
+}
+
+
+/**
+ * Deja de contar. El intervalo parcial en curso se conserva.
+ */
+void bbv_stop() {
+    if (BBV_ENABLED)
+        close_interval();
+    BBV_ENABLED = FALSE;
+}
+
+
+/**
+ * Cuenta una instruccion ejecutada en el bloque basico en curso.
+ * Un salto (o HLT) termina el bloque.
+ *
+ * Params: pc (uint64_t): PC de la instruccion ejecutada.
+ *         effects (uint32_t): Efectos EFFECT_* de la instruccion.
+ */
+void bbv_instruction(uint64_t pc, uint32_t effects) {
+    if (!BLOCK_OPEN) {
+        CURRENT_BLOCK = block_id(pc);
+        BLOCK_OPEN = TRUE;
+    }
+    if (COUNTS[CURRENT_BLOCK]++ == 0)
+        TOUCHED[NTOUCHED++] = CURRENT_BLOCK;
+    INTERVAL_INSTRUCTIONS++;
+    TOTAL_INSTRUCTIONS++;
+
+    if ((effects & EFFECT_BRANCH) || RUN_BIT == FALSE)
+        BLOCK_OPEN = FALSE;
+    if (INTERVAL_INSTRUCTIONS == INTERVAL_LENGTH || RUN_BIT == FALSE) {
+        fpu_host_enter();
+        close_interval();
+        fpu_host_leave();
+    }
+}
+
+static double distance2(const double *a, const double *b) {
+    double sum = 0;
+    for (int d = 0; d < BBV_DIMS; d++)
+        sum += (a[d] - b[d]) * (a[d] - b[d]);
+    return sum;
+}
+
+/**
+ * k-means con inicializacion k-means++ determinista.
+ *
+ * Params: k (int): Cantidad de clusters.
+ *         centroids (double *): Salida, k * BBV_DIMS.
+ *         assignment (int *): Salida, cluster de cada intervalo.
+ *
+ * Returns: double: Suma de distancias al cuadrado a los centroides.
+ */
+static double kmeans(int k, double *centroids, int *assignment) {
+    uint64_t n = NINTERVALS, rng = BBV_SEED + k;
+    double *nearest = malloc(n * sizeof(double));
+    uint64_t *sizes = malloc(k * sizeof(uint64_t));
+    double sse = 0;
+
+    memcpy(centroids, INTERVALS[mix64(rng++) % n].vector, sizeof(double) * BBV_DIMS);
+    for (uint64_t i = 0; i < n; i++)
+        nearest[i] = distance2(INTERVALS[i].vector, centroids);
+    for (int c = 1; c < k; c++) {
+        double total = 0, target;
+        uint64_t chosen = n - 1;
+        for (uint64_t i = 0; i < n; i++) total += nearest[i];
+        target = total * ((mix64(rng++) >> 11) / (double)(1ULL << 53));
+        for (uint64_t i = 0; i < n; i++) {
+            if ((target -= nearest[i]) < 0) { chosen = i; break; }
+        }
+        memcpy(centroids + c * BBV_DIMS, INTERVALS[chosen].vector, sizeof(double) * BBV_DIMS);
+        for (uint64_t i = 0; i < n; i++) {
+            double dist = distance2(INTERVALS[i].vector, centroids + c * BBV_DIMS);
+            if (dist < nearest[i]) nearest[i] = dist;
+        }
+    }
+
+    for (uint64_t i = 0; i < n; i++) assignment[i] = -1;
+    for (int iter = 0; iter < BBV_KMEANS_ITERS; iter++) {
+        int changed = FALSE;
+        sse = 0;
+        for (uint64_t i = 0; i < n; i++) {
+            int best = 0;
+            double best_dist = distance2(INTERVALS[i].vector, centroids);
+            for (int c = 1; c < k; c++) {
+                double dist = distance2(INTERVALS[i].vector, centroids + c * BBV_DIMS);
+                if (dist < best_dist) { best = c; best_dist = dist; }
+            }
+            if (assignment[i] != best) { assignment[i] = best; changed = TRUE; }
+            sse += best_dist;
+        }
+        if (!changed) break;
+
+        memset(centroids, 0, k * BBV_DIMS * sizeof(double));
+        memset(sizes, 0, k * sizeof(uint64_t));
+        for (uint64_t i = 0; i < n; i++) {
+            sizes[assignment[i]]++;
+            for (int d = 0; d < BBV_DIMS; d++)
+                centroids[assignment[i] * BBV_DIMS + d] += INTERVALS[i].vector[d];
+        }
+        for (int c = 0; c < k; c++)
+            for (int d = 0; d < BBV_DIMS && sizes[c]; d++)
+                centroids[c * BBV_DIMS + d] /= sizes[c];
+    }
+    free(nearest);
+    free(sizes);
+    return sse;
+}
+
+/**
+ * BIC de un agrupamiento (Pelleg y Moore), como en SimPoint.
+ */
+static double bic(int k, double sse, const int *assignment) {
+    double n = NINTERVALS, variance, log_likelihood = 0;
+    uint64_t *sizes = calloc(k, sizeof(uint64_t));
+
+    for (uint64_t i = 0; i < NINTERVALS; i++) sizes[assignment[i]]++;
+    variance = (n > k) ? sse / (BBV_DIMS * (n - k)) : 0;
+    if (variance <= 0) variance = 1e-12;
+    for (int c = 0; c < k; c++) {
+        double rn = sizes[c];
+        if (rn == 0) continue;
+        log_likelihood += rn * log(rn) - rn * log(n)
+            - rn * BBV_DIMS / 2.0 * log(2 * M_PI * variance)
+            - (rn - k) / 2.0;
+    }
+    free(sizes);
+    return log_likelihood - (k - 1 + BBV_DIMS * k + 1) / 2.0 * log(n);
+}
+
+
+/**
+ * Agrupa los intervalos y reporta los intervalos representativos con
+ * sus pesos.
+ *
+ * Params: out (FILE *): Archivo de salida.
+ *         max_k (int): Cantidad maxima de clusters a probar.
+ */
+void bbv_report(FILE *out, int max_k) {
+    double *centroids, *scores;
+    int **assignments, best_k = 1;
+    double best_score, worst_score;
+
+    fprintf(out, "\nSimPoints (%" PRIu64 " intervals of %" PRIu64 " instructions, %u blocks) :\n",
+            NINTERVALS, INTERVAL_LENGTH, NBLOCKS);
+    fprintf(out, "-------------------------------------\n");
+    if (NINTERVALS == 0) {
+        fprintf(out, "no intervals recorded\n\n");
+        return;
+    }
+    if (max_k > (int)NINTERVALS) max_k = NINTERVALS;
+    if (max_k < 1) max_k = 1;
+
+    centroids = malloc(max_k * BBV_DIMS * sizeof(double));
+    scores = malloc(max_k * sizeof(double));
+    assignments = malloc(max_k * sizeof(int *));
+    for (int k = 1; k <= max_k; k++) {
+        assignments[k - 1] = malloc(NINTERVALS * sizeof(int));
+        double sse = kmeans(k, centroids, assignments[k - 1]);
+        scores[k - 1] = bic(k, sse, assignments[k - 1]);
+    }
+
+    /* el menor k cuyo BIC alcanza el 90% del rango observado */
+    best_score = worst_score = scores[0];
+    for (int k = 1; k < max_k; k++) {
+        if (scores[k] > best_score) best_score = scores[k];
+        if (scores[k] < worst_score) worst_score = scores[k];
+    }
+    for (int k = 1; k <= max_k; k++) {
+        if (scores[k - 1] >= worst_score + 0.9 * (best_score - worst_score)) {
+            best_k = k;
+            break;
+        }
+    }
+
+    /* recalcula los centroides del k elegido a partir de su asignacion */
+    int *assignment = assignments[best_k - 1];
+    uint64_t *sizes = calloc(best_k, sizeof(uint64_t));
+    uint64_t *weights = calloc(best_k, sizeof(uint64_t));
+    memset(centroids, 0, best_k * BBV_DIMS * sizeof(double));
+    for (uint64_t i = 0; i < NINTERVALS; i++) {
+        sizes[assignment[i]]++;
+        weights[assignment[i]] += INTERVALS[i].length;
+        for (int d = 0; d < BBV_DIMS; d++)
+            centroids[assignment[i] * BBV_DIMS + d] += INTERVALS[i].vector[d];
+    }
+
+    fprintf(out, "k = %d (BIC, max_k = %d)\n", best_k, max_k);
+    fprintf(out, "%8s %10s %15s %20s %10s\n", "cluster", "intervals", "representative", "first instruction", "weight");
+    for (int c = 0; c < best_k; c++) {
+        uint64_t representative = 0;
+        double best_dist = -1;
+        if (sizes[c] == 0) continue;
+        for (int d = 0; d < BBV_DIMS; d++)
+            centroids[c * BBV_DIMS + d] /= sizes[c];
+        for (uint64_t i = 0; i < NINTERVALS; i++) {
+            if (assignment[i] != c) continue;
+            double dist = distance2(INTERVALS[i].vector, centroids + c * BBV_DIMS);
+            if (best_dist < 0 || dist < best_dist) { best_dist = dist; representative = i; }
+        }
+        fprintf(out, "%8d %10" PRIu64 " %15" PRIu64 " %20" PRIu64 " %10.6f\n",
+                c, sizes[c], representative, INTERVALS[representative].start,
+                (double)weights[c] / TOTAL_INSTRUCTIONS);
+    }
+    fprintf(out, "\n");
+
+    for (int k = 0; k < max_k; k++) free(assignments[k]);
+    free(assignments);
+    free(centroids);
+    free(scores);
+    free(sizes);
+    free(weights);
+}
@@ -0,0 +1,20 @@
+/***************************************************************/
+/*                                                             */
+/*   Vectores de bloques basicos y seleccion de SimPoints      */
+/*                                                             */
+/***************************************************************/
+
+#ifndef _SIM_BBV_H_
+#define _SIM_BBV_H_
+
+#include <stdio.h>
+#include <inttypes.h>
+
+extern int BBV_ENABLED;
+
+void bbv_start(uint64_t interval_length);
+void bbv_stop();
+void bbv_instruction(uint64_t pc, uint32_t effects);
+void bbv_report(FILE *out, int max_k);
+
+#endif
@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include "shell.h"
+#include "bitops.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+/*
+ * Primitivas de las instrucciones de manipulacion de bits (UBFM/SBFM/BFM,
+ * EXTR, CLZ/CLS, RBIT, REV*).
+ *
+ * Con BMI2 los campos se extraen e insertan con PEXT/PDEP y los
+ * desplazamientos de EXTR usan SHRX/SHLX; con LZCNT la cuenta de ceros
+ * esta definida para 0. Sin esas extensiones (u otro host) se usan
+ * desplazamientos y __builtin_clzll. Los bytes se invierten siempre con
+ * __builtin_bswap64 (BSWAP en x86-64).
+ */
+
+static uint64_t extract_portable(uint64_t value, uint64_t mask) {
+    return mask ? (value & mask) >> __builtin_ctzll(mask) : 0;
+}
+
+static uint64_t deposit_portable(uint64_t value, uint64_t mask) {
+    return mask ? (value << __builtin_ctzll(mask)) & mask : 0;
+}
+
+static uint64_t funnel_portable(uint64_t high, uint64_t low, uint32_t shift) {
+    return shift ? (low >> shift) | (high << (64 - shift)) : low;
+}
+
+static uint32_t clz_portable(uint64_t value) {
+    return value ? __builtin_clzll(value) : 64;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("bmi2")))
+static uint64_t extract_bmi2(uint64_t value, uint64_t mask) {
+    return _pext_u64(value, mask);
+}
+
+__attribute__((target("bmi2")))
+static uint64_t deposit_bmi2(uint64_t value, uint64_t mask) {
+    return _pdep_u64(value, mask);
+}
+
+/* con target("bmi2") el compilador emite SHRX/SHLX para estos desplazamientos */
+__attribute__((target("bmi2")))
+static uint64_t funnel_bmi2(uint64_t high, uint64_t low, uint32_t shift) {
+    return shift ? (low >> shift) | (high << (64 - shift)) : low;
+}
+
+__attribute__((target("lzcnt")))
+static uint32_t clz_lzcnt(uint64_t value) {
+    return _lzcnt_u64(value);
+}
+#endif
+
+/*
+ * Tabla de inmediatos de las instrucciones logicas, armada por el
+ * compilador: un elemento de 2^len bits con s + 1 unos rotados r lugares a
+ * la derecha, repetido hasta 64 bits (DecodeBitMasks del manual de ARM).
+ * len sale de N:NOT(imms); cada fila de 64 entradas (un immr) lista los
+ * imms con su len ya resuelto, asi cada entrada es una expresion chica.
+ */
+#define BM_ONES(n)              ((n) >= 64 ? ~0ULL : (1ULL << ((n) & 63)) - 1)
+#define BM_ROR(x, r, e)         ((r) == 0 ? (x) : (((x) >> (r)) | ((x) << (((e) - (r)) & 63))) & BM_ONES(e))
+#define BM_ELEMENT(e, r, s)     ((s) == (e) - 1 ? 0 : BM_ROR(BM_ONES((s) + 1), r, e) * (~0ULL / BM_ONES(e)))
+#define BM(len, immr, imms)     BM_ELEMENT(1 << (len), (immr) & ((1 << (len)) - 1), (imms) & ((1 << (len)) - 1))
+
+#define BM4(len, r, s)          BM(len, r, s), BM(len, r, (s) + 1), BM(len, r, (s) + 2), BM(len, r, (s) + 3)
+#define BM16(len, r, s)         BM4(len, r, s), BM4(len, r, (s) + 4), BM4(len, r, (s) + 8), BM4(len, r, (s) + 12)
+
+/* N = 0: elementos de 32 bits o menos; imms = 11111x es reservado */
+#define ROW_N0(r)               BM16(5, r, 0), BM16(5, r, 16), BM16(4, r, 32), BM4(3, r, 48), BM4(3, r, 52), \
+                                BM4(2, r, 56), BM(1, r, 60), BM(1, r, 61), 0, 0
+/* N = 1: elementos de 64 bits */
+#define ROW_N1(r)               BM16(6, r, 0), BM16(6, r, 16), BM16(6, r, 32), BM16(6, r, 48)
+
+#define ROWS4(ROW, r)           ROW(r), ROW((r) + 1), ROW((r) + 2), ROW((r) + 3)
+#define ROWS16(ROW, r)          ROWS4(ROW, r), ROWS4(ROW, (r) + 4), ROWS4(ROW, (r) + 8), ROWS4(ROW, (r) + 12)
+#define ROWS64(ROW)             ROWS16(ROW, 0), ROWS16(ROW, 16), ROWS16(ROW, 32), ROWS16(ROW, 48)
+
+const uint64_t BITMASK_IMMEDIATES[1 << 13] = { ROWS64(ROW_N0), ROWS64(ROW_N1) };
+
+
+bitops_t BITOPS = {extract_portable, deposit_portable, funnel_portable, clz_portable, "portable"};
+
+
+/**
+ * Elige las implementaciones segun la CPU del host.
+ */
+void bitops_init() {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("bmi2")) {
+        BITOPS.extract = extract_bmi2;
+        BITOPS.deposit = deposit_bmi2;
+        BITOPS.funnel = funnel_bmi2;
+        BITOPS.name = "bmi2";
+    }
+    if (__builtin_cpu_supports("abm"))
+        BITOPS.clz = clz_lzcnt;
+#endif
+}
+
+
+/**
+ * Invierte el orden de los 64 bits (RBIT): BSWAP y despues se invierten
+ * los bits de cada byte.
+ */
+uint64_t bitops_reverse(uint64_t value) {
+    value = __builtin_bswap64(value);
+    value = ((value >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((value & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    value = ((value >> 2) & 0x3333333333333333ULL) | ((value & 0x3333333333333333ULL) << 2);
+    return ((value >> 1) & 0x5555555555555555ULL) | ((value & 0x5555555555555555ULL) << 1);
+}
+
+
+/**
+ * Intercambia los dos bytes de cada media palabra (REV16).
+ */
+uint64_t bitops_swap_halfwords(uint64_t value) {
+    return ((value >> 8) & 0x00FF00FF00FF00FFULL) | ((value & 0x00FF00FF00FF00FFULL) << 8);
+}
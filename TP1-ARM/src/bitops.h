@@ -0,0 +1,33 @@
+/***************************************************************/
+/*                                                             */
+/*   Operaciones de bits con aceleracion del host              */
+/*                                                             */
+/***************************************************************/
+
+#ifndef _SIM_BITOPS_H_
+#define _SIM_BITOPS_H_
+
+#include <inttypes.h>
+
+/*
+ * Implementacion elegida al iniciar segun la CPU del host. Las mascaras
+ * de extract y deposit son contiguas (campos de UBFM/SBFM/BFM).
+ */
+typedef struct {
+    uint64_t (*extract)(uint64_t value, uint64_t mask);     /* PEXT */
+    uint64_t (*deposit)(uint64_t value, uint64_t mask);     /* PDEP */
+    uint64_t (*funnel)(uint64_t high, uint64_t low, uint32_t shift);
+    uint32_t (*clz)(uint64_t value);                        /* 64 si value == 0 */
+    const char *name;
+} bitops_t;
+
+extern bitops_t BITOPS;
+
+/* Inmediatos de AND/ORR/EOR/ANDS indexados por N:immr:imms (0 = reservado). */
+extern const uint64_t BITMASK_IMMEDIATES[1 << 13];
+
+void     bitops_init();
+uint64_t bitops_reverse(uint64_t value);
+uint64_t bitops_swap_halfwords(uint64_t value);
+
+#endif
@@ -0,0 +1,281 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "shell.h"
+#include "breakpoint.h"
+#include "elfload.h"
+
+/*
+ * Los breakpoints son un bit por palabra del segmento de texto, asi que
+ * revisar el PC cuesta un acceso. Los watchpoints guardan por pagina de
+ * cada region que tipos de acceso vigilan: un acceso a una pagina sin
+ * bits sale enseguida, y solo en las paginas vigiladas se recorre la
+ * lista de rangos.
+ *
+ * Un watchpoint no detiene la instruccion que accede: se anota y go/run
+ * paran despues de ella, como un watchpoint de hardware.
+ */
+
+#define MAX_WATCHPOINTS 64
+#define WATCH_PAGE_SHIFT 12
+
+typedef struct {
+    uint64_t low, high;         /* [low, high] */
+    int mode;
+} watchpoint_t;
+
+int DEBUG_ACTIVE = FALSE;
+int WATCHPOINTS_SET = FALSE;
+
+static uint64_t BREAK_BITS[MEM_TEXT_SIZE / 4 / 64];
+static int NBREAKPOINTS;
+
+static watchpoint_t WATCHPOINTS[MAX_WATCHPOINTS];
+static int NWATCHPOINTS;
+static uint8_t *WATCH_PAGES[MEM_NREGIONS];
+
+/* ultimo acceso vigilado */
+static int WATCH_HIT;
+static int WATCH_HIT_NUMBER, WATCH_HIT_WRITE;
+static uint64_t WATCH_HIT_ADDRESS, WATCH_HIT_PC, WATCH_HIT_COUNT;
+
+
+static void update_flags() {
+    WATCHPOINTS_SET = NWATCHPOINTS > 0;
+    DEBUG_ACTIVE = NBREAKPOINTS > 0 || WATCHPOINTS_SET;
+}
+
+static int breakpoint_at(uint64_t pc) {
+    uint64_t word = (pc - MEM_TEXT_START) >> 2;
+    return pc - MEM_TEXT_START < MEM_TEXT_SIZE &&
+           (BREAK_BITS[word >> 6] >> (word & 63)) & 1;
+}
+
+static void set_break_bit(uint64_t pc, int value) {
+    uint64_t word = (pc - MEM_TEXT_START) >> 2;
+    if (value)
+        BREAK_BITS[word >> 6] |= 1ULL << (word & 63);
+    else
+        BREAK_BITS[word >> 6] &= ~(1ULL << (word & 63));
+}
+
+/* Recalcula los bits por pagina a partir de la lista de watchpoints. */
+static void rebuild_watch_pages() {
+    for (int r = 0; r < MEM_NREGIONS; r++) {
+        uint64_t pages = MEM_REGIONS[r].size >> WATCH_PAGE_SHIFT;
+        if (WATCH_PAGES[r] == NULL)
+            WATCH_PAGES[r] = malloc(pages);
+        memset(WATCH_PAGES[r], 0, pages);
+        for (int w = 0; w < NWATCHPOINTS; w++) {
+            uint64_t start = MEM_REGIONS[r].start, end = start + MEM_REGIONS[r].size - 1;
+            /* un acceso de 32 bits que empieza hasta 3 bytes antes tambien toca el rango */
+            uint64_t low = WATCHPOINTS[w].low < 3 ? 0 : WATCHPOINTS[w].low - 3;
+            uint64_t high = WATCHPOINTS[w].high;
+            if (high < start || low > end) continue;
+            if (low < start) low = start;
+            if (high > end) high = end;
+            for (uint64_t p = (low - start) >> WATCH_PAGE_SHIFT; p <= (high - start) >> WATCH_PAGE_SHIFT; p++)
+                WATCH_PAGES[r][p] |= WATCHPOINTS[w].mode;
+        }
+    }
+}
+
+
+/**
+ * Agrega un breakpoint.
+ *
+ * Params: pc (uint64_t): Direccion de una instruccion del segmento de texto.
+ *
+ * Returns: int: TRUE si se agrego.
+ */
+int breakpoint_add(uint64_t pc) {
+    if (pc - MEM_TEXT_START >= MEM_TEXT_SIZE || (pc & 3)) {
+        printf("Error: 0x%" PRIx64 " is not an instruction address\n", pc);
+        return FALSE;
+    }
+    if (!breakpoint_at(pc)) {
+        set_break_bit(pc, TRUE);
+        NBREAKPOINTS++;
+    }
+    update_flags();
+    return TRUE;
+}
+
+
+/**
+ * Borra un breakpoint.
+ *
+ * Returns: int: TRUE si habia uno en esa direccion.
+ */
+int breakpoint_delete(uint64_t pc) {
+    if (!breakpoint_at(pc)) {
+        printf("Error: no breakpoint at 0x%" PRIx64 "\n", pc);
+        return FALSE;
+    }
+    set_break_bit(pc, FALSE);
+    NBREAKPOINTS--;
+    update_flags();
+    return TRUE;
+}
+
+
+/**
+ * Lista los breakpoints.
+ *
+ * Params: out (FILE *): Archivo de salida.
+ */
+void breakpoint_list(FILE *out) {
+    fprintf(out, "\nBreakpoints (%d) :\n", NBREAKPOINTS);
+    fprintf(out, "-------------------------------------\n");
+    for (uint64_t i = 0; i < sizeof(BREAK_BITS) / sizeof(BREAK_BITS[0]); i++) {
+        for (uint64_t bits = BREAK_BITS[i]; bits; bits &= bits - 1) {
+            uint64_t address = MEM_TEXT_START + ((i * 64 + __builtin_ctzll(bits)) << 2);
+            fprintf(out, "  0x%" PRIx64, address);
+            elf_print_address(out, address);
+            fprintf(out, "\n");
+        }
+    }
+    fprintf(out, "\n");
+}
+
+
+/**
+ * Agrega un watchpoint sobre el rango [low, high].
+ *
+ * Params: mode (int): WATCH_READ, WATCH_WRITE o ambos.
+ *
+ * Returns: int: TRUE si se agrego.
+ */
+int watchpoint_add(uint64_t low, uint64_t high, int mode) {
+    if (NWATCHPOINTS == MAX_WATCHPOINTS) {
+        printf("Error: at most %d watchpoints\n", MAX_WATCHPOINTS);
+        return FALSE;
+    }
+    if (high < low || mode == 0) {
+        printf("Error: invalid watchpoint\n");
+        return FALSE;
+    }
+    WATCHPOINTS[NWATCHPOINTS].low = low;
+    WATCHPOINTS[NWATCHPOINTS].high = high;
+    WATCHPOINTS[NWATCHPOINTS].mode = mode;
+    NWATCHPOINTS++;
+    rebuild_watch_pages();
+    update_flags();
+    return TRUE;
+}
+
+
+/**
+ * Borra el watchpoint numero `number` (segun watchpoint_list).
+ *
+ * Returns: int: TRUE si existia.
+ */
+int watchpoint_delete(int number) {
+    if (number < 0 || number >= NWATCHPOINTS) {
+        printf("Error: no watchpoint %d\n", number);
+        return FALSE;
+    }
+    memmove(&WATCHPOINTS[number], &WATCHPOINTS[number + 1],
+            (NWATCHPOINTS - number - 1) * sizeof(watchpoint_t));
+    NWATCHPOINTS--;
+    rebuild_watch_pages();
+    update_flags();
+    return TRUE;
+}
+
+
+/**
+ * Lista los watchpoints.
+ *
+ * Params: out (FILE *): Archivo de salida.
+ */
+void watchpoint_list(FILE *out) {
+    fprintf(out, "\nWatchpoints (%d) :\n", NWATCHPOINTS);
+    fprintf(out, "-------------------------------------\n");
+    for (int w = 0; w < NWATCHPOINTS; w++)
+        fprintf(out, "  %d: 0x%" PRIx64 "..0x%" PRIx64 " %s%s\n", w,
+                WATCHPOINTS[w].low, WATCHPOINTS[w].high,
+                WATCHPOINTS[w].mode & WATCH_READ ? "r" : "",
+                WATCHPOINTS[w].mode & WATCH_WRITE ? "w" : "");
+    fprintf(out, "\n");
+}
+
+
+/**
+ * Acceso de 32 bits a datos: anota si toca un rango vigilado. Un acceso
+ * de 64 bits llega como dos de 32; se informa el primero que acierta.
+ *
+ * Params: address (uint64_t): Direccion accedida.
+ *         is_write (int): TRUE si es una escritura.
+ */
+void watch_access(uint64_t address, int is_write) {
+    int mode = is_write ? WATCH_WRITE : WATCH_READ;
+
+    if (WATCH_HIT && WATCH_HIT_COUNT == INSTRUCTION_COUNT)
+        return;
+    for (int r = 0; r < MEM_NREGIONS; r++) {
+        uint64_t offset = address - MEM_REGIONS[r].start;
+        if (offset >= MEM_REGIONS[r].size)
+            continue;
+        if (!(WATCH_PAGES[r][offset >> WATCH_PAGE_SHIFT] & mode))
+            return;
+        /* pagina vigilada: camino lento */
+        for (int w = 0; w < NWATCHPOINTS; w++) {
+            if ((WATCHPOINTS[w].mode & mode) && address <= WATCHPOINTS[w].high &&
+                address + 3 >= WATCHPOINTS[w].low) {
+                WATCH_HIT = TRUE;
+                WATCH_HIT_NUMBER = w;
+                WATCH_HIT_WRITE = is_write;
+                WATCH_HIT_ADDRESS = address;
+                WATCH_HIT_PC = CURRENT_STATE.PC;
+                WATCH_HIT_COUNT = INSTRUCTION_COUNT;
+                return;
+            }
+        }
+        return;
+    }
+}
+
+
+/**
+ * Antes de seguir ejecutando: olvida los accesos vigilados anteriores.
+ */
+void debug_resume() {
+    WATCH_HIT = FALSE;
+}
+
+
+/**
+ * Despues de cada instruccion de go/run: decide si hay que parar.
+ *
+ * Returns: int: TRUE si se disparo un watchpoint o el PC tiene un breakpoint.
+ */
+int debug_check() {
+    if (WATCH_HIT) {
+        WATCH_HIT = FALSE;
+        printf("Watchpoint %d: %s 0x%" PRIx64 " at PC 0x%" PRIx64 " (instruction %" PRIu64 ")\n",
+               WATCH_HIT_NUMBER, WATCH_HIT_WRITE ? "write to" : "read from",
+               WATCH_HIT_ADDRESS, WATCH_HIT_PC, WATCH_HIT_COUNT);
+        return TRUE;
+    }
+    if (breakpoint_at(CURRENT_STATE.PC)) {
+        printf("Breakpoint at PC 0x%" PRIx64 " (instruction %" PRIu64 ")\n",
+               CURRENT_STATE.PC, INSTRUCTION_COUNT);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+
+/**
+ * Condicion de parada de reverse-continue: el mismo punto en el que
+ * go/run se habrian detenido. Como la re-ejecucion es determinista, un
+ * acceso anotado para la instruccion anterior es de esta misma linea de
+ * tiempo.
+ *
+ * Returns: int: TRUE si hay que detenerse antes de la instruccion actual.
+ */
+int debug_replay_condition() {
+    return breakpoint_at(CURRENT_STATE.PC) ||
+           (WATCH_HIT && WATCH_HIT_COUNT + 1 == INSTRUCTION_COUNT);
+}
@@ -0,0 +1,30 @@
+/***************************************************************/
+/*                                                             */
+/*   Breakpoints y watchpoints                                 */
+/*                                                             */
+/***************************************************************/
+
+#ifndef _SIM_BREAKPOINT_H_
+#define _SIM_BREAKPOINT_H_
+
+#include <stdio.h>
+#include <inttypes.h>
+
+#define WATCH_READ  1
+#define WATCH_WRITE 2
+
+extern int DEBUG_ACTIVE;        /* hay algun breakpoint o watchpoint */
+extern int WATCHPOINTS_SET;
+
+int  breakpoint_add(uint64_t pc);
+int  breakpoint_delete(uint64_t pc);
+void breakpoint_list(FILE *out);
+int  watchpoint_add(uint64_t low, uint64_t high, int mode);
+int  watchpoint_delete(int number);
+void watchpoint_list(FILE *out);
+void watch_access(uint64_t address, int is_write);
+void debug_resume();
+int  debug_check();
+int  debug_replay_condition();
+
+#endif
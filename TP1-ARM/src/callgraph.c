@@ -0,0 +1,413 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "shell.h"
+#include "timing.h"
+#include "elfload.h"
+#include "callgraph.h"
+
+/*
+ * Perfil por funcion con una pila de llamadas paralela a la del programa.
+ *
+ * Un BL o BLR empuja un marco con la funcion llamada (el destino), el PC
+ * de la llamada y la direccion de retorno; un RET desapila hasta el marco
+ * cuya direccion de retorno es el destino del RET (si no hay ninguno, el
+ * programa salio de la funcion raiz y se empieza otra). Cada instruccion
+ * cuenta como costo propio de la funcion en la cima, por PC, y al cerrar
+ * un marco su costo inclusivo se suma a la llamada (caller, PC, callee) y
+ * a la funcion, salvo en las activaciones recursivas internas.
+ *
+ * Los costos son instrucciones y, si el modelo de tiempos esta midiendo
+ * (sample), sus ciclos. callgraph_dump escribe el formato de callgrind
+ * (positions: instr), que abren kcachegrind o callgrind_annotate.
+ */
+
+#define CALLGRAPH_TOP   20
+
+enum { EVENT_INSTRUCTIONS, EVENT_CYCLES, NEVENTS };
+
+/*
+ * Registro de una de las tres tablas, con clave de tres valores:
+ *  - funciones: (entrada + 1, 0, 0)
+ *  - lineas:    (funcion + 1, PC, 0), costo propio de cada instruccion
+ *  - llamadas:  (caller + 1, PC de la llamada, callee)
+ */
+typedef struct {
+    uint64_t key[3];                /* key[0] = 0: vacio */
+    uint64_t calls;
+    uint64_t cost[NEVENTS];         /* propio (funciones, lineas) o inclusivo (llamadas) */
+    uint64_t inclusive[NEVENTS];    /* funciones */
+    int active;                     /* funciones: activaciones en la pila */
+    int named;                      /* funciones: nombre ya escrito en el dump */
+} record_t;
+
+typedef struct {
+    record_t *records;
+    uint64_t capacity, count;
+} table_t;
+
+typedef struct {
+    uint64_t function;
+    uint64_t site;                  /* PC de la llamada (0 en la raiz) */
+    uint64_t return_address;
+    uint64_t start[NEVENTS];        /* TOTALS al entrar o al ultimo reporte */
+    int outermost;                  /* primera activacion de la funcion */
+} frame_t;
+
+int CALLGRAPH_ENABLED = FALSE;
+
+static table_t FUNCTIONS, LINES, CALLS;
+
+static frame_t *STACK;
+static int DEPTH, STACK_CAPACITY;
+
+static uint64_t TOTALS[NEVENTS];
+static uint64_t LAST_CYCLES;
+
+
+static uint64_t hash_key(const uint64_t key[3], uint64_t capacity) {
+    uint64_t h = key[0] * 0x9E3779B97F4A7C15ULL ^ key[1] * 0xC2B2AE3D27D4EB4FULL ^ key[2];
+    return (h * 0x9E3779B97F4A7C15ULL) >> 32 & (capacity - 1);
+}
+
+static record_t *probe(table_t *t, const uint64_t key[3]) {
+    uint64_t i = hash_key(key, t->capacity);
+    while (t->records[i].key[0] != 0 && memcmp(t->records[i].key, key, sizeof(t->records[i].key)) != 0)
+        i = (i + 1) & (t->capacity - 1);
+    return &t->records[i];
+}
+
+static void table_reset(table_t *t, uint64_t capacity) {
+    free(t->records);
+    t->records = calloc(capacity, sizeof(record_t));
+    t->capacity = capacity;
+    t->count = 0;
+}
+
+static void grow(table_t *t) {
+    record_t *old = t->records;
+    uint64_t old_capacity = t->capacity;
+
+    t->capacity *= 2;
+    t->records = calloc(t->capacity, sizeof(record_t));
+    for (uint64_t i = 0; i < old_capacity; i++)
+        if (old[i].key[0] != 0)
+            *probe(t, old[i].key) = old[i];
+    free(old);
+}
+
+/* Busca un registro y lo crea si no existe. */
+static record_t *find(table_t *t, uint64_t a, uint64_t b, uint64_t c) {
+    uint64_t key[3] = { a, b, c };
+    record_t *r = probe(t, key);
+
+    if (r->key[0] == 0) {
+        memcpy(r->key, key, sizeof(key));
+        if (++t->count * 2 > t->capacity) {
+            grow(t);
+            r = probe(t, key);
+        }
+    }
+    return r;
+}
+
+
+/* Funcion que contiene una direccion: el simbolo anterior, o ella misma. */
+static uint64_t function_containing(uint64_t address) {
+    uint64_t offset;
+    return elf_symbol_name(address, &offset) != NULL ? address - offset : address;
+}
+
+static void push(uint64_t function, uint64_t site, uint64_t return_address) {
+    record_t *f = find(&FUNCTIONS, function + 1, 0, 0);
+    frame_t *frame;
+
+    if (DEPTH == STACK_CAPACITY) {
+        STACK_CAPACITY = STACK_CAPACITY ? 2 * STACK_CAPACITY : 64;
+        STACK = realloc(STACK, STACK_CAPACITY * sizeof(frame_t));
+    }
+    frame = &STACK[DEPTH];
+    frame->function = function;
+    frame->site = site;
+    frame->return_address = return_address;
+    frame->outermost = f->active++ == 0;
+    memcpy(frame->start, TOTALS, sizeof(TOTALS));
+    f->calls++;
+    if (DEPTH > 0)
+        find(&CALLS, STACK[DEPTH - 1].function + 1, site, function)->calls++;
+    DEPTH++;
+}
+
+/* Suma al marco el costo inclusivo desde su inicio y lo vuelve a iniciar. */
+static void account(int depth) {
+    frame_t *frame = &STACK[depth];
+    record_t *f = find(&FUNCTIONS, frame->function + 1, 0, 0);
+    record_t *call = depth > 0 ? find(&CALLS, STACK[depth - 1].function + 1, frame->site, frame->function) : NULL;
+
+    for (int e = 0; e < NEVENTS; e++) {
+        uint64_t delta = TOTALS[e] - frame->start[e];
+        if (frame->outermost)
+            f->inclusive[e] += delta;
+        if (call != NULL)
+            call->cost[e] += delta;
+        frame->start[e] = TOTALS[e];
+    }
+}
+
+static void pop() {
+    account(DEPTH - 1);
+    find(&FUNCTIONS, STACK[DEPTH - 1].function + 1, 0, 0)->active--;
+    DEPTH--;
+}
+
+/* RET a `target`: cierra los marcos hasta el que volvia ahi. */
+static void return_to(uint64_t target) {
+    int depth = DEPTH - 1;
+
+    while (depth > 0 && STACK[depth].return_address != target)
+        depth--;
+    if (depth > 0) {
+        while (DEPTH > depth)
+            pop();
+        return;
+    }
+    /* salida de la raiz (o de una llamada que no se vio): nueva raiz */
+    while (DEPTH > 0)
+        pop();
+    push(function_containing(target), 0, 0);
+}
+
+
+/**
+ * Descarta el perfil anterior y empieza otro, con la funcion del PC
+ * actual como raiz.
+ */
+void callgraph_start() {
+    DEPTH = 0;
+    table_reset(&FUNCTIONS, 256);
+    table_reset(&LINES, 1024);
+    table_reset(&CALLS, 256);
+    memset(TOTALS, 0, sizeof(TOTALS));
+    LAST_CYCLES = timing_cycles();
+    push(function_containing(CURRENT_STATE.PC), 0, 0);
+    CALLGRAPH_ENABLED = TRUE;
+}
+
+
+/**
+ * Deja de perfilar. Los resultados (con los marcos abiertos hasta aca)
+ * se conservan para el reporte.
+ */
+void callgraph_stop() {
+    CALLGRAPH_ENABLED = FALSE;
+}
+
+
+/**
+ * Fin de cada instruccion: cuenta su costo y sigue llamadas y retornos.
+ *
+ * Params: pc (uint64_t): PC de la instruccion ejecutada (CURRENT_STATE
+ *                        ya tiene el siguiente).
+ */
+void callgraph_tick(uint64_t pc) {
+    uint32_t instruction = mem_peek_32(pc);
+    uint64_t cycles = timing_cycles();
+    /* timing_reset vuelve los ciclos a cero */
+    uint64_t elapsed = cycles >= LAST_CYCLES ? cycles - LAST_CYCLES : cycles;
+    record_t *line = find(&LINES, STACK[DEPTH - 1].function + 1, pc, 0);
+
+    LAST_CYCLES = cycles;
+    line->cost[EVENT_CYCLES] += elapsed;
+    TOTALS[EVENT_CYCLES] += elapsed;
+    line->cost[EVENT_INSTRUCTIONS]++;
+    TOTALS[EVENT_INSTRUCTIONS]++;
+
+    if ((instruction & 0xFC000000) == 0x94000000 || (instruction & 0xFFFFFC1F) == 0xD63F0000)
+        push(CURRENT_STATE.PC, pc, pc + 4);                 /* BL, BLR */
+    else if ((instruction & 0xFFFFFC1F) == 0xD65F0000)
+        return_to(CURRENT_STATE.PC);                        /* RET */
+}
+
+
+/*
+ * Cierra el costo de los marcos abiertos (sin desapilarlos) y recalcula
+ * el costo propio de cada funcion desde sus lineas.
+ */
+static void settle() {
+    for (int d = 0; d < DEPTH; d++)
+        account(d);
+    for (uint64_t i = 0; i < FUNCTIONS.capacity; i++)
+        memset(FUNCTIONS.records[i].cost, 0, sizeof(FUNCTIONS.records[i].cost));
+    for (uint64_t i = 0; i < LINES.capacity; i++) {
+        record_t *line = &LINES.records[i];
+        if (line->key[0] == 0) continue;
+        record_t *f = find(&FUNCTIONS, line->key[0], 0, 0);
+        for (int e = 0; e < NEVENTS; e++)
+            f->cost[e] += line->cost[e];
+    }
+}
+
+/* Nombre de una funcion: simbolo, simbolo+offset o la direccion. */
+static void function_name(uint64_t address, char *name, size_t size) {
+    uint64_t offset;
+    const char *symbol = elf_symbol_name(address, &offset);
+
+    if (symbol == NULL)
+        snprintf(name, size, "0x%08" PRIx64, address);
+    else if (offset == 0)
+        snprintf(name, size, "%s", symbol);
+    else
+        snprintf(name, size, "%s+0x%" PRIx64, symbol, offset);
+}
+
+/* Registros ocupados de una tabla, ordenados por clave. */
+static int compare_keys(const void *a, const void *b) {
+    const record_t *x = *(record_t * const *)a, *y = *(record_t * const *)b;
+    for (int k = 0; k < 3; k++)
+        if (x->key[k] != y->key[k])
+            return x->key[k] < y->key[k] ? -1 : 1;
+    return 0;
+}
+
+static int compare_inclusive(const void *a, const void *b) {
+    const record_t *x = *(record_t * const *)a, *y = *(record_t * const *)b;
+    uint64_t p = x->inclusive[EVENT_INSTRUCTIONS], q = y->inclusive[EVENT_INSTRUCTIONS];
+    return (q > p) - (q < p);
+}
+
+static record_t **sorted_records(table_t *t, int (*compare)(const void *, const void *)) {
+    record_t **sorted = malloc((t->count + 1) * sizeof(record_t *));
+    uint64_t n = 0;
+
+    for (uint64_t i = 0; i < t->capacity; i++)
+        if (t->records[i].key[0] != 0)
+            sorted[n++] = &t->records[i];
+    qsort(sorted, n, sizeof(record_t *), compare);
+    return sorted;
+}
+
+
+/**
+ * Imprime las funciones con mas instrucciones inclusivas.
+ *
+ * Params: out (FILE *): Archivo de salida.
+ */
+void callgraph_report(FILE *out) {
+    record_t **sorted;
+    int cycles;
+    char name[64];
+
+    fprintf(out, "\nCall graph :\n");
+    fprintf(out, "-------------------------------------\n");
+    if (FUNCTIONS.records == NULL || TOTALS[EVENT_INSTRUCTIONS] == 0) {
+        fprintf(out, "no instructions profiled\n\n");
+        return;
+    }
+    settle();
+    cycles = TOTALS[EVENT_CYCLES] != 0;
+    fprintf(out, "Instructions      : %" PRIu64 "\n", TOTALS[EVENT_INSTRUCTIONS]);
+    if (cycles)
+        fprintf(out, "Modeled cycles    : %" PRIu64 "\n", TOTALS[EVENT_CYCLES]);
+    fprintf(out, "Functions         : %" PRIu64 "\n", FUNCTIONS.count);
+    fprintf(out, "Call depth        : %d\n\n", DEPTH);
+
+    fprintf(out, "%-28s %10s %12s %12s %7s", "function", "calls", "self insts", "incl insts", "incl %");
+    if (cycles)
+        fprintf(out, " %12s %12s", "self cycles", "incl cycles");
+    fprintf(out, "\n");
+    sorted = sorted_records(&FUNCTIONS, compare_inclusive);
+    for (uint64_t i = 0; i < FUNCTIONS.count && i < CALLGRAPH_TOP; i++) {
+        record_t *f = sorted[i];
+        function_name(f->key[0] - 1, name, sizeof(name));
+        fprintf(out, "%-28s %10" PRIu64 " %12" PRIu64 " %12" PRIu64 " %6.1f%%", name, f->calls,
+                f->cost[EVENT_INSTRUCTIONS], f->inclusive[EVENT_INSTRUCTIONS],
+                100.0 * f->inclusive[EVENT_INSTRUCTIONS] / TOTALS[EVENT_INSTRUCTIONS]);
+        if (cycles)
+            fprintf(out, " %12" PRIu64 " %12" PRIu64, f->cost[EVENT_CYCLES], f->inclusive[EVENT_CYCLES]);
+        fprintf(out, "\n");
+    }
+    fprintf(out, "\n");
+    free(sorted);
+}
+
+
+/* Costos de una linea del formato callgrind. */
+static void print_costs(FILE *out, const uint64_t cost[NEVENTS], int cycles) {
+    fprintf(out, " %" PRIu64, cost[EVENT_INSTRUCTIONS]);
+    if (cycles)
+        fprintf(out, " %" PRIu64, cost[EVENT_CYCLES]);
+    fprintf(out, "\n");
+}
+
+/* fn=/cfn= con compresion de nombres: el nombre solo la primera vez. */
+static void print_function(FILE *out, const char *field, uint64_t address) {
+    record_t *f = find(&FUNCTIONS, address + 1, 0, 0);
+    uint64_t id = f - FUNCTIONS.records + 1;
+    char name[128];
+
+    if (f->named) {
+        fprintf(out, "%s=(%" PRIu64 ")\n", field, id);
+        return;
+    }
+    function_name(address, name, sizeof(name));
+    fprintf(out, "%s=(%" PRIu64 ") %s\n", field, id, name);
+    f->named = TRUE;
+}
+
+
+/**
+ * Escribe el perfil en formato callgrind: por funcion, el costo propio de
+ * cada instruccion y el inclusivo de cada llamada que hace.
+ *
+ * Params: path (const char *): Archivo de salida.
+ *
+ * Returns: int: TRUE si se pudo escribir.
+ */
+int callgraph_dump(const char *path) {
+    record_t **lines, **calls;
+    uint64_t l = 0, c = 0;
+    int cycles;
+    FILE *out;
+
+    if (FUNCTIONS.records == NULL)
+        return FALSE;
+    out = fopen(path, "w");
+    if (out == NULL)
+        return FALSE;
+    settle();
+    cycles = TOTALS[EVENT_CYCLES] != 0;
+    for (uint64_t i = 0; i < FUNCTIONS.capacity; i++)
+        FUNCTIONS.records[i].named = FALSE;
+
+    fprintf(out, "# callgrind format\n");
+    fprintf(out, "version: 1\n");
+    fprintf(out, "creator: arm-sim\n");
+    fprintf(out, "positions: instr\n");
+    fprintf(out, "events: Ir%s\n", cycles ? " Cycles" : "");
+    fprintf(out, "summary:");
+    print_costs(out, TOTALS, cycles);
+
+    /* lineas y llamadas de cada funcion, en orden de funcion y PC */
+    lines = sorted_records(&LINES, compare_keys);
+    calls = sorted_records(&CALLS, compare_keys);
+    while (l < LINES.count || c < CALLS.count) {
+        uint64_t function = (c == CALLS.count || (l < LINES.count && lines[l]->key[0] <= calls[c]->key[0]))
+                            ? lines[l]->key[0] : calls[c]->key[0];
+
+        fprintf(out, "\n");
+        print_function(out, "fn", function - 1);
+        for (; l < LINES.count && lines[l]->key[0] == function; l++) {
+            fprintf(out, "0x%" PRIx64, lines[l]->key[1]);
+            print_costs(out, lines[l]->cost, cycles);
+        }
+        for (; c < CALLS.count && calls[c]->key[0] == function; c++) {
+            print_function(out, "cfn", calls[c]->key[2]);
+            fprintf(out, "calls=%" PRIu64 " 0x%" PRIx64 "\n", calls[c]->calls, calls[c]->key[2]);
+            fprintf(out, "0x%" PRIx64, calls[c]->key[1]);
+            print_costs(out, calls[c]->cost, cycles);
+        }
+    }
+    free(lines);
+    free(calls);
+    return fclose(out) == 0;
+}
@@ -0,0 +1,21 @@
+/***************************************************************/
+/*                                                             */
+/*   Perfil por funcion del programa simulado (call graph)     */
+/*                                                             */
+/***************************************************************/
+
+#ifndef _SIM_CALLGRAPH_H_
+#define _SIM_CALLGRAPH_H_
+
+#include <stdio.h>
+#include <inttypes.h>
+
+extern int CALLGRAPH_ENABLED;
+
+void callgraph_start();
+void callgraph_stop();
+void callgraph_tick(uint64_t pc);
+void callgraph_report(FILE *out);
+int  callgraph_dump(const char *path);
+
+#endif
@@ -0,0 +1,204 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "shell.h"
+#include "sim.h"
+#include "checkpoint.h"
+#include "dirty.h"
+#include "syscalls.h"
+
+/*
+ * Formato del archivo:
+ *
+ *   [0, CHECKPOINT_ALIGN)   cabecera: estado de la CPU, contador de
+ *                           instrucciones y ubicacion de cada region
+ *   [offset, offset + len)  imagen de cada region de MEM_REGIONS, con
+ *                           offset alineado a CHECKPOINT_ALIGN
+ *
+ * Solo se escriben las paginas con algun byte distinto de cero; el resto
+ * queda como hueco del archivo. La alineacion (64KB) es multiplo del
+ * tamano de pagina de cualquier host, asi que al restaurar cada region se
+ * mapea directamente con MAP_PRIVATE: no se copia ni se parsea nada, y las
+ * escrituras posteriores no modifican el archivo.
+ */
+
+#define CHECKPOINT_MAGIC    "ARMCKPT"
+#define CHECKPOINT_VERSION  4
+#define CHECKPOINT_ALIGN    0x10000
+#define CHECKPOINT_PAGE     4096
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t state_size;            /* sizeof(CPU_State) del que guardo */
+    uint32_t nregions;
+    int32_t run_bit;
+    uint64_t instruction_count;
+    struct {
+        uint64_t start, size;
+        uint64_t offset, length;
+    } regions[MEM_NREGIONS];
+    CPU_State state;
+    syscall_state_t os;
+} checkpoint_header_t;
+
+/* las regiones restauradas estan mapeadas, no en el heap */
+static int MAPPED[MEM_NREGIONS];
+
+
+static uint64_t align_up(uint64_t value) {
+    return (value + CHECKPOINT_ALIGN - 1) & ~(uint64_t)(CHECKPOINT_ALIGN - 1);
+}
+
+/* Largo de la imagen de una region: como init_memory, 3 bytes de mas. */
+static uint64_t region_length(uint64_t size) {
+    return align_up(size + 3);
+}
+
+static int page_is_zero(const uint8_t *page, uint64_t length) {
+    static const uint8_t ZERO[CHECKPOINT_PAGE];
+    return memcmp(page, ZERO, length) == 0;
+}
+
+
+/**
+ * Guarda el estado de la maquina. Se escribe en un temporal y se
+ * renombra, asi un checkpoint existente nunca queda a medio escribir.
+ *
+ * Params: path (const char *): Archivo de destino.
+ *
+ * Returns: int: TRUE si se guardo.
+ */
+int checkpoint_save(const char *path) {
+    checkpoint_header_t header;
+    char temporary[512];
+    uint64_t offset = CHECKPOINT_ALIGN, pages = 0;
+    int fd;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.state_size = sizeof(CPU_State);
+    header.nregions = MEM_NREGIONS;
+    header.run_bit = RUN_BIT;
+    header.instruction_count = INSTRUCTION_COUNT;
+    header.state = CURRENT_STATE;
+    header.os = SYSCALL_STATE;
+    for (int i = 0; i < MEM_NREGIONS; i++) {
+        header.regions[i].start = MEM_REGIONS[i].start;
+        header.regions[i].size = MEM_REGIONS[i].size;
+        header.regions[i].offset = offset;
+        header.regions[i].length = region_length(MEM_REGIONS[i].size);
+        offset += header.regions[i].length;
+    }
+
+    snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+    fd = open(temporary, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    if (fd < 0) {
+        perror(temporary);
+        return FALSE;
+    }
+    if (pwrite(fd, &header, sizeof(header), 0) != sizeof(header) ||
+        ftruncate(fd, offset) != 0)
+        goto fail;
+
+    for (int i = 0; i < MEM_NREGIONS; i++) {
+        for (uint64_t p = 0; p < MEM_REGIONS[i].size; p += CHECKPOINT_PAGE) {
+            const uint8_t *page = MEM_REGIONS[i].mem + p;
+            uint64_t length = MEM_REGIONS[i].size - p < CHECKPOINT_PAGE ?
+                              MEM_REGIONS[i].size - p : CHECKPOINT_PAGE;
+            if (page_is_zero(page, length))
+                continue;
+            if (pwrite(fd, page, length, header.regions[i].offset + p) != (ssize_t)length)
+                goto fail;
+            pages++;
+        }
+    }
+    if (close(fd) != 0 || rename(temporary, path) != 0) {
+        perror(path);
+        unlink(temporary);
+        return FALSE;
+    }
+    printf("Checkpoint saved to %s (%" PRIu64 " pages, instruction %" PRIu64 ")\n",
+           path, pages, INSTRUCTION_COUNT);
+    return TRUE;
+
+fail:
+    perror(temporary);
+    close(fd);
+    unlink(temporary);
+    return FALSE;
+}
+
+
+/**
+ * Restaura un checkpoint mapeando sus regiones copy-on-write.
+ *
+ * Params: path (const char *): Archivo guardado con checkpoint_save.
+ *
+ * Returns: int: TRUE si se restauro. Si falla, el estado no cambia.
+ */
+int checkpoint_restore(const char *path) {
+    checkpoint_header_t header;
+    uint8_t *mem[MEM_NREGIONS];
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) {
+        perror(path);
+        return FALSE;
+    }
+    if (pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+        memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != CHECKPOINT_VERSION) {
+        printf("Error: %s is not a checkpoint\n", path);
+        close(fd);
+        return FALSE;
+    }
+    if (header.state_size != sizeof(CPU_State) || header.nregions != MEM_NREGIONS) {
+        printf("Error: %s was saved by an incompatible simulator\n", path);
+        close(fd);
+        return FALSE;
+    }
+    for (int i = 0; i < MEM_NREGIONS; i++) {
+        if (header.regions[i].start != MEM_REGIONS[i].start ||
+            header.regions[i].size != MEM_REGIONS[i].size) {
+            printf("Error: %s has a different memory layout\n", path);
+            close(fd);
+            return FALSE;
+        }
+    }
+
+    for (int i = 0; i < MEM_NREGIONS; i++) {
+        mem[i] = mmap(NULL, header.regions[i].length, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE, fd, header.regions[i].offset);
+        if (mem[i] == MAP_FAILED) {
+            perror(path);
+            while (i-- > 0)
+                munmap(mem[i], header.regions[i].length);
+            close(fd);
+            return FALSE;
+        }
+    }
+    close(fd);
+
+    for (int i = 0; i < MEM_NREGIONS; i++) {
+        if (MAPPED[i])
+            munmap(MEM_REGIONS[i].mem, region_length(MEM_REGIONS[i].size));
+        else
+            free(MEM_REGIONS[i].mem);
+        MEM_REGIONS[i].mem = mem[i];
+        MAPPED[i] = TRUE;
+    }
+    CURRENT_STATE = NEXT_STATE = header.state;
+    SYSCALL_STATE = header.os;
+    INSTRUCTION_COUNT = header.instruction_count;
+    RUN_BIT = header.run_bit;
+    predecode_reset();
+    dirty_touch_all();
+
+    printf("Checkpoint %s restored (instruction %" PRIu64 ")\n", path, INSTRUCTION_COUNT);
+    return TRUE;
+}
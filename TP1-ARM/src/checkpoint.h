@@ -0,0 +1,13 @@
+/***************************************************************/
+/*                                                             */
+/*   Checkpoints del estado completo de la maquina             */
+/*                                                             */
+/***************************************************************/
+
+#ifndef _SIM_CHECKPOINT_H_
+#define _SIM_CHECKPOINT_H_
+
+int checkpoint_save(const char *path);
+int checkpoint_restore(const char *path);
+
+#endif
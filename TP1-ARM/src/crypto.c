@@ -0,0 +1,358 @@
+#include <stdio.h>
+#include <string.h>
+#include "shell.h"
+#include "crypto.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+/*
+ * Instrucciones CRC32/CRC32C, AES y SHA1/SHA256 de ARMv8.
+ *
+ * Con SSE4.2 el CRC32C usa la instruccion CRC32 del host; con AES-NI las
+ * cuatro operaciones AES salen de AESENCLAST/AESDECLAST/AESENC/AESIMC; con
+ * SHA-NI las rondas de SHA1 usan SHA1RNDS4 y las de SHA256 dos
+ * SHA256RNDS2 (mas SHA256MSG1/MSG2 para el calculo del mensaje). Sin esas
+ * extensiones se usan tablas (CRC, S-box) y el pseudocodigo del manual.
+ *
+ * El CRC32 (polinomio IEEE) no tiene instruccion en x86, y los ajustes de
+ * SHA1 (SHA1H, SHA1SU0, SHA1SU1) son un par de XOR y rotaciones, asi que
+ * esos siempre son portables.
+ */
+
+#define CRC32_POLY      0xEDB88320U     /* 0x04C11DB7 reflejado */
+#define CRC32C_POLY     0x82F63B78U     /* 0x1EDC6F41 reflejado */
+
+static uint32_t CRC32_TABLE[256], CRC32C_TABLE[256];
+static uint8_t SBOX[256], INV_SBOX[256];
+
+static const uint32_t SHA1_K[3] = { 0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC };
+
+
+static uint32_t rol32(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+static uint32_t ror32(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+static uint8_t xtime(uint8_t b) {
+    return (b << 1) ^ ((b >> 7) * 0x1B);
+}
+
+static uint8_t gf_mul(uint8_t a, uint8_t b) {
+    uint8_t p = 0;
+
+    for (; b; b >>= 1, a = xtime(a))
+        if (b & 1)
+            p ^= a;
+    return p;
+}
+
+static void build_tables() {
+    uint8_t p = 1, q = 1;
+
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t a = i, c = i;
+        for (int k = 0; k < 8; k++) {
+            a = (a >> 1) ^ ((a & 1) ? CRC32_POLY : 0);
+            c = (c >> 1) ^ ((c & 1) ? CRC32C_POLY : 0);
+        }
+        CRC32_TABLE[i] = a;
+        CRC32C_TABLE[i] = c;
+    }
+
+    /* S-box: inverso multiplicativo en GF(2^8) y transformacion afin */
+    do {
+        p = p ^ (p << 1) ^ ((p & 0x80) ? 0x1B : 0);
+        q ^= q << 1;
+        q ^= q << 2;
+        q ^= q << 4;
+        if (q & 0x80)
+            q ^= 0x09;
+        uint8_t x = q ^ (uint8_t)((q << 1) | (q >> 7)) ^ (uint8_t)((q << 2) | (q >> 6)) ^
+                    (uint8_t)((q << 3) | (q >> 5)) ^ (uint8_t)((q << 4) | (q >> 4));
+        SBOX[p] = x ^ 0x63;
+    } while (p != 1);
+    SBOX[0] = 0x63;
+    for (int i = 0; i < 256; i++)
+        INV_SBOX[SBOX[i]] = i;
+}
+
+static uint32_t crc_table(const uint32_t *table, uint32_t crc, uint64_t data, int bytes) {
+    for (int i = 0; i < bytes; i++, data >>= 8)
+        crc = table[(crc ^ data) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+
+/* ---- implementaciones portables ---- */
+
+static uint32_t crc32c_portable(uint32_t crc, uint64_t data, int bytes) {
+    return crc_table(CRC32C_TABLE, crc, data, bytes);
+}
+
+static vreg_t aes_portable(int op, vreg_t d, vreg_t n) {
+    vreg_t in, out;
+
+    if (op == CRYPTO_AESE || op == CRYPTO_AESD) {
+        for (int i = 0; i < 2; i++)
+            in.d[i] = d.d[i] ^ n.d[i];
+        /* el estado es una matriz de 4x4 por columnas: byte r + 4c */
+        for (int r = 0; r < 4; r++)
+            for (int c = 0; c < 4; c++) {
+                if (op == CRYPTO_AESE)
+                    out.b[r + 4 * c] = SBOX[in.b[r + 4 * ((c + r) & 3)]];
+                else
+                    out.b[r + 4 * ((c + r) & 3)] = INV_SBOX[in.b[r + 4 * c]];
+            }
+        return out;
+    }
+
+    for (int c = 0; c < 4; c++) {
+        uint8_t *a = &n.b[4 * c], *b = &out.b[4 * c];
+        if (op == CRYPTO_AESMC) {
+            b[0] = xtime(a[0]) ^ xtime(a[1]) ^ a[1] ^ a[2] ^ a[3];
+            b[1] = a[0] ^ xtime(a[1]) ^ xtime(a[2]) ^ a[2] ^ a[3];
+            b[2] = a[0] ^ a[1] ^ xtime(a[2]) ^ xtime(a[3]) ^ a[3];
+            b[3] = xtime(a[0]) ^ a[0] ^ a[1] ^ a[2] ^ xtime(a[3]);
+        } else {
+            for (int r = 0; r < 4; r++)
+                b[r] = gf_mul(a[r], 14) ^ gf_mul(a[(r + 1) & 3], 11) ^
+                       gf_mul(a[(r + 2) & 3], 13) ^ gf_mul(a[(r + 3) & 3], 9);
+        }
+    }
+    return out;
+}
+
+static vreg_t sha1_rounds_portable(int op, vreg_t x, uint32_t y, vreg_t w) {
+    for (int e = 0; e < 4; e++) {
+        uint32_t b = x.s[1], c = x.s[2], d = x.s[3], t;
+        if (op == CRYPTO_SHA1C)
+            t = (b & c) | (~b & d);
+        else if (op == CRYPTO_SHA1P)
+            t = b ^ c ^ d;
+        else
+            t = (b & c) | (b & d) | (c & d);
+        y = y + rol32(x.s[0], 5) + t + w.s[e];
+        x.s[1] = rol32(x.s[1], 30);
+        /* <Y, X> = ROL(Y:X, 32) */
+        t = x.s[3];
+        x.s[3] = x.s[2];
+        x.s[2] = x.s[1];
+        x.s[1] = x.s[0];
+        x.s[0] = y;
+        y = t;
+    }
+    return x;
+}
+
+static vreg_t sha256_rounds_portable(vreg_t x, vreg_t y, vreg_t w, int part1) {
+    for (int e = 0; e < 4; e++) {
+        uint32_t chs = (y.s[0] & y.s[1]) | (~y.s[0] & y.s[2]);
+        uint32_t maj = (x.s[0] & x.s[1]) | (x.s[0] & x.s[2]) | (x.s[1] & x.s[2]);
+        uint32_t t1 = y.s[3] + (ror32(y.s[0], 6) ^ ror32(y.s[0], 11) ^ ror32(y.s[0], 25)) + chs + w.s[e];
+        uint32_t top;
+
+        x.s[3] += t1;
+        y.s[3] = t1 + (ror32(x.s[0], 2) ^ ror32(x.s[0], 13) ^ ror32(x.s[0], 22)) + maj;
+        /* <Y, X> = ROL(Y:X, 32) */
+        top = y.s[3];
+        y.s[3] = y.s[2];
+        y.s[2] = y.s[1];
+        y.s[1] = y.s[0];
+        y.s[0] = x.s[3];
+        x.s[3] = x.s[2];
+        x.s[2] = x.s[1];
+        x.s[1] = x.s[0];
+        x.s[0] = top;
+    }
+    return part1 ? x : y;
+}
+
+static vreg_t sha256_schedule0_portable(vreg_t d, vreg_t n) {
+    uint32_t t[4] = { d.s[1], d.s[2], d.s[3], n.s[0] };
+
+    for (int e = 0; e < 4; e++)
+        d.s[e] += ror32(t[e], 7) ^ ror32(t[e], 18) ^ (t[e] >> 3);
+    return d;
+}
+
+static vreg_t sha256_schedule1_portable(vreg_t d, vreg_t n, vreg_t m) {
+    uint32_t t0[4] = { n.s[1], n.s[2], n.s[3], m.s[0] };
+    vreg_t result;
+
+    for (int e = 0; e < 4; e++) {
+        uint32_t t = e < 2 ? m.s[e + 2] : result.s[e - 2];
+        result.s[e] = (ror32(t, 17) ^ ror32(t, 19) ^ (t >> 10)) + d.s[e] + t0[e];
+    }
+    return result;
+}
+
+
+/* ---- implementaciones con extensiones del host ---- */
+
+#if defined(__x86_64__)
+static __m128i to_host(vreg_t v) {
+    return _mm_loadu_si128((const __m128i *)&v);
+}
+
+static vreg_t from_host(__m128i x) {
+    vreg_t v;
+    _mm_storeu_si128((__m128i *)&v, x);
+    return v;
+}
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, uint64_t data, int bytes) {
+    switch (bytes) {
+    case 1: return _mm_crc32_u8(crc, data);
+    case 2: return _mm_crc32_u16(crc, data);
+    case 4: return _mm_crc32_u32(crc, data);
+    default: return _mm_crc32_u64(crc, data);
+    }
+}
+
+__attribute__((target("aes")))
+static vreg_t aes_ni(int op, vreg_t d, vreg_t n) {
+    __m128i zero = _mm_setzero_si128(), x = to_host(n);
+
+    switch (op) {
+    case CRYPTO_AESE:
+        return from_host(_mm_aesenclast_si128(_mm_xor_si128(to_host(d), x), zero));
+    case CRYPTO_AESD:
+        return from_host(_mm_aesdeclast_si128(_mm_xor_si128(to_host(d), x), zero));
+    case CRYPTO_AESMC:
+        /* AESENC hace ShiftRows, SubBytes y MixColumns: se deshacen los dos primeros */
+        return from_host(_mm_aesenc_si128(_mm_aesdeclast_si128(x, zero), zero));
+    default:
+        return from_host(_mm_aesimc_si128(x));
+    }
+}
+
+/*
+ * SHA1RNDS4 guarda A en el elemento mas alto y suma la constante de la
+ * ronda, que en ARM ya viene sumada en W: se invierte el orden de los
+ * elementos y se resta K.
+ */
+__attribute__((target("sha,sse4.1")))
+static vreg_t sha1_rounds_ni(int op, vreg_t x, uint32_t e, vreg_t w) {
+    __m128i abcd = _mm_shuffle_epi32(to_host(x), 0x1B);
+    __m128i wk = _mm_sub_epi32(to_host(w), _mm_set1_epi32(SHA1_K[op]));
+
+    wk = _mm_shuffle_epi32(_mm_add_epi32(wk, _mm_cvtsi32_si128(e)), 0x1B);
+    switch (op) {
+    case CRYPTO_SHA1C: abcd = _mm_sha1rnds4_epu32(abcd, wk, 0); break;
+    case CRYPTO_SHA1P: abcd = _mm_sha1rnds4_epu32(abcd, wk, 1); break;
+    default: abcd = _mm_sha1rnds4_epu32(abcd, wk, 2); break;
+    }
+    return from_host(_mm_shuffle_epi32(abcd, 0x1B));
+}
+
+/*
+ * SHA256RNDS2 trabaja con el estado repartido en (A,B,E,F) y (C,D,G,H);
+ * despues de dos rondas el segundo es el primero anterior. ARM separa
+ * (A,B,C,D) y (E,F,G,H), asi que se reparten antes y despues.
+ */
+__attribute__((target("sha,sse4.1")))
+static vreg_t sha256_rounds_ni(vreg_t x, vreg_t y, vreg_t w, int part1) {
+    __m128i abef = _mm_set_epi32(x.s[0], x.s[1], y.s[0], y.s[1]);
+    __m128i cdgh = _mm_set_epi32(x.s[2], x.s[3], y.s[2], y.s[3]);
+    __m128i wk = to_host(w);
+    vreg_t first, second, result;
+
+    cdgh = _mm_sha256rnds2_epu32(cdgh, abef, wk);
+    abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(wk, 0x0E));
+    first = from_host(abef);
+    second = from_host(cdgh);
+    if (part1) {
+        result.s[0] = first.s[3];
+        result.s[1] = first.s[2];
+        result.s[2] = second.s[3];
+        result.s[3] = second.s[2];
+    } else {
+        result.s[0] = first.s[1];
+        result.s[1] = first.s[0];
+        result.s[2] = second.s[1];
+        result.s[3] = second.s[0];
+    }
+    return result;
+}
+
+__attribute__((target("sha,sse4.1")))
+static vreg_t sha256_schedule0_ni(vreg_t d, vreg_t n) {
+    return from_host(_mm_sha256msg1_epu32(to_host(d), to_host(n)));
+}
+
+__attribute__((target("sha,sse4.1")))
+static vreg_t sha256_schedule1_ni(vreg_t d, vreg_t n, vreg_t m) {
+    __m128i t0 = _mm_alignr_epi8(to_host(m), to_host(n), 4);
+    return from_host(_mm_sha256msg2_epu32(_mm_add_epi32(to_host(d), t0), to_host(m)));
+}
+#endif
+
+crypto_t CRYPTO = {crc32c_portable, aes_portable, sha1_rounds_portable, sha256_rounds_portable,
+                   sha256_schedule0_portable, sha256_schedule1_portable, "portable"};
+
+
+/**
+ * Arma las tablas y elige las implementaciones segun la CPU del host.
+ */
+void crypto_init() {
+    build_tables();
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2"))
+        CRYPTO.crc32c = crc32c_sse42;
+    if (__builtin_cpu_supports("aes"))
+        CRYPTO.aes = aes_ni;
+    if (__builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1")) {
+        CRYPTO.sha1_rounds = sha1_rounds_ni;
+        CRYPTO.sha256_rounds = sha256_rounds_ni;
+        CRYPTO.sha256_schedule0 = sha256_schedule0_ni;
+        CRYPTO.sha256_schedule1 = sha256_schedule1_ni;
+    }
+    CRYPTO.name = "host";
+#endif
+}
+
+
+/**
+ * CRC32 (polinomio IEEE 802.3) de los bytes bajos de data, sin las
+ * inversiones inicial y final, como la instruccion CRC32B/H/W/X.
+ *
+ * Params: crc (uint32_t): Acumulador.
+ *         data (uint64_t): Datos, en orden little-endian.
+ *         bytes (int): 1, 2, 4 u 8.
+ */
+uint32_t crypto_crc32(uint32_t crc, uint64_t data, int bytes) {
+    return crc_table(CRC32_TABLE, crc, data, bytes);
+}
+
+
+/**
+ * SHA1SU0: primera parte del calculo del mensaje de SHA1.
+ */
+vreg_t crypto_sha1_schedule0(vreg_t d, vreg_t n, vreg_t m) {
+    vreg_t result;
+
+    result.d[0] = d.d[1] ^ d.d[0] ^ m.d[0];
+    result.d[1] = n.d[0] ^ d.d[1] ^ m.d[1];
+    return result;
+}
+
+
+/**
+ * SHA1SU1: segunda parte del calculo del mensaje de SHA1.
+ */
+vreg_t crypto_sha1_schedule1(vreg_t d, vreg_t n) {
+    uint32_t t[4] = { d.s[0] ^ n.s[1], d.s[1] ^ n.s[2], d.s[2] ^ n.s[3], d.s[3] };
+    vreg_t result;
+
+    for (int e = 0; e < 4; e++)
+        result.s[e] = rol32(t[e], 1);
+    result.s[3] ^= rol32(t[0], 2);
+    return result;
+}
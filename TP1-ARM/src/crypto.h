@@ -0,0 +1,38 @@
+/***************************************************************/
+/*                                                             */
+/*   Extensiones CRC32 y criptograficas (AES, SHA1, SHA256)    */
+/*                                                             */
+/***************************************************************/
+
+#ifndef _SIM_CRYPTO_H_
+#define _SIM_CRYPTO_H_
+
+#include <inttypes.h>
+#include "shell.h"
+
+enum { CRYPTO_AESE, CRYPTO_AESD, CRYPTO_AESMC, CRYPTO_AESIMC };
+enum { CRYPTO_SHA1C, CRYPTO_SHA1P, CRYPTO_SHA1M };
+
+/*
+ * Implementacion elegida al iniciar segun la CPU del host. Las funciones
+ * reciben los operandos por valor y devuelven el registro resultado, con
+ * la semantica de las instrucciones de ARMv8.
+ */
+typedef struct {
+    uint32_t (*crc32c)(uint32_t crc, uint64_t data, int bytes);
+    vreg_t   (*aes)(int op, vreg_t d, vreg_t n);
+    vreg_t   (*sha1_rounds)(int op, vreg_t x, uint32_t e, vreg_t w);
+    vreg_t   (*sha256_rounds)(vreg_t x, vreg_t y, vreg_t w, int part1);
+    vreg_t   (*sha256_schedule0)(vreg_t d, vreg_t n);
+    vreg_t   (*sha256_schedule1)(vreg_t d, vreg_t n, vreg_t m);
+    const char *name;
+} crypto_t;
+
+extern crypto_t CRYPTO;
+
+void     crypto_init();
+uint32_t crypto_crc32(uint32_t crc, uint64_t data, int bytes);
+vreg_t   crypto_sha1_schedule0(vreg_t d, vreg_t n, vreg_t m);
+vreg_t   crypto_sha1_schedule1(vreg_t d, vreg_t n);
+
+#endif
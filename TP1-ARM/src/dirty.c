@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "shell.h"
+#include "dirty.h"
+
+/*
+ * EPOCHS[r][p] es la epoca de la ultima escritura a la pagina p de la
+ * region r. Varios clientes (time travel, diff de snapshots) pueden usar
+ * el seguimiento a la vez, cada uno con sus propias epocas: por eso se
+ * cuenta cuantos lo pidieron en vez de prenderlo y apagarlo.
+ */
+
+int DIRTY_TRACKING = FALSE;
+
+static int USERS;
+static uint32_t EPOCH = 1;
+static uint32_t *EPOCHS[MEM_NREGIONS];
+
+
+/**
+ * Empieza (o sigue) el seguimiento de escrituras para un cliente mas.
+ */
+void dirty_acquire() {
+    if (USERS++ > 0)
+        return;
+    for (int r = 0; r < MEM_NREGIONS; r++)
+        if (EPOCHS[r] == NULL)
+            EPOCHS[r] = calloc(dirty_pages(r), sizeof(uint32_t));
+    DIRTY_TRACKING = TRUE;
+}
+
+
+/**
+ * Un cliente deja de necesitar el seguimiento.
+ */
+void dirty_release() {
+    if (USERS > 0 && --USERS == 0)
+        DIRTY_TRACKING = FALSE;
+}
+
+
+/**
+ * Empieza una epoca nueva.
+ *
+ * Returns: uint32_t: La epoca: las paginas escritas desde ahora quedan
+ *                    con un valor >= al devuelto.
+ */
+uint32_t dirty_advance() {
+    return ++EPOCH;
+}
+
+
+/**
+ * Registra una escritura de 32 bits (que puede cruzar a la pagina siguiente).
+ *
+ * Params: region (int): Indice en MEM_REGIONS.
+ *         offset (uint64_t): Desplazamiento dentro de la region.
+ */
+void dirty_write(int region, uint64_t offset) {
+    uint32_t *epochs = EPOCHS[region];
+    uint64_t last = (MEM_REGIONS[region].size >> DIRTY_PAGE_SHIFT) - 1;
+    uint64_t first_page = offset >> DIRTY_PAGE_SHIFT, last_page = (offset + 3) >> DIRTY_PAGE_SHIFT;
+
+    epochs[first_page] = EPOCH;
+    if (last_page != first_page && last_page <= last)
+        epochs[last_page] = EPOCH;
+}
+
+
+/**
+ * Marca una pagina como escrita (se modifico sin pasar por mem_write_32).
+ *
+ * Params: region (int): Indice en MEM_REGIONS.
+ *         page (uint64_t): Pagina dentro de la region.
+ */
+void dirty_touch(int region, uint64_t page) {
+    if (DIRTY_TRACKING)
+        EPOCHS[region][page] = EPOCH;
+}
+
+
+/**
+ * Marca toda la memoria como escrita (se reemplazo entera).
+ */
+void dirty_touch_all() {
+    if (!DIRTY_TRACKING)
+        return;
+    for (int r = 0; r < MEM_NREGIONS; r++)
+        for (uint64_t p = 0; p < dirty_pages(r); p++)
+            EPOCHS[r][p] = EPOCH;
+}
+
+
+/**
+ * Returns: int: TRUE si la pagina se escribio desde la epoca dada.
+ */
+int dirty_since(int region, uint64_t page, uint32_t epoch) {
+    return EPOCHS[region][page] >= epoch;
+}
+
+
+/**
+ * Returns: uint64_t: Cantidad de paginas de la region.
+ */
+uint64_t dirty_pages(int region) {
+    return MEM_REGIONS[region].size >> DIRTY_PAGE_SHIFT;
+}
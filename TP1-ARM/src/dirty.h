@@ -0,0 +1,31 @@
+/***************************************************************/
+/*                                                             */
+/*   Seguimiento de paginas escritas                           */
+/*                                                             */
+/*   Cada escritura estampa su pagina con la epoca actual. Un  */
+/*   cliente toma una epoca con dirty_advance() y despues      */
+/*   pregunta que paginas se escribieron desde entonces.       */
+/*                                                             */
+/***************************************************************/
+
+#ifndef _SIM_DIRTY_H_
+#define _SIM_DIRTY_H_
+
+#include <inttypes.h>
+#include "shell.h"
+
+#define DIRTY_PAGE_SHIFT    12
+#define DIRTY_PAGE_SIZE     (1 << DIRTY_PAGE_SHIFT)
+
+extern int DIRTY_TRACKING;
+
+void     dirty_acquire();
+void     dirty_release();
+uint32_t dirty_advance();
+void     dirty_write(int region, uint64_t offset);
+void     dirty_touch(int region, uint64_t page);
+void     dirty_touch_all();
+int      dirty_since(int region, uint64_t page, uint32_t epoch);
+uint64_t dirty_pages(int region);
+
+#endif
@@ -0,0 +1,621 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "shell.h"
+#include "sim.h"
+#include "elfload.h"
+
+/*
+ * Carga de ELF64 little-endian para AArch64:
+ *
+ * - Ejecutables (ET_EXEC): cada segmento PT_LOAD se copia a la region de
+ *   memoria que contiene [p_vaddr, p_vaddr + p_memsz); lo que excede a
+ *   p_filesz (.bss) queda en cero. El PC inicial es e_entry.
+ * - Objetos (ET_REL, la salida directa del ensamblador): las secciones
+ *   ejecutables se ubican una tras otra desde MEM_TEXT_START y el resto de
+ *   las secciones SHF_ALLOC desde MEM_DATA_START. Se aplican las
+ *   relocaciones RELA habituales de codigo estatico. El PC inicial es
+ *   _start, main o el comienzo de la primera seccion ejecutable.
+ *
+ * En ambos casos se guarda la tabla de simbolos (sin los simbolos de
+ * mapeo $x/$d) ordenada por direccion, para traducir nombres en los
+ * breakpoints y direcciones en los reportes.
+ */
+
+typedef struct {
+    uint64_t address;
+    char *name;
+} symbol_t;
+
+static symbol_t *SYMBOLS;
+static uint64_t NSYMBOLS;
+
+/* archivo mapeado durante la carga */
+static const uint8_t *IMAGE;
+static uint64_t IMAGE_SIZE;
+static const char *PATH;
+
+/* disposicion de la ultima imagen cargada (ver elf_image_layout) */
+static uint64_t DATA_END = MEM_DATA_START;
+static uint64_t PHDR_ADDRESS, PHDR_COUNT;
+
+
+static void load_error(const char *message, ...) __attribute__((format(printf, 1, 2)));
+static void load_error(const char *message, ...) {
+    va_list args;
+
+    printf("Error: %s: ", PATH);
+    va_start(args, message);
+    vprintf(message, args);
+    va_end(args);
+    printf("\n");
+}
+
+/* Puntero a [offset, offset + size) del archivo, o NULL si se sale. */
+static const void *file_range(uint64_t offset, uint64_t size) {
+    if (offset > IMAGE_SIZE || size > IMAGE_SIZE - offset)
+        return NULL;
+    return IMAGE + offset;
+}
+
+/* Region que contiene [address, address + size), o -1. */
+static int region_of(uint64_t address, uint64_t size) {
+    for (int i = 0; i < MEM_NREGIONS; i++) {
+        mem_region_t *r = &MEM_REGIONS[i];
+        if (address >= r->start && address - r->start <= r->size && size <= r->size - (address - r->start))
+            return i;
+    }
+    return -1;
+}
+
+/* Puntero a la memoria simulada de [address, address + size), o NULL. */
+static uint8_t *guest_range(uint64_t address, uint64_t size) {
+    int i = region_of(address, size);
+    return i < 0 ? NULL : MEM_REGIONS[i].mem + (address - MEM_REGIONS[i].start);
+}
+
+static int compare_symbols(const void *a, const void *b) {
+    const symbol_t *x = a, *y = b;
+    if (x->address != y->address)
+        return x->address < y->address ? -1 : 1;
+    return strcmp(x->name, y->name);
+}
+
+static void clear_symbols() {
+    for (uint64_t i = 0; i < NSYMBOLS; i++)
+        free(SYMBOLS[i].name);
+    free(SYMBOLS);
+    SYMBOLS = NULL;
+    NSYMBOLS = 0;
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Ejecutables                                                        */
+/* ------------------------------------------------------------------ */
+
+/* Lleva el fin de lo cargado en el segmento de datos (comienzo de brk). */
+static void note_loaded(uint64_t address, uint64_t size) {
+    if (address >= MEM_DATA_START && address - MEM_DATA_START < MEM_DATA_SIZE && address + size > DATA_END)
+        DATA_END = address + size;
+}
+
+static int load_segments(const Elf64_Ehdr *eh) {
+    const Elf64_Phdr *ph = file_range(eh->e_phoff, (uint64_t)eh->e_phnum * sizeof(Elf64_Phdr));
+    int loaded = 0;
+
+    if (ph == NULL || eh->e_phentsize != sizeof(Elf64_Phdr)) {
+        load_error("bad program header table");
+        return -1;
+    }
+    for (int i = 0; i < eh->e_phnum; i++) {
+        const uint8_t *source;
+        uint8_t *target;
+
+        if (ph[i].p_type != PT_LOAD || ph[i].p_memsz == 0)
+            continue;
+        source = file_range(ph[i].p_offset, ph[i].p_filesz);
+        target = guest_range(ph[i].p_vaddr, ph[i].p_memsz);
+        if (source == NULL || ph[i].p_filesz > ph[i].p_memsz) {
+            load_error("segment %d lies outside the file", i);
+            return -1;
+        }
+        if (target == NULL) {
+            load_error("segment %d (0x%" PRIx64 "..0x%" PRIx64 ") does not fit in simulated memory",
+                       i, (uint64_t)ph[i].p_vaddr, (uint64_t)(ph[i].p_vaddr + ph[i].p_memsz));
+            return -1;
+        }
+        memcpy(target, source, ph[i].p_filesz);
+        memset(target + ph[i].p_filesz, 0, ph[i].p_memsz - ph[i].p_filesz);
+        note_loaded(ph[i].p_vaddr, ph[i].p_memsz);
+        /* la tabla de program headers, si quedo en memoria (para AT_PHDR) */
+        if (eh->e_phoff >= ph[i].p_offset && eh->e_phoff - ph[i].p_offset < ph[i].p_filesz) {
+            PHDR_ADDRESS = ph[i].p_vaddr + (eh->e_phoff - ph[i].p_offset);
+            PHDR_COUNT = eh->e_phnum;
+        }
+        loaded++;
+    }
+    if (loaded == 0) {
+        load_error("no PT_LOAD segments");
+        return -1;
+    }
+    return loaded;
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Objetos reubicables                                                */
+/* ------------------------------------------------------------------ */
+
+static uint64_t align_up(uint64_t value, uint64_t alignment) {
+    return alignment > 1 ? (value + alignment - 1) & ~(alignment - 1) : value;
+}
+
+/* Ubica cada seccion SHF_ALLOC; base[i] = 0 si la seccion no se carga. */
+static int place_sections(const Elf64_Ehdr *eh, const Elf64_Shdr *sh, uint64_t *base) {
+    uint64_t text = MEM_TEXT_START, data = MEM_DATA_START;
+    int loaded = 0;
+
+    for (int i = 0; i < eh->e_shnum; i++) {
+        uint64_t *next = (sh[i].sh_flags & SHF_EXECINSTR) ? &text : &data;
+        uint8_t *target;
+
+        base[i] = 0;
+        if (!(sh[i].sh_flags & SHF_ALLOC) || sh[i].sh_size == 0)
+            continue;
+        *next = align_up(*next, sh[i].sh_addralign);
+        target = guest_range(*next, sh[i].sh_size);
+        if (target == NULL) {
+            load_error("section %d does not fit in simulated memory", i);
+            return -1;
+        }
+        if (sh[i].sh_type == SHT_NOBITS) {
+            memset(target, 0, sh[i].sh_size);
+        } else {
+            const void *source = file_range(sh[i].sh_offset, sh[i].sh_size);
+            if (source == NULL) {
+                load_error("section %d lies outside the file", i);
+                return -1;
+            }
+            memcpy(target, source, sh[i].sh_size);
+        }
+        base[i] = *next;
+        note_loaded(base[i], sh[i].sh_size);
+        *next += sh[i].sh_size;
+        loaded++;
+    }
+    if (loaded == 0) {
+        load_error("no allocatable sections");
+        return -1;
+    }
+    return loaded;
+}
+
+static uint32_t read32(const uint8_t *p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void write32(uint8_t *p, uint32_t value) {
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
+}
+
+/* Reemplaza el campo de `bits` bits en la posicion `shift` de la instruccion. */
+static void patch(uint8_t *p, int shift, int bits, uint64_t value) {
+    uint32_t mask = ((1U << bits) - 1) << shift;
+    write32(p, (read32(p) & ~mask) | (((uint32_t)value << shift) & mask));
+}
+
+static int fits_signed(int64_t value, int bits) {
+    return value >= -(1LL << (bits - 1)) && value < (1LL << (bits - 1));
+}
+
+/* Aplica una relocacion; S + A es `value` y P es `place`. */
+static int relocate(uint8_t *p, uint32_t type, uint64_t value, uint64_t place) {
+    int64_t relative = (int64_t)(value - place);
+
+    switch (type) {
+    case R_AARCH64_NONE:
+        return 0;
+    case R_AARCH64_ABS64:
+        write32(p, value);
+        write32(p + 4, value >> 32);
+        return 0;
+    case R_AARCH64_ABS32:
+        write32(p, value);
+        return value >> 32 ? -1 : 0;
+    case R_AARCH64_PREL64:
+        write32(p, relative);
+        write32(p + 4, (uint64_t)relative >> 32);
+        return 0;
+    case R_AARCH64_PREL32:
+        write32(p, relative);
+        return fits_signed(relative, 32) ? 0 : -1;
+    case R_AARCH64_MOVW_UABS_G0:
+    case R_AARCH64_MOVW_UABS_G0_NC:
+        patch(p, 5, 16, value);
+        return 0;
+    case R_AARCH64_MOVW_UABS_G1:
+    case R_AARCH64_MOVW_UABS_G1_NC:
+        patch(p, 5, 16, value >> 16);
+        return 0;
+    case R_AARCH64_MOVW_UABS_G2:
+    case R_AARCH64_MOVW_UABS_G2_NC:
+        patch(p, 5, 16, value >> 32);
+        return 0;
+    case R_AARCH64_MOVW_UABS_G3:
+        patch(p, 5, 16, value >> 48);
+        return 0;
+    case R_AARCH64_LD_PREL_LO19:
+    case R_AARCH64_CONDBR19:
+        patch(p, 5, 19, relative >> 2);
+        return fits_signed(relative, 21) ? 0 : -1;
+    case R_AARCH64_TSTBR14:
+        patch(p, 5, 14, relative >> 2);
+        return fits_signed(relative, 16) ? 0 : -1;
+    case R_AARCH64_JUMP26:
+    case R_AARCH64_CALL26:
+        patch(p, 0, 26, relative >> 2);
+        return fits_signed(relative, 28) ? 0 : -1;
+    case R_AARCH64_ADR_PREL_LO21:
+        patch(p, 29, 2, relative);
+        patch(p, 5, 19, relative >> 2);
+        return fits_signed(relative, 21) ? 0 : -1;
+    case R_AARCH64_ADR_PREL_PG_HI21:
+    case R_AARCH64_ADR_PREL_PG_HI21_NC:
+        relative = (int64_t)((value & ~0xFFFULL) - (place & ~0xFFFULL)) >> 12;
+        patch(p, 29, 2, relative);
+        patch(p, 5, 19, relative >> 2);
+        return type == R_AARCH64_ADR_PREL_PG_HI21_NC || fits_signed(relative, 21) ? 0 : -1;
+    case R_AARCH64_ADD_ABS_LO12_NC:
+    case R_AARCH64_LDST8_ABS_LO12_NC:
+        patch(p, 10, 12, value & 0xFFF);
+        return 0;
+    case R_AARCH64_LDST16_ABS_LO12_NC:
+        patch(p, 10, 12, (value & 0xFFF) >> 1);
+        return 0;
+    case R_AARCH64_LDST32_ABS_LO12_NC:
+        patch(p, 10, 12, (value & 0xFFF) >> 2);
+        return 0;
+    case R_AARCH64_LDST64_ABS_LO12_NC:
+        patch(p, 10, 12, (value & 0xFFF) >> 3);
+        return 0;
+    case R_AARCH64_LDST128_ABS_LO12_NC:
+        patch(p, 10, 12, (value & 0xFFF) >> 4);
+        return 0;
+    }
+    load_error("unsupported relocation type %u", type);
+    return -2;
+}
+
+static int apply_relocations(const Elf64_Ehdr *eh, const Elf64_Shdr *sh, const uint64_t *base) {
+    for (int i = 0; i < eh->e_shnum; i++) {
+        const Elf64_Rela *rela;
+        const Elf64_Sym *symtab;
+        uint64_t count, nsyms;
+
+        if (sh[i].sh_type == SHT_REL) {
+            load_error("REL relocations are not supported");
+            return -1;
+        }
+        if (sh[i].sh_type != SHT_RELA || sh[i].sh_info >= eh->e_shnum || base[sh[i].sh_info] == 0)
+            continue;
+        if (sh[i].sh_link >= eh->e_shnum) {
+            load_error("bad symbol table for relocation section %d", i);
+            return -1;
+        }
+        count = sh[i].sh_size / sizeof(Elf64_Rela);
+        nsyms = sh[sh[i].sh_link].sh_size / sizeof(Elf64_Sym);
+        rela = file_range(sh[i].sh_offset, count * sizeof(Elf64_Rela));
+        symtab = file_range(sh[sh[i].sh_link].sh_offset, nsyms * sizeof(Elf64_Sym));
+        if (rela == NULL || symtab == NULL) {
+            load_error("relocation section %d lies outside the file", i);
+            return -1;
+        }
+
+        for (uint64_t r = 0; r < count; r++) {
+            uint64_t target = sh[i].sh_info, place = base[target] + rela[r].r_offset;
+            uint32_t type = ELF64_R_TYPE(rela[r].r_info);
+            uint64_t s = ELF64_R_SYM(rela[r].r_info), value;
+            uint64_t size = (type == R_AARCH64_ABS64 || type == R_AARCH64_PREL64) ? 8 : 4;
+            uint8_t *p = guest_range(place, size);
+            int status;
+
+            if (s >= nsyms || p == NULL || rela[r].r_offset + size > sh[target].sh_size) {
+                load_error("bad relocation %" PRIu64 " in section %d", r, i);
+                return -1;
+            }
+            if (symtab[s].st_shndx == SHN_ABS)
+                value = symtab[s].st_value;
+            else if (symtab[s].st_shndx != SHN_UNDEF && symtab[s].st_shndx < eh->e_shnum)
+                value = base[symtab[s].st_shndx] + symtab[s].st_value;
+            else if (s != 0) {
+                load_error("relocation %" PRIu64 " in section %d refers to an undefined symbol", r, i);
+                return -1;
+            }
+            else
+                value = 0;
+
+            status = relocate(p, type, value + rela[r].r_addend, place);
+            if (status == -1)
+                load_error("relocation %" PRIu64 " in section %d out of range", r, i);
+            if (status != 0)
+                return -1;
+        }
+    }
+    return 0;
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Simbolos                                                           */
+/* ------------------------------------------------------------------ */
+
+/* Guarda los simbolos de la tabla; base es NULL para ejecutables. */
+static void read_symbols(const Elf64_Ehdr *eh, const Elf64_Shdr *sh, const uint64_t *base) {
+    if (sh == NULL)
+        return;
+
+    for (int i = 0; i < eh->e_shnum; i++) {
+        const Elf64_Sym *syms;
+        const char *strings;
+        uint64_t nsyms;
+
+        if (sh[i].sh_type != SHT_SYMTAB || sh[i].sh_link >= eh->e_shnum)
+            continue;
+        nsyms = sh[i].sh_size / sizeof(Elf64_Sym);
+        syms = file_range(sh[i].sh_offset, nsyms * sizeof(Elf64_Sym));
+        strings = file_range(sh[sh[i].sh_link].sh_offset, sh[sh[i].sh_link].sh_size);
+        if (syms == NULL || strings == NULL || sh[sh[i].sh_link].sh_size == 0)
+            continue;
+
+        SYMBOLS = realloc(SYMBOLS, (NSYMBOLS + nsyms) * sizeof(symbol_t));
+        for (uint64_t s = 1; s < nsyms; s++) {
+            int type = ELF64_ST_TYPE(syms[s].st_info);
+            uint64_t address = syms[s].st_value;
+            const char *name;
+
+            if (syms[s].st_name >= sh[sh[i].sh_link].sh_size || syms[s].st_shndx == SHN_UNDEF ||
+                    (type != STT_NOTYPE && type != STT_FUNC && type != STT_OBJECT))
+                continue;
+            name = strings + syms[s].st_name;
+            if (name[0] == '\0' || name[0] == '$' ||
+                    strnlen(name, sh[sh[i].sh_link].sh_size - syms[s].st_name) == sh[sh[i].sh_link].sh_size - syms[s].st_name)
+                continue;
+            if (base != NULL && syms[s].st_shndx != SHN_ABS) {
+                if (syms[s].st_shndx >= eh->e_shnum || base[syms[s].st_shndx] == 0)
+                    continue;
+                address += base[syms[s].st_shndx];
+            }
+            SYMBOLS[NSYMBOLS].address = address;
+            SYMBOLS[NSYMBOLS].name = strdup(name);
+            NSYMBOLS++;
+        }
+    }
+    qsort(SYMBOLS, NSYMBOLS, sizeof(symbol_t), compare_symbols);
+}
+
+static int entry_from_symbols(uint64_t *entry) {
+    return elf_symbol_address("_start", entry) || elf_symbol_address("main", entry);
+}
+
+
+/**
+ * Indica si el archivo empieza con la firma ELF.
+ *
+ * Params: path (const char *): Archivo de programa.
+ *
+ * Returns: int: TRUE si es un ELF.
+ */
+int elf_is_image(const char *path) {
+    unsigned char magic[SELFMAG];
+    FILE *f = fopen(path, "rb");
+    int is_elf;
+
+    if (f == NULL)
+        return FALSE;
+    is_elf = fread(magic, 1, SELFMAG, f) == SELFMAG && memcmp(magic, ELFMAG, SELFMAG) == 0;
+    fclose(f);
+    return is_elf;
+}
+
+
+/**
+ * Carga un ELF64 AArch64 (ejecutable u objeto) en la memoria simulada y
+ * reemplaza la tabla de simbolos.
+ *
+ * Params: path (const char *): Archivo a cargar.
+ *         entry (uint64_t *): Direccion inicial del programa.
+ *
+ * Returns: int: Cantidad de segmentos o secciones cargadas, o -1 si hubo
+ *               un error (ya informado).
+ */
+int elf_load(const char *path, uint64_t *entry) {
+    const Elf64_Ehdr *eh;
+    const Elf64_Shdr *sh = NULL;
+    uint64_t *base = NULL;
+    struct stat st;
+    int fd, loaded = -1;
+
+    PATH = path;
+    DATA_END = MEM_DATA_START;
+    PHDR_ADDRESS = PHDR_COUNT = 0;
+    /* los simbolos de una carga anterior no valen aunque esta falle */
+    clear_symbols();
+    fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        printf("Error: Can't open program file %s\n", path);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    IMAGE_SIZE = st.st_size;
+    IMAGE = mmap(NULL, IMAGE_SIZE, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (IMAGE == MAP_FAILED) {
+        load_error("can't map file");
+        return -1;
+    }
+
+    eh = file_range(0, sizeof(Elf64_Ehdr));
+    if (eh == NULL || memcmp(eh->e_ident, ELFMAG, SELFMAG) != 0 || eh->e_ident[EI_CLASS] != ELFCLASS64 ||
+            eh->e_ident[EI_DATA] != ELFDATA2LSB || eh->e_machine != EM_AARCH64) {
+        load_error("not an ELF64 little-endian AArch64 file");
+        goto done;
+    }
+    if (eh->e_shnum > 0) {
+        sh = file_range(eh->e_shoff, (uint64_t)eh->e_shnum * sizeof(Elf64_Shdr));
+        if (sh == NULL || eh->e_shentsize != sizeof(Elf64_Shdr)) {
+            load_error("bad section header table");
+            goto done;
+        }
+    }
+
+    if (eh->e_type == ET_EXEC) {
+        loaded = load_segments(eh);
+        if (loaded < 0)
+            goto done;
+        read_symbols(eh, sh, NULL);
+        *entry = eh->e_entry;
+    }
+    else if (eh->e_type == ET_REL && sh != NULL) {
+        base = calloc(eh->e_shnum, sizeof(uint64_t));
+        loaded = place_sections(eh, sh, base);
+        if (loaded < 0 || apply_relocations(eh, sh, base) < 0) {
+            loaded = -1;
+            goto done;
+        }
+        read_symbols(eh, sh, base);
+        if (!entry_from_symbols(entry)) {
+            *entry = MEM_TEXT_START;
+            for (int i = 0; i < eh->e_shnum; i++)
+                if (base[i] != 0 && (sh[i].sh_flags & SHF_EXECINSTR)) {
+                    *entry = base[i];
+                    break;
+                }
+        }
+    }
+    else
+        load_error("only executables and relocatable objects are supported");
+
+done:
+    free(base);
+    munmap((void *)IMAGE, IMAGE_SIZE);
+    predecode_reset();
+    return loaded;
+}
+
+
+/**
+ * Informa la disposicion en memoria de la ultima imagen cargada.
+ *
+ * Params: data_end (uint64_t *): Fin de lo cargado en el segmento de datos.
+ *         phdr (uint64_t *): Direccion de los program headers (0 si no se
+ *                            cargaron, como en los objetos).
+ *         phnum (uint64_t *): Cantidad de program headers.
+ */
+void elf_image_layout(uint64_t *data_end, uint64_t *phdr, uint64_t *phnum) {
+    *data_end = DATA_END;
+    *phdr = PHDR_ADDRESS;
+    *phnum = PHDR_COUNT;
+}
+
+
+/**
+ * Busca la direccion de un simbolo por nombre.
+ *
+ * Returns: int: TRUE si el simbolo existe.
+ */
+int elf_symbol_address(const char *name, uint64_t *address) {
+    for (uint64_t i = 0; i < NSYMBOLS; i++)
+        if (strcmp(SYMBOLS[i].name, name) == 0) {
+            *address = SYMBOLS[i].address;
+            return TRUE;
+        }
+    return FALSE;
+}
+
+
+/**
+ * Busca el simbolo mas cercano en o antes de una direccion.
+ *
+ * Params: address (uint64_t): Direccion buscada.
+ *         offset (uint64_t *): Distancia desde el simbolo (puede ser NULL).
+ *
+ * Returns: const char *: Nombre del simbolo, o NULL si no hay ninguno.
+ */
+const char *elf_symbol_name(uint64_t address, uint64_t *offset) {
+    uint64_t low = 0, high = NSYMBOLS;
+
+    /* primer simbolo con direccion > address */
+    while (low < high) {
+        uint64_t mid = (low + high) / 2;
+        if (SYMBOLS[mid].address <= address)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    if (low == 0)
+        return NULL;
+    /* entre alias de la misma direccion, el primero en orden alfabetico */
+    for (low--; low > 0 && SYMBOLS[low - 1].address == SYMBOLS[low].address; low--);
+    if (region_of(address, 1) != region_of(SYMBOLS[low].address, 1))
+        return NULL;
+    if (offset != NULL)
+        *offset = address - SYMBOLS[low].address;
+    return SYMBOLS[low].name;
+}
+
+
+/**
+ * Interpreta una direccion escrita como numero, simbolo o simbolo+offset.
+ *
+ * Returns: int: TRUE si se pudo interpretar.
+ */
+int elf_parse_address(const char *text, uint64_t *address) {
+    char name[128], *plus;
+    int64_t number, offset = 0;
+    int used;
+
+    if (sscanf(text, "%" SCNi64 "%n", &number, &used) == 1 && text[used] == '\0') {
+        *address = number;
+        return TRUE;
+    }
+    snprintf(name, sizeof(name), "%s", text);
+    plus = strchr(name, '+');
+    if (plus != NULL) {
+        *plus++ = '\0';
+        if (sscanf(plus, "%" SCNi64 "%n", &offset, &used) != 1 || plus[used] != '\0')
+            return FALSE;
+    }
+    if (!elf_symbol_address(name, address))
+        return FALSE;
+    *address += offset;
+    return TRUE;
+}
+
+
+/**
+ * Imprime " <simbolo+offset>" para una direccion, si hay simbolos.
+ *
+ * Params: out (FILE *): Archivo de salida.
+ *         address (uint64_t): Direccion a describir.
+ */
+void elf_print_address(FILE *out, uint64_t address) {
+    uint64_t offset;
+    const char *name = elf_symbol_name(address, &offset);
+
+    if (name == NULL)
+        return;
+    if (offset == 0)
+        fprintf(out, " <%s>", name);
+    else
+        fprintf(out, " <%s+0x%" PRIx64 ">", name, offset);
+}
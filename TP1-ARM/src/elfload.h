@@ -0,0 +1,22 @@
+/***************************************************************/
+/*                                                             */
+/*   Carga de objetos y ejecutables ELF64 AArch64              */
+/*                                                             */
+/***************************************************************/
+
+#ifndef _SIM_ELFLOAD_H_
+#define _SIM_ELFLOAD_H_
+
+#include <stdio.h>
+#include <inttypes.h>
+
+int         elf_is_image(const char *path);
+int         elf_load(const char *path, uint64_t *entry);
+void        elf_image_layout(uint64_t *data_end, uint64_t *phdr, uint64_t *phnum);
+
+int         elf_symbol_address(const char *name, uint64_t *address);
+const char *elf_symbol_name(uint64_t address, uint64_t *offset);
+int         elf_parse_address(const char *text, uint64_t *address);
+void        elf_print_address(FILE *out, uint64_t address);
+
+#endif
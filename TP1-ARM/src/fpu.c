@@ -0,0 +1,474 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <fenv.h>
+#include "shell.h"
+#include "fpu.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+/*
+ * Punto flotante escalar sobre el FP del host. En x86-64 las operaciones
+ * de C con float y double compilan a las escalares de SSE2 (ADDSS/ADDSD,
+ * MULSD, DIVSD, SQRTSD, CVTSI2SD, ...), que estan siempre y redondean
+ * como IEEE 754; solo la multiplicacion-suma fusionada se elige segun la
+ * CPU (FMA3 o fma() de libm).
+ *
+ * FPCR se carga en el host (modo de redondeo y FZ) al reanudar la
+ * simulacion y al escribirlo con MSR, no en cada instruccion. Los flags de
+ * excepcion de FPSR son perezosos: se acumulan en el estado del host
+ * (MXCSR) y solo pasan a FPSR al leerlo con MRS, al terminar la simulacion
+ * (fpu_suspend) o al tomar un snapshot (fpu_flush). El codigo del propio
+ * simulador que corre durante la simulacion con punto flotante (live,
+ * bbv, plugins) va entre fpu_host_enter y fpu_host_leave, asi no usa el
+ * redondeo del programa ni le suma flags. Lo que el host no hace
+ * como ARM se corrige aparte: la NaN por defecto (positiva en ARM), que
+ * NaN se propaga, FMAX/FMIN y las conversiones a entero, que en ARM
+ * saturan.
+ */
+
+#define FPCR_FZ     (1u << 24)
+#define FPCR_DN     (1u << 25)
+
+#define FPSR_IOC    (1u << 0)
+#define FPSR_DZC    (1u << 1)
+#define FPSR_OFC    (1u << 2)
+#define FPSR_UFC    (1u << 3)
+#define FPSR_IXC    (1u << 4)
+
+/* FTZ y DAZ de MXCSR */
+#define MXCSR_FLUSH 0x8040
+
+/* entorno del programa simulado mientras corre codigo del simulador */
+static fenv_t GUEST_ENV;
+
+
+static double as_double(uint64_t bits) {
+    double x;
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+static float as_float(uint64_t bits) {
+    uint32_t low = bits;
+    float x;
+    memcpy(&x, &low, sizeof(x));
+    return x;
+}
+
+static uint64_t double_bits(double x) {
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return bits;
+}
+
+static uint64_t float_bits(float x) {
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return bits;
+}
+
+static uint64_t sign_bit(int dbl) {
+    return dbl ? 1ULL << 63 : 1ULL << 31;
+}
+
+static uint64_t infinity_bits(int dbl) {
+    return dbl ? 0x7FF0000000000000ULL : 0x7F800000;
+}
+
+static uint64_t quiet_bit(int dbl) {
+    return dbl ? 1ULL << 51 : 1ULL << 22;
+}
+
+static uint64_t default_nan(int dbl) {
+    return infinity_bits(dbl) | quiet_bit(dbl);
+}
+
+static int is_nan(uint64_t x, int dbl) {
+    return (x & ~sign_bit(dbl)) > infinity_bits(dbl);
+}
+
+static int is_signaling(uint64_t x, int dbl) {
+    return is_nan(x, dbl) && !(x & quiet_bit(dbl));
+}
+
+static int is_infinity(uint64_t x, int dbl) {
+    return (x & ~sign_bit(dbl)) == infinity_bits(dbl);
+}
+
+static int is_zero(uint64_t x, int dbl) {
+    return (x & ~sign_bit(dbl)) == 0;
+}
+
+/* Valor como double (un float se convierte sin perder nada). */
+static double value_of(uint64_t x, int dbl) {
+    return dbl ? as_double(x) : as_float(x);
+}
+
+
+/*
+ * NaN resultante si alguna entrada es NaN (FPProcessNaNs de ARM): la
+ * primera senalizante, ya silenciosa, o si no la primera silenciosa; sin
+ * NaN de entrada (0/0, inf - inf, ...) la NaN por defecto. Con FPCR.DN
+ * siempre la NaN por defecto.
+ */
+static uint64_t propagate_nan(const uint64_t *operands, int count, int dbl) {
+    int default_mode = (CURRENT_STATE.FPCR & FPCR_DN) != 0;
+
+    for (int i = 0; i < count; i++) {
+        if (is_signaling(operands[i], dbl)) {
+            feraiseexcept(FE_INVALID);
+            return default_mode ? default_nan(dbl) : operands[i] | quiet_bit(dbl);
+        }
+    }
+    for (int i = 0; i < count; i++)
+        if (is_nan(operands[i], dbl))
+            return default_mode ? default_nan(dbl) : operands[i];
+    return default_nan(dbl);
+}
+
+static uint64_t host_arith(int op, uint64_t n, uint64_t m, int dbl) {
+    if (dbl) {
+        double a = as_double(n), b = as_double(m);
+        switch (op) {
+        case FPU_MUL: return double_bits(a * b);
+        case FPU_DIV: return double_bits(a / b);
+        case FPU_ADD: return double_bits(a + b);
+        default: return double_bits(a - b);
+        }
+    } else {
+        float a = as_float(n), b = as_float(m);
+        switch (op) {
+        case FPU_MUL: return float_bits(a * b);
+        case FPU_DIV: return float_bits(a / b);
+        case FPU_ADD: return float_bits(a + b);
+        default: return float_bits(a - b);
+        }
+    }
+}
+
+/* FMAX, FMIN, FMAXNM y FMINNM: +0 es mayor que -0. */
+static uint64_t min_max(int op, uint64_t n, uint64_t m, int dbl) {
+    uint64_t operands[2] = {n, m};
+    int maximum = op == FPU_MAX || op == FPU_MAXNM;
+    double a, b;
+
+    if (is_nan(n, dbl) || is_nan(m, dbl)) {
+        /* las NM prefieren el numero a una NaN silenciosa */
+        if (op >= FPU_MAXNM && !(is_nan(n, dbl) && is_nan(m, dbl))) {
+            if (is_nan(n, dbl) && !is_signaling(n, dbl))
+                return m;
+            if (is_nan(m, dbl) && !is_signaling(m, dbl))
+                return n;
+        }
+        return propagate_nan(operands, 2, dbl);
+    }
+    a = value_of(n, dbl);
+    b = value_of(m, dbl);
+    if (a == b)
+        return maximum ? n & m : n | m;
+    return (a > b) == maximum ? n : m;
+}
+
+
+static uint64_t fma_portable(uint64_t n, uint64_t m, uint64_t a, int dbl) {
+    if (dbl)
+        return double_bits(fma(as_double(n), as_double(m), as_double(a)));
+    return float_bits(fmaf(as_float(n), as_float(m), as_float(a)));
+}
+
+#if defined(__x86_64__)
+__attribute__((target("fma")))
+static uint64_t fma_fma3(uint64_t n, uint64_t m, uint64_t a, int dbl) {
+    if (dbl) {
+        __m128d r = _mm_fmadd_sd(_mm_set_sd(as_double(n)), _mm_set_sd(as_double(m)), _mm_set_sd(as_double(a)));
+        return double_bits(_mm_cvtsd_f64(r));
+    }
+    __m128 r = _mm_fmadd_ss(_mm_set_ss(as_float(n)), _mm_set_ss(as_float(m)), _mm_set_ss(as_float(a)));
+    return float_bits(_mm_cvtss_f32(r));
+}
+#endif
+
+fpu_t FPU = {fma_portable, "libm"};
+
+
+/**
+ * Operaciones de dos fuentes: FMUL, FDIV, FADD, FSUB, FMAX, FMIN,
+ * FMAXNM, FMINNM y FNMUL.
+ *
+ * Params: op (int): FPU_MUL ... FPU_NMUL.
+ *         dbl (int): TRUE para D, FALSE para S.
+ *
+ * Returns: uint64_t: Bits del resultado.
+ */
+uint64_t fpu_arith(int op, uint64_t n, uint64_t m, int dbl) {
+    uint64_t operands[2] = {n, m}, result;
+
+    if (op >= FPU_MAX && op <= FPU_MINNM)
+        return min_max(op, n, m, dbl);
+    result = host_arith(op == FPU_NMUL ? FPU_MUL : op, n, m, dbl);
+    if (is_nan(result, dbl))
+        result = propagate_nan(operands, 2, dbl);
+    /* FNMUL niega el producto ya redondeado, NaN incluida */
+    return op == FPU_NMUL ? result ^ sign_bit(dbl) : result;
+}
+
+
+/**
+ * Operaciones de una fuente: FMOV, FABS, FNEG (solo el signo, sin mirar
+ * NaN) y FSQRT.
+ */
+uint64_t fpu_unary(int op, uint64_t n, int dbl) {
+    uint64_t result;
+
+    switch (op) {
+    case FPU_MOV: return n;
+    case FPU_ABS: return n & ~sign_bit(dbl);
+    case FPU_NEG: return n ^ sign_bit(dbl);
+    }
+    result = dbl ? double_bits(sqrt(as_double(n))) : float_bits(sqrtf(as_float(n)));
+    if (is_nan(result, dbl))
+        result = propagate_nan(&n, 1, dbl);
+    return result;
+}
+
+
+/**
+ * FMADD, FMSUB, FNMADD y FNMSUB: a + n * m con un solo redondeo, con el
+ * producto y/o el sumando negados.
+ */
+uint64_t fpu_fused(uint64_t n, uint64_t m, uint64_t a, int negate_product, int negate_addend, int dbl) {
+    uint64_t operands[3], result;
+
+    if (negate_product)
+        n ^= sign_bit(dbl);
+    if (negate_addend)
+        a ^= sign_bit(dbl);
+    result = FPU.fma(n, m, a, dbl);
+    if (!is_nan(result, dbl))
+        return result;
+
+    /* inf * 0 es invalido aunque el sumando sea una NaN silenciosa */
+    if (is_nan(a, dbl) && !is_signaling(a, dbl) &&
+            ((is_infinity(n, dbl) && is_zero(m, dbl)) || (is_zero(n, dbl) && is_infinity(m, dbl)))) {
+        feraiseexcept(FE_INVALID);
+        return default_nan(dbl);
+    }
+    operands[0] = a;
+    operands[1] = n;
+    operands[2] = m;
+    return propagate_nan(operands, 3, dbl);
+}
+
+
+/**
+ * FCVT entre S y D. El host ya silencia las NaN y conserva su signo y
+ * los bits altos de la mantisa, como ARM.
+ *
+ * Params: to_dbl (int): TRUE de S a D, FALSE de D a S.
+ */
+uint64_t fpu_convert(uint64_t n, int to_dbl) {
+    uint64_t result = to_dbl ? double_bits(as_float(n)) : float_bits((float)as_double(n));
+
+    if (is_nan(result, to_dbl) && (CURRENT_STATE.FPCR & FPCR_DN))
+        return default_nan(to_dbl);
+    return result;
+}
+
+
+/**
+ * FCMP y FCMPE.
+ *
+ * Params: signaling (int): TRUE para FCMPE (una NaN silenciosa tambien
+ *                          es invalida).
+ *
+ * Returns: int: Flags NZCV (N en el bit 3).
+ */
+int fpu_compare(uint64_t n, uint64_t m, int dbl, int signaling) {
+    double a, b;
+
+    if (is_nan(n, dbl) || is_nan(m, dbl)) {
+        if (signaling || is_signaling(n, dbl) || is_signaling(m, dbl))
+            feraiseexcept(FE_INVALID);
+        return 0x3;
+    }
+    a = value_of(n, dbl);
+    b = value_of(m, dbl);
+    if (a == b)
+        return 0x6;
+    return a < b ? 0x8 : 0x2;
+}
+
+
+/* Redondeo al entero mas cercano, empates al par. */
+static double round_even(double x) {
+    if (fabs(x - trunc(x)) == 0.5)
+        return 2.0 * round(x / 2.0);
+    return round(x);
+}
+
+/**
+ * FCVT[NPMZA][SU]: a entero con el redondeo pedido. Fuera de rango
+ * satura (y una NaN da 0) con la excepcion de operacion invalida.
+ *
+ * Params: rounding (int): FPU_ROUND_N ... FPU_ROUND_A.
+ *         is_unsigned (int): TRUE para las formas U.
+ *         sf (int): TRUE para Xd, FALSE para Wd.
+ */
+uint64_t fpu_to_int(uint64_t n, int dbl, int rounding, int is_unsigned, int sf) {
+    double x = value_of(n, dbl), r;
+    double high = is_unsigned ? (sf ? 0x1p64 : 0x1p32) : (sf ? 0x1p63 : 0x1p31);
+    double low = is_unsigned ? 0.0 : -high;
+    uint64_t mask = sf ? ~0ULL : 0xFFFFFFFFULL;
+
+    if (is_nan(n, dbl)) {
+        feraiseexcept(FE_INVALID);
+        return 0;
+    }
+    switch (rounding) {
+    case FPU_ROUND_N: r = round_even(x); break;
+    case FPU_ROUND_P: r = ceil(x); break;
+    case FPU_ROUND_M: r = floor(x); break;
+    case FPU_ROUND_Z: r = trunc(x); break;
+    default: r = round(x); break;
+    }
+    if (r < low) {
+        feraiseexcept(FE_INVALID);
+        return is_unsigned ? 0 : (mask >> 1) + 1;
+    }
+    if (r >= high) {
+        feraiseexcept(FE_INVALID);
+        return is_unsigned ? mask : mask >> 1;
+    }
+    if (r != x)
+        feraiseexcept(FE_INEXACT);
+    if (is_unsigned)
+        return (uint64_t)r;
+    return (uint64_t)(int64_t)r & mask;
+}
+
+
+/**
+ * SCVTF y UCVTF: de Wn/Xn a S o D con el redondeo de FPCR.
+ */
+uint64_t fpu_from_int(uint64_t value, int dbl, int is_unsigned, int sf) {
+    if (!sf)
+        value = is_unsigned ? (uint32_t)value : (uint64_t)(int64_t)(int32_t)value;
+    if (is_unsigned)
+        return dbl ? double_bits((double)value) : float_bits((float)value);
+    return dbl ? double_bits((double)(int64_t)value) : float_bits((float)(int64_t)value);
+}
+
+
+/**
+ * Expande el inmediato de 8 bits de FMOV (VFPExpandImm): signo, 3 bits
+ * de exponente y 4 de mantisa.
+ */
+uint64_t fpu_expand_imm(uint32_t imm8, int dbl) {
+    uint64_t sign = imm8 >> 7, b = (imm8 >> 6) & 1, cd = (imm8 >> 4) & 3, fraction = imm8 & 0xF;
+
+    if (dbl)
+        return sign << 63 | (b ^ 1) << 62 | (b ? 0xFFULL : 0) << 54 | cd << 52 | fraction << 48;
+    return sign << 31 | (b ^ 1) << 30 | (b ? 0x1FULL : 0) << 25 | cd << 23 | fraction << 19;
+}
+
+
+/* Flags de excepcion acumulados en el host, como bits de FPSR. */
+static uint32_t pending_flags() {
+    int host = fetestexcept(FE_ALL_EXCEPT);
+
+    return (host & FE_INVALID ? FPSR_IOC : 0) | (host & FE_DIVBYZERO ? FPSR_DZC : 0) |
+           (host & FE_OVERFLOW ? FPSR_OFC : 0) | (host & FE_UNDERFLOW ? FPSR_UFC : 0) |
+           (host & FE_INEXACT ? FPSR_IXC : 0);
+}
+
+/* Modo de redondeo (FPCR.RMode) y FPCR.FZ en el host. */
+static void load_fpcr(uint32_t fpcr) {
+    static const int MODES[4] = {FE_TONEAREST, FE_UPWARD, FE_DOWNWARD, FE_TOWARDZERO};
+
+    fesetround(MODES[(fpcr >> 22) & 3]);
+#if defined(__x86_64__)
+    _mm_setcsr(fpcr & FPCR_FZ ? _mm_getcsr() | MXCSR_FLUSH : _mm_getcsr() & ~MXCSR_FLUSH);
+#endif
+}
+
+
+/**
+ * FPSR para MRS: el valor guardado mas los flags pendientes del host.
+ */
+uint32_t fpu_read_fpsr() {
+    return CURRENT_STATE.FPSR | pending_flags();
+}
+
+void fpu_write_fpsr(uint32_t value) {
+    feclearexcept(FE_ALL_EXCEPT);
+    NEXT_STATE.FPSR = value;
+}
+
+void fpu_write_fpcr(uint32_t value) {
+    NEXT_STATE.FPCR = value;
+    load_fpcr(value);
+}
+
+
+/**
+ * Antes de simular: carga FPCR en el host y descarta los flags que haya
+ * dejado el propio simulador.
+ */
+void fpu_resume() {
+    feclearexcept(FE_ALL_EXCEPT);
+    load_fpcr(CURRENT_STATE.FPCR);
+}
+
+/**
+ * Pasa a FPSR los flags pendientes, para que el estado guardado quede
+ * completo (snapshots).
+ */
+void fpu_flush() {
+    CURRENT_STATE.FPSR |= pending_flags();
+    NEXT_STATE.FPSR = CURRENT_STATE.FPSR;
+    feclearexcept(FE_ALL_EXCEPT);
+}
+
+/**
+ * Antes de codigo del simulador en medio de la simulacion: guarda el
+ * entorno del programa (redondeo, FZ y flags pendientes) y pasa al del
+ * host por defecto.
+ */
+void fpu_host_enter() {
+    fegetenv(&GUEST_ENV);
+    fesetenv(FE_DFL_ENV);
+}
+
+/**
+ * Vuelve al entorno guardado por fpu_host_enter; los flags que levanto el
+ * simulador se descartan.
+ */
+void fpu_host_leave() {
+    fesetenv(&GUEST_ENV);
+}
+
+/**
+ * Al parar la simulacion: como fpu_flush, y deja el host con el redondeo
+ * por defecto para los calculos del propio simulador.
+ */
+void fpu_suspend() {
+    fpu_flush();
+    load_fpcr(0);
+}
+
+
+/**
+ * Elige la multiplicacion-suma fusionada segun la CPU del host.
+ */
+void fpu_init() {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("fma")) {
+        FPU.fma = fma_fma3;
+        FPU.name = "fma";
+    }
+#endif
+}
@@ -0,0 +1,51 @@
+/***************************************************************/
+/*                                                             */
+/*   Punto flotante escalar (registros S y D)                  */
+/*                                                             */
+/***************************************************************/
+
+#ifndef _SIM_FPU_H_
+#define _SIM_FPU_H_
+
+#include <inttypes.h>
+
+/*
+ * Los operandos y resultados son los bits del registro: con dbl = 0 un
+ * float en los 32 bits bajos, con dbl = 1 un double.
+ */
+
+/* operaciones de dos fuentes, en el orden del campo opcode (bits 15-12) */
+enum { FPU_MUL, FPU_DIV, FPU_ADD, FPU_SUB, FPU_MAX, FPU_MIN, FPU_MAXNM, FPU_MINNM, FPU_NMUL };
+/* operaciones de una fuente, en el orden del campo opcode (bits 20-15) */
+enum { FPU_MOV, FPU_ABS, FPU_NEG, FPU_SQRT };
+/* redondeo de FCVT*: rmode de FPCR (N, P, M, Z) y al mas lejano del cero */
+enum { FPU_ROUND_N, FPU_ROUND_P, FPU_ROUND_M, FPU_ROUND_Z, FPU_ROUND_A };
+
+/* Implementacion de la multiplicacion-suma fusionada elegida al iniciar. */
+typedef struct {
+    uint64_t (*fma)(uint64_t n, uint64_t m, uint64_t a, int dbl);
+    const char *name;
+} fpu_t;
+
+extern fpu_t FPU;
+
+void     fpu_init();
+void     fpu_resume();
+void     fpu_suspend();
+void     fpu_flush();
+void     fpu_host_enter();
+void     fpu_host_leave();
+uint32_t fpu_read_fpsr();
+void     fpu_write_fpsr(uint32_t value);
+void     fpu_write_fpcr(uint32_t value);
+
+uint64_t fpu_arith(int op, uint64_t n, uint64_t m, int dbl);
+uint64_t fpu_unary(int op, uint64_t n, int dbl);
+uint64_t fpu_fused(uint64_t n, uint64_t m, uint64_t a, int negate_product, int negate_addend, int dbl);
+uint64_t fpu_convert(uint64_t n, int to_dbl);
+int      fpu_compare(uint64_t n, uint64_t m, int dbl, int signaling);
+uint64_t fpu_to_int(uint64_t n, int dbl, int rounding, int is_unsigned, int sf);
+uint64_t fpu_from_int(uint64_t value, int dbl, int is_unsigned, int sf);
+uint64_t fpu_expand_imm(uint32_t imm8, int dbl);
+
+#endif
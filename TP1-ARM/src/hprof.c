@@ -0,0 +1,284 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "shell.h"
+#include "sim.h"
+#include "hprof.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*
+ * Perfil del propio simulador (no del programa simulado).
+ *
+ * Cada `every` instrucciones se muestrea una: se lee el TSC del host al
+ * empezar el ciclo y en cada cambio de fase (fetch, decode, execute,
+ * commit), y el tiempo del execute se atribuye ademas a la funcion
+ * decode_* que se ejecuto. Si perf_event_open esta disponible, tambien
+ * se atribuyen a cada opcode las instrucciones y fallos de cache del host
+ * de toda la instruccion, descontando el costo de la propia lectura.
+ */
+
+enum { PERF_INSTRUCTIONS, PERF_CACHE_MISSES, PERF_NCOUNTERS };
+
+typedef struct {
+    uint64_t samples;
+    uint64_t ticks;
+    uint64_t counters[PERF_NCOUNTERS];
+} opcode_profile_t;
+
+int HPROF_ENABLED = FALSE;
+int HPROF_ACTIVE = FALSE;
+
+static const char *PHASE_NAMES[HPROF_NPHASES] = { "fetch", "decode", "execute", "commit" };
+
+static uint64_t EVERY, COUNTDOWN;
+static uint64_t LAST_TICK;
+static uint64_t PHASE_TICKS[HPROF_NPHASES];
+static uint64_t SAMPLES;
+static double NS_PER_TICK;
+static uint64_t TICK_OVERHEAD;          /* costo de una lectura del TSC */
+
+static opcode_profile_t *OPCODES;       /* INSTRUCTION_SET_SIZE + 1 (desconocida) */
+static int CURRENT_OPCODE;
+
+static int PERF_FD = -1;
+static uint64_t PERF_START[PERF_NCOUNTERS];
+static uint64_t PERF_OVERHEAD[PERF_NCOUNTERS];
+
+
+static inline uint64_t read_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+/* Ticks entre dos lecturas consecutivas: se descuentan de cada fase. */
+static uint64_t calibrate_overhead() {
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < 1000; i++) {
+        uint64_t a = read_ticks(), b = read_ticks();
+        if (b - a < best) best = b - a;
+    }
+    return best;
+}
+
+/* Mide cuantos ns dura un tick del TSC contra CLOCK_MONOTONIC. */
+static double calibrate_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    struct timespec start, now;
+    uint64_t ticks = read_ticks();
+    double elapsed;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        elapsed = (now.tv_sec - start.tv_sec) * 1e9 + (now.tv_nsec - start.tv_nsec);
+    } while (elapsed < 20e6);
+    return elapsed / (read_ticks() - ticks);
+#else
+    return 1.0;
+#endif
+}
+
+static int perf_open(uint64_t config, int group) {
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = (group == -1);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+static int perf_read(uint64_t values[PERF_NCOUNTERS]) {
+    uint64_t buffer[1 + PERF_NCOUNTERS];
+
+    if (read(PERF_FD, buffer, sizeof(buffer)) != sizeof(buffer))
+        return FALSE;
+    memcpy(values, buffer + 1, sizeof(uint64_t) * PERF_NCOUNTERS);
+    return TRUE;
+}
+
+/**
+ * Abre los contadores de hardware del host (si el kernel lo permite) y
+ * mide el costo de leerlos dos veces seguidas para descontarlo.
+ */
+static void perf_setup() {
+    uint64_t a[PERF_NCOUNTERS], b[PERF_NCOUNTERS];
+    int misses;
+
+    PERF_FD = perf_open(PERF_COUNT_HW_INSTRUCTIONS, -1);
+    if (PERF_FD < 0)
+        return;
+    misses = perf_open(PERF_COUNT_HW_CACHE_MISSES, PERF_FD);
+    if (misses < 0) {
+        close(PERF_FD);
+        PERF_FD = -1;
+        return;
+    }
+    ioctl(PERF_FD, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+    memset(PERF_OVERHEAD, 0xFF, sizeof(PERF_OVERHEAD));
+    for (int i = 0; i < 100; i++) {
+        perf_read(a);
+        perf_read(b);
+        for (int c = 0; c < PERF_NCOUNTERS; c++)
+            if (b[c] - a[c] < PERF_OVERHEAD[c])
+                PERF_OVERHEAD[c] = b[c] - a[c];
+    }
+}
+
+
+/**
+ * Empieza a perfilar, muestreando una de cada `every` instrucciones.
+ *
+ * Params: every (uint64_t): Periodo de muestreo (>= 1).
+ */
+void hprof_start(uint64_t every) {
+    free(OPCODES);
+    OPCODES = calloc(INSTRUCTION_SET_SIZE + 1, sizeof(opcode_profile_t));
+    memset(PHASE_TICKS, 0, sizeof(PHASE_TICKS));
+    SAMPLES = 0;
+    EVERY = COUNTDOWN = every;
+    if (NS_PER_TICK == 0) {
+        NS_PER_TICK = calibrate_ticks();
+        TICK_OVERHEAD = calibrate_overhead();
+    }
+    if (PERF_FD < 0)
+        perf_setup();
+    HPROF_ENABLED = TRUE;
+}
+
+
+/**
+ * Deja de perfilar. Los resultados se conservan para el reporte.
+ */
+void hprof_stop() {
+    HPROF_ENABLED = FALSE;
+    HPROF_ACTIVE = FALSE;
+}
+
+
+/**
+ * Comienzo de un ciclo: decide si se muestrea y toma las lecturas iniciales.
+ */
+void hprof_begin() {
+    if (--COUNTDOWN != 0)
+        return;
+    COUNTDOWN = EVERY;
+    HPROF_ACTIVE = TRUE;
+    CURRENT_OPCODE = INSTRUCTION_SET_SIZE;
+    if (PERF_FD >= 0)
+        perf_read(PERF_START);
+    LAST_TICK = read_ticks();
+}
+
+
+static inline uint64_t elapsed(uint64_t now) {
+    uint64_t ticks = now - LAST_TICK;
+    return ticks > TICK_OVERHEAD ? ticks - TICK_OVERHEAD : 0;
+}
+
+/**
+ * Fin de una fase: atribuye el tiempo desde la marca anterior.
+ *
+ * Params: phase (int): Fase que termina (HPROF_*).
+ */
+void hprof_mark(int phase) {
+    uint64_t now = read_ticks();
+    PHASE_TICKS[phase] += elapsed(now);
+    LAST_TICK = now;
+}
+
+
+/**
+ * Fin del execute: atribuye el tiempo a la fase y al handler ejecutado.
+ *
+ * Params: index (int): Indice en INSTRUCTION_SET, o -1 si no se reconocio.
+ */
+void hprof_execute(int index) {
+    uint64_t now = read_ticks();
+    CURRENT_OPCODE = index < 0 ? INSTRUCTION_SET_SIZE : index;
+    PHASE_TICKS[HPROF_EXECUTE] += elapsed(now);
+    OPCODES[CURRENT_OPCODE].ticks += elapsed(now);
+    LAST_TICK = now;
+}
+
+
+/**
+ * Fin del ciclo muestreado: cierra el commit y los contadores del host.
+ */
+void hprof_end() {
+    uint64_t values[PERF_NCOUNTERS];
+    opcode_profile_t *op = &OPCODES[CURRENT_OPCODE];
+
+    hprof_mark(HPROF_COMMIT);
+    if (PERF_FD >= 0 && perf_read(values)) {
+        for (int c = 0; c < PERF_NCOUNTERS; c++) {
+            uint64_t delta = values[c] - PERF_START[c];
+            op->counters[c] += delta > PERF_OVERHEAD[c] ? delta - PERF_OVERHEAD[c] : 0;
+        }
+    }
+    op->samples++;
+    SAMPLES++;
+    HPROF_ACTIVE = FALSE;
+}
+
+
+/**
+ * Imprime el costo en el host por fase y por opcode.
+ *
+ * Params: out (FILE *): Archivo de salida.
+ */
+void hprof_report(FILE *out) {
+    uint64_t total = 0;
+
+    fprintf(out, "\nHost cost per guest instruction (%" PRIu64 " samples, 1 every %" PRIu64 ") :\n",
+            SAMPLES, EVERY);
+    fprintf(out, "-------------------------------------\n");
+    if (SAMPLES == 0) {
+        fprintf(out, "no samples\n\n");
+        return;
+    }
+    for (int p = 0; p < HPROF_NPHASES; p++)
+        total += PHASE_TICKS[p];
+    for (int p = 0; p < HPROF_NPHASES; p++)
+        fprintf(out, "%-18s: %10.1f ns  (%5.1f%%)\n", PHASE_NAMES[p],
+                PHASE_TICKS[p] * NS_PER_TICK / SAMPLES, 100.0 * PHASE_TICKS[p] / total);
+    fprintf(out, "%-18s: %10.1f ns\n\n", "total", total * NS_PER_TICK / SAMPLES);
+
+    fprintf(out, "%-24s %10s %12s", "handler", "samples", "exec ns");
+    if (PERF_FD >= 0)
+        fprintf(out, " %12s %12s", "host insts", "cache miss");
+    fprintf(out, "\n");
+    for (int i = 0; i <= INSTRUCTION_SET_SIZE; i++) {
+        opcode_profile_t *op = &OPCODES[i];
+        if (op->samples == 0) continue;
+        fprintf(out, "%-24s %10" PRIu64 " %12.1f",
+                i < INSTRUCTION_SET_SIZE ? INSTRUCTION_SET[i].name : "(unknown)",
+                op->samples, op->ticks * NS_PER_TICK / op->samples);
+        if (PERF_FD >= 0)
+            fprintf(out, " %12.1f %12.3f",
+                    (double)op->counters[PERF_INSTRUCTIONS] / op->samples,
+                    (double)op->counters[PERF_CACHE_MISSES] / op->samples);
+        fprintf(out, "\n");
+    }
+    if (PERF_FD < 0)
+        fprintf(out, "(perf_event_open unavailable: host counters not reported)\n");
+    fprintf(out, "\n");
+}
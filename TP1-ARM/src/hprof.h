@@ -0,0 +1,26 @@
+/***************************************************************/
+/*                                                             */
+/*   Perfil del costo en el host de cada instruccion simulada  */
+/*                                                             */
+/***************************************************************/
+
+#ifndef _SIM_HPROF_H_
+#define _SIM_HPROF_H_
+
+#include <stdio.h>
+#include <inttypes.h>
+
+enum { HPROF_FETCH, HPROF_DECODE, HPROF_EXECUTE, HPROF_COMMIT, HPROF_NPHASES };
+
+extern int HPROF_ENABLED;   /* perfilado activo */
+extern int HPROF_ACTIVE;    /* la instruccion en curso esta muestreada */
+
+void hprof_start(uint64_t every);
+void hprof_stop();
+void hprof_begin();
+void hprof_mark(int phase);
+void hprof_execute(int index);
+void hprof_end();
+void hprof_report(FILE *out);
+
+#endif
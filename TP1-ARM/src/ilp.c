@@ -0,0 +1,370 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "shell.h"
+#include "sim.h"
+#include "ilp.h"
+#include "elfload.h"
+
+/*
+ * Camino critico del grafo de dependencias dinamico (hardware infinito).
+ *
+ * Por cada registro, por los flags y por cada palabra de memoria se guarda
+ * el ciclo en el que queda listo el valor (el de la ultima instruccion que
+ * lo produjo). Una instruccion termina en max(listo de sus fuentes) + su
+ * latencia. Solo se siguen las dependencias verdaderas (RAW): se asume
+ * renombre perfecto de registros y de memoria.
+ *
+ * Ademas se calcula el camino critico local de cada bloque basico ejecutado,
+ * considerando listos al inicio del bloque los valores producidos fuera de
+ * el; eso permite ver que bloques tienen poco paralelismo interno.
+ */
+
+#define ILP_MAX_WRITES  4
+#define ILP_TOP_BLOCKS  20
+
+enum { LAT_ALU, LAT_MUL, LAT_LOAD, LAT_STORE, LAT_BRANCH, LAT_DIV, LAT_FP, LAT_NCLASSES };
+
+static const char *LATENCY_NAMES[LAT_NCLASSES] = { "alu", "mul", "load", "store", "branch", "div", "fp" };
+static int LATENCIES[LAT_NCLASSES] = { 1, 3, 4, 1, 1, 12, 4 };
+
+typedef struct {
+    uint64_t ready;         /* ciclo global en que el valor esta listo */
+    uint64_t local_ready;   /* idem, relativo al inicio del bloque productor */
+    uint64_t block_exec;    /* ejecucion de bloque que lo produjo */
+} producer_t;
+
+typedef struct {
+    uint64_t key;           /* palabra + 1 (0 = vacio) */
+    producer_t producer;
+} word_entry_t;
+
+typedef struct {
+    uint64_t pc;            /* PC + 1 (0 = vacio) */
+    uint64_t executions;
+    uint64_t instructions;
+    uint64_t critical_path;
+} block_entry_t;
+
+int ILP_ENABLED = FALSE;
+
+static producer_t REG_PRODUCERS[EFFECT_REGISTERS];
+static producer_t FLAGS_PRODUCER;
+
+static word_entry_t *WORDS;
+static uint64_t WORDS_CAPACITY, WORDS_COUNT;
+
+static block_entry_t *BLOCKS;
+static uint64_t BLOCKS_CAPACITY, BLOCKS_COUNT;
+
+static uint64_t TOTAL_INSTRUCTIONS, CRITICAL_PATH;
+
+/* instruccion en curso */
+static int IN_INSTRUCTION;
+static uint32_t CUR_INSTRUCTION, CUR_EFFECTS;
+static uint64_t CUR_READY, CUR_LOCAL_READY;
+static producer_t CUR_BASE;         /* productor de Rn si hay writeback */
+static uint64_t CUR_WRITES[ILP_MAX_WRITES];
+static int CUR_NWRITES;
+
+/* bloque basico en curso */
+static int BLOCK_OPEN;
+static uint64_t BLOCK_PC, BLOCK_EXEC, BLOCK_INSTRUCTIONS, BLOCK_CRITICAL_PATH;
+
+
+static uint64_t hash_key(uint64_t key, uint64_t capacity) {
+    return (key * 0x9E3779B97F4A7C15ULL) >> 32 & (capacity - 1);
+}
+
+static word_entry_t *find_word(uint64_t key) {
+    uint64_t i = hash_key(key, WORDS_CAPACITY);
+    while (WORDS[i].key != 0 && WORDS[i].key != key)
+        i = (i + 1) & (WORDS_CAPACITY - 1);
+    return &WORDS[i];
+}
+
+static void grow_words() {
+    word_entry_t *old = WORDS;
+    uint64_t old_capacity = WORDS_CAPACITY;
+
+    WORDS_CAPACITY *= 2;
+    WORDS = calloc(WORDS_CAPACITY, sizeof(word_entry_t));
+    for (uint64_t i = 0; i < old_capacity; i++)
+        if (old[i].key != 0)
+            *find_word(old[i].key) = old[i];
+    free(old);
+}
+
+static block_entry_t *find_block(uint64_t pc) {
+    uint64_t i = hash_key(pc, BLOCKS_CAPACITY);
+    while (BLOCKS[i].pc != 0 && BLOCKS[i].pc != pc)
+        i = (i + 1) & (BLOCKS_CAPACITY - 1);
+    return &BLOCKS[i];
+}
+
+static void grow_blocks() {
+    block_entry_t *old = BLOCKS;
+    uint64_t old_capacity = BLOCKS_CAPACITY;
+
+    BLOCKS_CAPACITY *= 2;
+    BLOCKS = calloc(BLOCKS_CAPACITY, sizeof(block_entry_t));
+    for (uint64_t i = 0; i < old_capacity; i++)
+        if (old[i].pc != 0)
+            *find_block(old[i].pc) = old[i];
+    free(old);
+}
+
+/**
+ * Incorpora un valor producido antes como fuente de la instruccion en curso.
+ * Si lo produjo otro bloque, para el camino local cuenta como listo en 0.
+ */
+static void add_source(const producer_t *p) {
+    if (p->ready > CUR_READY)
+        CUR_READY = p->ready;
+    if (p->block_exec == BLOCK_EXEC && p->local_ready > CUR_LOCAL_READY)
+        CUR_LOCAL_READY = p->local_ready;
+}
+
+static int latency_class(uint32_t effects) {
+    if (effects & EFFECT_LOAD) return LAT_LOAD;
+    if (effects & EFFECT_STORE) return LAT_STORE;
+    if (effects & EFFECT_MULTIPLY) return LAT_MUL;
+    if (effects & EFFECT_DIVIDE) return LAT_DIV;
+    if (effects & EFFECT_BRANCH) return LAT_BRANCH;
+    if (effects & EFFECT_FP) return LAT_FP;
+    return LAT_ALU;
+}
+
+static void close_block() {
+    block_entry_t *b = find_block(BLOCK_PC + 1);
+
+    if (b->pc == 0) {
+        b->pc = BLOCK_PC + 1;
+        if (++BLOCKS_COUNT * 2 > BLOCKS_CAPACITY) {
+            grow_blocks();
+            b = find_block(BLOCK_PC + 1);
+        }
+    }
+    b->executions++;
+    b->instructions += BLOCK_INSTRUCTIONS;
+    b->critical_path += BLOCK_CRITICAL_PATH;
+    BLOCK_OPEN = FALSE;
+}
+
+
+/**
+ * Descarta los resultados anteriores y empieza a seguir dependencias.
+ */
+void ilp_start() {
+    free(WORDS);
+    free(BLOCKS);
+    WORDS_CAPACITY = 1024;
+    WORDS_COUNT = 0;
+    WORDS = calloc(WORDS_CAPACITY, sizeof(word_entry_t));
+    BLOCKS_CAPACITY = 256;
+    BLOCKS_COUNT = 0;
+    BLOCKS = calloc(BLOCKS_CAPACITY, sizeof(block_entry_t));
+
+    memset(REG_PRODUCERS, 0, sizeof(REG_PRODUCERS));
+    memset(&FLAGS_PRODUCER, 0, sizeof(FLAGS_PRODUCER));
+    TOTAL_INSTRUCTIONS = 0;
+    CRITICAL_PATH = 0;
+    BLOCK_OPEN = FALSE;
+    BLOCK_EXEC = 0;
+    IN_INSTRUCTION = FALSE;
+    ILP_ENABLED = TRUE;
+}
+
+
+/**
+ * Deja de seguir dependencias. El bloque en curso se cuenta hasta aca.
+ */
+void ilp_stop() {
+    if (ILP_ENABLED && BLOCK_OPEN)
+        close_block();
+    ILP_ENABLED = FALSE;
+}
+
+
+/**
+ * Cambia la latencia de una clase de instrucciones.
+ *
+ * Params: class_name (const char *): alu, mul, load, store, branch, div o fp.
+ *         cycles (int): Latencia en ciclos (>= 1).
+ *
+ * Returns: int: TRUE si la clase existe y la latencia es valida.
+ */
+int ilp_set_latency(const char *class_name, int cycles) {
+    if (cycles < 1)
+        return FALSE;
+    for (int i = 0; i < LAT_NCLASSES; i++) {
+        if (strcmp(class_name, LATENCY_NAMES[i]) == 0) {
+            LATENCIES[i] = cycles;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+
+/**
+ * Se llama antes de ejecutar una instruccion: calcula cuando estan
+ * listas sus fuentes de registros y flags.
+ *
+ * Params: instruction (uint32_t): Instruccion codificada en 32 bits.
+ *         effects (uint32_t): Efectos EFFECT_* de la instruccion.
+ */
+void ilp_begin(uint32_t instruction, uint32_t effects) {
+    if (!BLOCK_OPEN) {
+        BLOCK_OPEN = TRUE;
+        BLOCK_PC = CURRENT_STATE.PC;
+        BLOCK_EXEC++;
+        BLOCK_INSTRUCTIONS = 0;
+        BLOCK_CRITICAL_PATH = 0;
+    }
+
+    IN_INSTRUCTION = TRUE;
+    CUR_INSTRUCTION = instruction;
+    CUR_EFFECTS = effects;
+    CUR_READY = 0;
+    CUR_LOCAL_READY = 0;
+    CUR_NWRITES = 0;
+
+    int regs[EFFECT_MAX_REGISTERS];
+    int n = effect_sources(instruction, effects, regs);
+    for (int i = 0; i < n; i++)
+        add_source(&REG_PRODUCERS[regs[i]]);
+    if (effects & EFFECT_WRITEBACK)
+        CUR_BASE = REG_PRODUCERS[(instruction >> 5) & 0x1F];
+    if (effects & EFFECT_READS_FLAGS)
+        add_source(&FLAGS_PRODUCER);
+}
+
+
+/**
+ * Lectura de memoria de la instruccion en curso: depende del ultimo
+ * store a esa palabra.
+ *
+ * Params: address (uint64_t): Direccion leida.
+ */
+void ilp_mem_read(uint64_t address) {
+    if (!IN_INSTRUCTION)
+        return;
+    word_entry_t *w = find_word((address >> 2) + 1);
+    if (w->key != 0)
+        add_source(&w->producer);
+}
+
+
+/**
+ * Escritura de memoria de la instruccion en curso. La palabra queda
+ * producida por esta instruccion cuando termina (ilp_end).
+ *
+ * Params: address (uint64_t): Direccion escrita.
+ */
+void ilp_mem_write(uint64_t address) {
+    if (IN_INSTRUCTION && CUR_NWRITES < ILP_MAX_WRITES)
+        CUR_WRITES[CUR_NWRITES++] = address >> 2;
+}
+
+
+/**
+ * Se llama despues de ejecutar la instruccion: registra cuando quedan
+ * listos sus resultados y cierra el bloque basico si fue un salto o HLT.
+ */
+void ilp_end() {
+    if (!IN_INSTRUCTION)
+        return;
+    IN_INSTRUCTION = FALSE;
+
+    int latency = LATENCIES[latency_class(CUR_EFFECTS)];
+    producer_t result = { CUR_READY + latency, CUR_LOCAL_READY + latency, BLOCK_EXEC };
+
+    int regs[EFFECT_MAX_REGISTERS];
+    int n = effect_destinations(CUR_INSTRUCTION, CUR_EFFECTS, regs);
+    for (int i = 0; i < n; i++)
+        REG_PRODUCERS[regs[i]] = result;
+    uint32_t rn = (CUR_INSTRUCTION >> 5) & 0x1F;
+    if ((CUR_EFFECTS & EFFECT_WRITEBACK) && rn != 31) {
+        /* la base nueva solo depende de la vieja: una suma */
+        producer_t base = { CUR_BASE.ready + LATENCIES[LAT_ALU],
+                            (CUR_BASE.block_exec == BLOCK_EXEC ? CUR_BASE.local_ready : 0) + LATENCIES[LAT_ALU],
+                            BLOCK_EXEC };
+        REG_PRODUCERS[rn] = base;
+    }
+    if (CUR_EFFECTS & EFFECT_SETS_FLAGS)
+        FLAGS_PRODUCER = result;
+    for (int i = 0; i < CUR_NWRITES; i++) {
+        uint64_t key = CUR_WRITES[i] + 1;
+        word_entry_t *w = find_word(key);
+        if (w->key == 0) {
+            w->key = key;
+            if (++WORDS_COUNT * 2 > WORDS_CAPACITY) {
+                grow_words();
+                w = find_word(key);
+            }
+        }
+        w->producer = result;
+    }
+
+    TOTAL_INSTRUCTIONS++;
+    if (result.ready > CRITICAL_PATH)
+        CRITICAL_PATH = result.ready;
+    BLOCK_INSTRUCTIONS++;
+    if (result.local_ready > BLOCK_CRITICAL_PATH)
+        BLOCK_CRITICAL_PATH = result.local_ready;
+
+    if ((CUR_EFFECTS & EFFECT_BRANCH) || RUN_BIT == FALSE)
+        close_block();
+}
+
+static int compare_blocks(const void *a, const void *b) {
+    const block_entry_t *x = *(block_entry_t * const *)a, *y = *(block_entry_t * const *)b;
+    return (y->instructions > x->instructions) - (y->instructions < x->instructions);
+}
+
+
+/**
+ * Imprime el camino critico del programa completo y de los bloques
+ * basicos con mas instrucciones ejecutadas.
+ *
+ * Params: out (FILE *): Archivo de salida.
+ */
+void ilp_report(FILE *out) {
+    block_entry_t **sorted;
+    uint64_t n = 0;
+
+    fprintf(out, "\nDataflow critical path :\n");
+    fprintf(out, "-------------------------------------\n");
+    fprintf(out, "Latencies         :");
+    for (int i = 0; i < LAT_NCLASSES; i++)
+        fprintf(out, " %s=%d", LATENCY_NAMES[i], LATENCIES[i]);
+    fprintf(out, "\n");
+    fprintf(out, "Instructions      : %" PRIu64 "\n", TOTAL_INSTRUCTIONS);
+    fprintf(out, "Critical path     : %" PRIu64 " cycles\n", CRITICAL_PATH);
+    if (CRITICAL_PATH == 0) {
+        fprintf(out, "\n");
+        return;
+    }
+    fprintf(out, "Ideal IPC         : %.3f\n\n", (double)TOTAL_INSTRUCTIONS / CRITICAL_PATH);
+
+    sorted = malloc(BLOCKS_COUNT * sizeof(block_entry_t *));
+    for (uint64_t i = 0; i < BLOCKS_CAPACITY; i++)
+        if (BLOCKS[i].pc != 0)
+            sorted[n++] = &BLOCKS[i];
+    qsort(sorted, n, sizeof(block_entry_t *), compare_blocks);
+
+    fprintf(out, "%12s %12s %10s %10s %8s\n", "block", "executions", "insts/exec", "path/exec", "IPC");
+    for (uint64_t i = 0; i < n && i < ILP_TOP_BLOCKS; i++) {
+        block_entry_t *b = sorted[i];
+        fprintf(out, "  0x%08" PRIx64 " %12" PRIu64 " %10.2f %10.2f %8.3f",
+                b->pc - 1, b->executions,
+                (double)b->instructions / b->executions,
+                (double)b->critical_path / b->executions,
+                b->critical_path ? (double)b->instructions / b->critical_path : 0.0);
+        elf_print_address(out, b->pc - 1);
+        fprintf(out, "\n");
+    }
+    fprintf(out, "\n");
+    free(sorted);
+}
@@ -0,0 +1,24 @@
+/***************************************************************/
+/*                                                             */
+/*   Analisis del camino critico dinamico (limite de ILP)      */
+/*                                                             */
+/***************************************************************/
+
+#ifndef _SIM_ILP_H_
+#define _SIM_ILP_H_
+
+#include <stdio.h>
+#include <inttypes.h>
+
+extern int ILP_ENABLED;
+
+void ilp_start();
+void ilp_stop();
+int  ilp_set_latency(const char *class_name, int cycles);
+void ilp_begin(uint32_t instruction, uint32_t effects);
+void ilp_mem_read(uint64_t address);
+void ilp_mem_write(uint64_t address);
+void ilp_end();
+void ilp_report(FILE *out);
+
+#endif
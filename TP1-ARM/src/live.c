@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "shell.h"
+#include "sim.h"
+#include "live.h"
+#include "fpu.h"
+
+/*
+ * Los contadores se acumulan en memoria privada del simulador y se
+ * copian a la pagina compartida cada PUBLISH_EVERY instrucciones (y al
+ * ejecutar HLT), asi el ciclo no escribe en una linea que otro proceso
+ * esta leyendo.
+ */
+
+#define PUBLISH_EVERY   (1 << 16)
+
+int LIVE_ENABLED = FALSE;
+
+static live_page_t *PAGE;
+static char PATH[64];
+static uint64_t COUNTDOWN;
+static uint64_t OPCODES[LIVE_MAX_OPCODES];
+static uint64_t MEM_READS, MEM_WRITES;
+static uint64_t LAST_INSTRUCTIONS;
+static double LAST_TIME;
+
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#define STORE(field, value) __atomic_store_n(&PAGE->field, (value), __ATOMIC_RELAXED)
+
+/**
+ * Copia los contadores a la pagina compartida dentro del seqlock.
+ */
+static void publish() {
+    double t = now();
+    uint64_t ips = t > LAST_TIME ? (INSTRUCTION_COUNT - LAST_INSTRUCTIONS) / (t - LAST_TIME) : 0;
+    uint32_t sequence = PAGE->sequence;
+
+    LAST_TIME = t;
+    LAST_INSTRUCTIONS = INSTRUCTION_COUNT;
+
+    __atomic_store_n(&PAGE->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    STORE(running, RUN_BIT);
+    STORE(instructions, INSTRUCTION_COUNT);
+    STORE(instructions_per_second, ips);
+    STORE(pc, CURRENT_STATE.PC);
+    STORE(mem_reads, MEM_READS);
+    STORE(mem_writes, MEM_WRITES);
+    for (uint32_t i = 0; i < PAGE->nopcodes; i++)
+        STORE(opcodes[i], OPCODES[i]);
+    __atomic_store_n(&PAGE->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+
+/**
+ * Crea la pagina compartida y empieza a publicar.
+ *
+ * Params: name (const char *): Nombre del objeto en /dev/shm, o NULL
+ *                              para usar "arm-sim.<pid>".
+ *
+ * Returns: int: TRUE si la pagina quedo creada.
+ */
+int live_start(const char *name) {
+    int fd, n = INSTRUCTION_SET_SIZE + 1;
+
+    if (LIVE_ENABLED)
+        live_stop();
+    if (name)
+        snprintf(PATH, sizeof(PATH), "/%s", name[0] == '/' ? name + 1 : name);
+    else
+        snprintf(PATH, sizeof(PATH), "/arm-sim.%d", (int)getpid());
+
+    fd = shm_open(PATH, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror(PATH);
+        return FALSE;
+    }
+    if (ftruncate(fd, sizeof(live_page_t)) != 0) {
+        perror(PATH);
+        close(fd);
+        shm_unlink(PATH);
+        return FALSE;
+    }
+    PAGE = mmap(NULL, sizeof(live_page_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (PAGE == MAP_FAILED) {
+        perror(PATH);
+        shm_unlink(PATH);
+        PAGE = NULL;
+        return FALSE;
+    }
+
+    if (n > LIVE_MAX_OPCODES)
+        n = LIVE_MAX_OPCODES;
+    PAGE->version = LIVE_VERSION;
+    PAGE->nopcodes = n;
+    PAGE->pid = getpid();
+    for (int i = 0; i < n - 1; i++)
+        snprintf(PAGE->names[i], LIVE_NAME_LENGTH, "%s", INSTRUCTION_SET[i].name);
+    snprintf(PAGE->names[n - 1], LIVE_NAME_LENGTH, "(unknown)");
+
+    memset(OPCODES, 0, sizeof(OPCODES));
+    MEM_READS = MEM_WRITES = 0;
+    LAST_INSTRUCTIONS = INSTRUCTION_COUNT;
+    LAST_TIME = now();
+    COUNTDOWN = PUBLISH_EVERY;
+    publish();
+    /* el lector no acepta la pagina hasta ver el magic */
+    __atomic_store_n(&PAGE->magic, LIVE_MAGIC, __ATOMIC_RELEASE);
+
+    LIVE_ENABLED = TRUE;
+    printf("Live counters at /dev/shm%s\n", PATH);
+    return TRUE;
+}
+
+
+/**
+ * Deja de publicar y borra la pagina compartida.
+ */
+void live_stop() {
+    if (!LIVE_ENABLED)
+        return;
+    LIVE_ENABLED = FALSE;
+    __atomic_store_n(&PAGE->running, FALSE, __ATOMIC_RELAXED);
+    munmap(PAGE, sizeof(live_page_t));
+    PAGE = NULL;
+    shm_unlink(PATH);
+}
+
+
+/**
+ * Cuenta una instruccion ejecutada.
+ *
+ * Params: index (int): Indice en INSTRUCTION_SET, o -1 si no se reconocio.
+ */
+void live_count(int index) {
+    if (index < 0 || index >= (int)PAGE->nopcodes - 1)
+        index = PAGE->nopcodes - 1;
+    OPCODES[index]++;
+}
+
+
+/**
+ * Cuenta un acceso a datos.
+ *
+ * Params: is_write (int): TRUE si es una escritura.
+ */
+void live_mem_access(int is_write) {
+    if (is_write)
+        MEM_WRITES++;
+    else
+        MEM_READS++;
+}
+
+
+/**
+ * Fin de ciclo: publica cada PUBLISH_EVERY instrucciones y al detenerse.
+ */
+void live_tick() {
+    if (--COUNTDOWN == 0 || RUN_BIT == FALSE) {
+        COUNTDOWN = PUBLISH_EVERY;
+        fpu_host_enter();
+        publish();
+        fpu_host_leave();
+    }
+}
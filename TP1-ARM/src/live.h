@@ -0,0 +1,53 @@
+/***************************************************************/
+/*                                                             */
+/*   Contadores en vivo en memoria compartida                  */
+/*                                                             */
+/*   El simulador publica una pagina en /dev/shm que simtop    */
+/*   lee sin detenerlo. Los campos bajo `sequence` forman un   */
+/*   seqlock: el escritor la deja impar mientras actualiza, y  */
+/*   el lector reintenta si la ve impar o si cambio al final.  */
+/*                                                             */
+/***************************************************************/
+
+#ifndef _SIM_LIVE_H_
+#define _SIM_LIVE_H_
+
+#include <inttypes.h>
+
+#define LIVE_MAGIC          0x4556494CU     /* "LIVE" */
+#define LIVE_VERSION        1
+#define LIVE_MAX_OPCODES    256
+#define LIVE_NAME_LENGTH    24
+
+typedef struct {
+    /* escritos una vez al crear la pagina */
+    uint32_t magic;
+    uint32_t version;
+    uint32_t nopcodes;                      /* el ultimo es "(unknown)" */
+    uint32_t pid;
+    char names[LIVE_MAX_OPCODES][LIVE_NAME_LENGTH];
+
+    /* protegidos por el seqlock */
+    uint32_t sequence;
+    uint32_t running;
+    uint64_t instructions;
+    uint64_t instructions_per_second;
+    uint64_t pc;
+    uint64_t mem_reads;
+    uint64_t mem_writes;
+    uint64_t opcodes[LIVE_MAX_OPCODES];
+} live_page_t;
+
+#ifndef SIMTOP
+
+extern int LIVE_ENABLED;
+
+int  live_start(const char *name);
+void live_stop();
+void live_count(int index);
+void live_mem_access(int is_write);
+void live_tick();
+
+#endif
+
+#endif
@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "shell.h"
+#include "sim.h"
+#include "loader.h"
+
+/*
+ * Cargador de archivos .x: una palabra hexadecimal por linea (se aceptan
+ * varias separadas por blancos y el prefijo 0x, como con fscanf("%x")).
+ *
+ * El archivo se mapea entero y cada digito se convierte con una tabla de
+ * 256 entradas; el caso comun de 8 digitos se resuelve con 8 lecturas de
+ * la tabla y una sola verificacion. Las palabras se escriben directamente
+ * en la memoria del segmento de texto, sin pasar por mem_write_32.
+ */
+
+#define INVALID 0xFF
+
+/* valor de cada digito hexadecimal, INVALID para el resto (loader_init) */
+static uint8_t HEX_VALUE[256];
+
+static int is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+static mem_region_t *text_region() {
+    for (int i = 0; i < MEM_NREGIONS; i++)
+        if (MEM_REGIONS[i].start == MEM_TEXT_START)
+            return &MEM_REGIONS[i];
+    return NULL;
+}
+
+/**
+ * Arma la tabla de digitos hexadecimales.
+ */
+void loader_init() {
+    memset(HEX_VALUE, INVALID, sizeof(HEX_VALUE));
+    for (int d = 0; d < 10; d++)
+        HEX_VALUE['0' + d] = d;
+    for (int d = 0; d < 6; d++)
+        HEX_VALUE['a' + d] = HEX_VALUE['A' + d] = 10 + d;
+}
+
+
+static void syntax_error(const char *path, int line, const char *line_start, const char *p,
+                         const char *message) {
+    printf("Error: %s:%d:%d: %s\n", path, line, (int)(p - line_start) + 1, message);
+}
+
+
+/**
+ * Carga un archivo .x en el segmento de texto.
+ *
+ * Params: path (const char *): Archivo a cargar.
+ *
+ * Returns: int64_t: Cantidad de palabras cargadas, o -1 si hubo un error
+ *                   (ya informado, con linea y columna).
+ */
+int64_t load_hex_image(const char *path) {
+    mem_region_t *text = text_region();
+    struct stat st;
+    const char *data, *p, *end, *line_start;
+    uint64_t words = 0;
+    int line = 1, fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        printf("Error: Can't open program file %s\n", path);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        printf("Error: Can't map program file %s\n", path);
+        return -1;
+    }
+    madvise((void *)data, st.st_size, MADV_SEQUENTIAL);
+
+    p = line_start = data;
+    end = data + st.st_size;
+    while (p < end) {
+        uint32_t word = 0;
+        int digits = 0;
+        uint8_t d;
+
+        if (is_blank(*p)) {
+            if (*p == '\n') {
+                line++;
+                line_start = p + 1;
+            }
+            p++;
+            continue;
+        }
+
+        if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X') && HEX_VALUE[(uint8_t)p[2]] != INVALID)
+            p += 2;
+
+        /* caso comun: 8 digitos seguidos */
+        if (end - p >= 8) {
+            uint8_t d0 = HEX_VALUE[(uint8_t)p[0]], d1 = HEX_VALUE[(uint8_t)p[1]];
+            uint8_t d2 = HEX_VALUE[(uint8_t)p[2]], d3 = HEX_VALUE[(uint8_t)p[3]];
+            uint8_t d4 = HEX_VALUE[(uint8_t)p[4]], d5 = HEX_VALUE[(uint8_t)p[5]];
+            uint8_t d6 = HEX_VALUE[(uint8_t)p[6]], d7 = HEX_VALUE[(uint8_t)p[7]];
+            if ((d0 | d1 | d2 | d3 | d4 | d5 | d6 | d7) < 16) {
+                word = (uint32_t)d0 << 28 | (uint32_t)d1 << 24 | (uint32_t)d2 << 20 | (uint32_t)d3 << 16 |
+                       (uint32_t)d4 << 12 | (uint32_t)d5 << 8 | (uint32_t)d6 << 4 | d7;
+                digits = 8;
+                p += 8;
+            }
+        }
+        for (; p < end && (d = HEX_VALUE[(uint8_t)*p]) != INVALID; p++) {
+            if (++digits > 8) {
+                syntax_error(path, line, line_start, p, "more than 8 hex digits in a word");
+                goto fail;
+            }
+            word = word << 4 | d;
+        }
+        if (digits == 0 || (p < end && !is_blank(*p))) {
+            char message[64];
+            snprintf(message, sizeof(message), isprint((unsigned char)*p) ?
+                     "unexpected character '%c'" : "unexpected character 0x%02x", (unsigned char)*p);
+            syntax_error(path, line, line_start, p, message);
+            goto fail;
+        }
+
+        if (4 * words + 4 > text->size) {
+            syntax_error(path, line, line_start, p, "program does not fit in the text segment");
+            goto fail;
+        }
+        text->mem[4 * words + 0] = word >> 0;
+        text->mem[4 * words + 1] = word >> 8;
+        text->mem[4 * words + 2] = word >> 16;
+        text->mem[4 * words + 3] = word >> 24;
+        words++;
+    }
+
+    munmap((void *)data, st.st_size);
+    predecode_reset();
+    return words;
+
+fail:
+    munmap((void *)data, st.st_size);
+    predecode_reset();
+    return -1;
+}
@@ -0,0 +1,15 @@
+/***************************************************************/
+/*                                                             */
+/*   Carga de imagenes de programa                             */
+/*                                                             */
+/***************************************************************/
+
+#ifndef _SIM_LOADER_H_
+#define _SIM_LOADER_H_
+
+#include <inttypes.h>
+
+void    loader_init();
+int64_t load_hex_image(const char *path);
+
+#endif
@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "shell.h"
+#include "dirty.h"
+#include "memdiff.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/*
+ * La marca copia toda la memoria y toma una epoca de dirty.c. El diff
+ * solo compara las paginas escritas desde esa epoca, 32 bytes (AVX2) o
+ * 16 bytes (SSE2) por comparacion, y arma los rangos de palabras de 32
+ * bits que cambiaron.
+ */
+
+#define MAX_RANGES_SHOWN 64
+#define PAGE_WORDS (DIRTY_PAGE_SIZE / 4)
+
+static int MARKED;
+static uint32_t EPOCH;
+static uint8_t *COPY[MEM_NREGIONS];
+
+/* Bits de palabras distintas de una pagina, 1 por palabra. */
+typedef void (*page_compare_fn)(const uint8_t *a, const uint8_t *b, uint64_t changed[PAGE_WORDS / 64]);
+
+
+static void compare_page_scalar(const uint8_t *a, const uint8_t *b, uint64_t changed[PAGE_WORDS / 64]) {
+    const uint32_t *x = (const uint32_t *)a, *y = (const uint32_t *)b;
+
+    memset(changed, 0, PAGE_WORDS / 8);
+    for (int w = 0; w < PAGE_WORDS; w++)
+        if (x[w] != y[w])
+            changed[w >> 6] |= 1ULL << (w & 63);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+static void compare_page_sse2(const uint8_t *a, const uint8_t *b, uint64_t changed[PAGE_WORDS / 64]) {
+    memset(changed, 0, PAGE_WORDS / 8);
+    for (int w = 0; w < PAGE_WORDS; w += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(a + 4 * w));
+        __m128i y = _mm_loadu_si128((const __m128i *)(b + 4 * w));
+        uint64_t equal = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(x, y)));
+        changed[w >> 6] |= (~equal & 0xF) << (w & 63);
+    }
+}
+
+__attribute__((target("avx2")))
+static void compare_page_avx2(const uint8_t *a, const uint8_t *b, uint64_t changed[PAGE_WORDS / 64]) {
+    memset(changed, 0, PAGE_WORDS / 8);
+    for (int w = 0; w < PAGE_WORDS; w += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + 4 * w));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(b + 4 * w));
+        uint64_t equal = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(x, y)));
+        changed[w >> 6] |= (~equal & 0xFF) << (w & 63);
+    }
+}
+#endif
+
+static page_compare_fn select_compare() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return compare_page_avx2;
+    if (__builtin_cpu_supports("sse2"))
+        return compare_page_sse2;
+#endif
+    return compare_page_scalar;
+}
+
+static uint32_t word_at(const uint8_t *mem, uint64_t offset) {
+    uint32_t value;
+    memcpy(&value, mem + offset, 4);
+    return value;
+}
+
+
+/**
+ * Marca el estado actual de la memoria como referencia del diff.
+ */
+void memdiff_mark() {
+    if (!MARKED)
+        dirty_acquire();
+    for (int r = 0; r < MEM_NREGIONS; r++) {
+        if (COPY[r] == NULL)
+            COPY[r] = malloc(MEM_REGIONS[r].size);
+        memcpy(COPY[r], MEM_REGIONS[r].mem, MEM_REGIONS[r].size);
+    }
+    EPOCH = dirty_advance();
+    MARKED = TRUE;
+}
+
+
+/* Rango de palabras consecutivas que cambiaron. */
+typedef struct {
+    int region;
+    uint64_t start, end;        /* offsets de la primera y la ultima palabra */
+} range_t;
+
+static void print_range(FILE *out, range_t *range) {
+    uint64_t base = MEM_REGIONS[range->region].start;
+    uint64_t count = (range->end - range->start) / 4 + 1;
+
+    fprintf(out, "  0x%08" PRIx64 "..0x%08" PRIx64 " (%" PRIu64 " words)",
+            base + range->start, base + range->end + 3, count);
+    if (count == 1)
+        fprintf(out, " : 0x%x -> 0x%x", word_at(COPY[range->region], range->start),
+                word_at(MEM_REGIONS[range->region].mem, range->start));
+    fprintf(out, "\n");
+}
+
+
+/**
+ * Imprime los rangos de palabras que cambiaron desde la marca.
+ *
+ * Params: out (FILE *): Archivo de salida.
+ */
+void memdiff_report(FILE *out) {
+    static page_compare_fn compare;
+    uint64_t changed[PAGE_WORDS / 64];
+    uint64_t pages = 0, words = 0, ranges = 0;
+    range_t range = { -1, 0, 0 };
+
+    fprintf(out, "\nMemory changed since mark :\n");
+    fprintf(out, "-------------------------------------\n");
+    if (!MARKED) {
+        fprintf(out, "no mark: use 'snapshot mark' first\n\n");
+        return;
+    }
+    if (compare == NULL)
+        compare = select_compare();
+
+    for (int r = 0; r < MEM_NREGIONS; r++) {
+        for (uint64_t p = 0; p < dirty_pages(r); p++) {
+            uint64_t base = p * DIRTY_PAGE_SIZE;
+            if (!dirty_since(r, p, EPOCH))
+                continue;
+            pages++;
+            compare(MEM_REGIONS[r].mem + base, COPY[r] + base, changed);
+            for (int i = 0; i < PAGE_WORDS / 64; i++) {
+                for (uint64_t bits = changed[i]; bits; bits &= bits - 1) {
+                    uint64_t offset = base + 4 * (i * 64 + __builtin_ctzll(bits));
+                    words++;
+                    if (range.region == r && range.end + 4 == offset) {
+                        range.end = offset;
+                        continue;
+                    }
+                    if (range.region >= 0 && ranges++ < MAX_RANGES_SHOWN)
+                        print_range(out, &range);
+                    range.region = r;
+                    range.start = range.end = offset;
+                }
+            }
+        }
+    }
+    if (range.region >= 0 && ranges++ < MAX_RANGES_SHOWN)
+        print_range(out, &range);
+
+    if (ranges > MAX_RANGES_SHOWN)
+        fprintf(out, "  ... %" PRIu64 " more ranges\n", ranges - MAX_RANGES_SHOWN);
+    fprintf(out, "%" PRIu64 " words changed in %" PRIu64 " ranges (%" PRIu64 " pages written)\n\n",
+            words, ranges, pages);
+}
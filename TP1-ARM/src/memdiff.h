@@ -0,0 +1,15 @@
+/***************************************************************/
+/*                                                             */
+/*   Diferencias de memoria contra una marca                   */
+/*                                                             */
+/***************************************************************/
+
+#ifndef _SIM_MEMDIFF_H_
+#define _SIM_MEMDIFF_H_
+
+#include <stdio.h>
+
+void memdiff_mark();
+void memdiff_report(FILE *out);
+
+#endif
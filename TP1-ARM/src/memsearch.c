@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "shell.h"
+#include "memsearch.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/*
+ * Las busquedas recorren directamente la memoria de cada region de
+ * MEM_REGIONS (la memoria simulada es little-endian, igual que el host).
+ *
+ * - Secuencia de bytes: se comparan a la vez el primer y el ultimo byte
+ *   del patron contra 32 (AVX2) o 16 (SSE2) posiciones, y solo las
+ *   candidatas que coinciden en ambos se verifican con memcmp.
+ * - Valor enmascarado de 32 bits, en direcciones alineadas a 4: AND con
+ *   la mascara y comparacion de 8 o 4 palabras por instruccion.
+ *
+ * El resultado de la ultima busqueda queda guardado para el reporte.
+ */
+
+#define MAX_MATCHES_SHOWN 256
+
+static uint64_t *MATCHES;
+static uint64_t NMATCHES, CAPACITY;
+static char DESCRIPTION[128];
+
+/* region y alineacion de la busqueda en curso */
+static uint64_t BASE;
+static int ALIGNMENT;
+
+typedef void (*scan_bytes_fn)(const uint8_t *mem, uint64_t size, const uint8_t *pattern, int length);
+typedef void (*scan_masked_fn)(const uint8_t *mem, uint64_t size, uint32_t value, uint32_t mask);
+
+
+static void add_match(uint64_t offset) {
+    if ((BASE + offset) % ALIGNMENT != 0)
+        return;
+    if (NMATCHES == CAPACITY) {
+        CAPACITY = CAPACITY ? 2 * CAPACITY : 1024;
+        MATCHES = realloc(MATCHES, CAPACITY * sizeof(uint64_t));
+    }
+    MATCHES[NMATCHES++] = BASE + offset;
+}
+
+static void check_candidate(const uint8_t *mem, uint64_t offset, const uint8_t *pattern, int length) {
+    if (memcmp(mem + offset, pattern, length) == 0)
+        add_match(offset);
+}
+
+static void scan_bytes_scalar(const uint8_t *mem, uint64_t size, const uint8_t *pattern, int length) {
+    for (uint64_t i = 0; i + length <= size; i++)
+        if (mem[i] == pattern[0])
+            check_candidate(mem, i, pattern, length);
+}
+
+static void scan_masked_scalar(const uint8_t *mem, uint64_t size, uint32_t value, uint32_t mask) {
+    for (uint64_t i = 0; i + 4 <= size; i += 4) {
+        uint32_t word;
+        memcpy(&word, mem + i, 4);
+        if ((word & mask) == value)
+            add_match(i);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+static void scan_bytes_sse2(const uint8_t *mem, uint64_t size, const uint8_t *pattern, int length) {
+    __m128i first = _mm_set1_epi8(pattern[0]), last = _mm_set1_epi8(pattern[length - 1]);
+    uint64_t i = 0;
+
+    for (; i + length - 1 + 16 <= size; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(mem + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(mem + i + length - 1));
+        uint32_t candidates = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first),
+                                                               _mm_cmpeq_epi8(b, last)));
+        for (; candidates; candidates &= candidates - 1)
+            check_candidate(mem, i + __builtin_ctz(candidates), pattern, length);
+    }
+    BASE += i;
+    scan_bytes_scalar(mem + i, size - i, pattern, length);
+    BASE -= i;
+}
+
+__attribute__((target("avx2")))
+static void scan_bytes_avx2(const uint8_t *mem, uint64_t size, const uint8_t *pattern, int length) {
+    __m256i first = _mm256_set1_epi8(pattern[0]), last = _mm256_set1_epi8(pattern[length - 1]);
+    uint64_t i = 0;
+
+    for (; i + length - 1 + 32 <= size; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(mem + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(mem + i + length - 1));
+        uint32_t candidates = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first),
+                                                                    _mm256_cmpeq_epi8(b, last)));
+        for (; candidates; candidates &= candidates - 1)
+            check_candidate(mem, i + __builtin_ctz(candidates), pattern, length);
+    }
+    /* el resto, con la base desplazada para que add_match vea la direccion real */
+    BASE += i;
+    scan_bytes_scalar(mem + i, size - i, pattern, length);
+    BASE -= i;
+}
+
+static void scan_masked_sse2(const uint8_t *mem, uint64_t size, uint32_t value, uint32_t mask) {
+    __m128i v = _mm_set1_epi32(value), m = _mm_set1_epi32(mask);
+    uint64_t i = 0;
+
+    for (; i + 16 <= size; i += 16) {
+        __m128i x = _mm_and_si128(_mm_loadu_si128((const __m128i *)(mem + i)), m);
+        uint32_t hits = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(x, v)));
+        for (; hits; hits &= hits - 1)
+            add_match(i + 4 * __builtin_ctz(hits));
+    }
+    BASE += i;
+    scan_masked_scalar(mem + i, size - i, value, mask);
+    BASE -= i;
+}
+
+__attribute__((target("avx2")))
+static void scan_masked_avx2(const uint8_t *mem, uint64_t size, uint32_t value, uint32_t mask) {
+    __m256i v = _mm256_set1_epi32(value), m = _mm256_set1_epi32(mask);
+    uint64_t i = 0;
+
+    for (; i + 32 <= size; i += 32) {
+        __m256i x = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(mem + i)), m);
+        uint32_t hits = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(x, v)));
+        for (; hits; hits &= hits - 1)
+            add_match(i + 4 * __builtin_ctz(hits));
+    }
+    BASE += i;
+    scan_masked_scalar(mem + i, size - i, value, mask);
+    BASE -= i;
+}
+#endif
+
+static int has_avx2() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return FALSE;
+#endif
+}
+
+static scan_bytes_fn select_scan_bytes() {
+#if defined(__x86_64__) || defined(__i386__)
+    return has_avx2() ? scan_bytes_avx2 : scan_bytes_sse2;
+#else
+    return scan_bytes_scalar;
+#endif
+}
+
+static scan_masked_fn select_scan_masked() {
+#if defined(__x86_64__) || defined(__i386__)
+    return has_avx2() ? scan_masked_avx2 : scan_masked_sse2;
+#else
+    return scan_masked_scalar;
+#endif
+}
+
+
+/**
+ * Busca una secuencia de bytes en toda la memoria.
+ *
+ * Params: pattern (const uint8_t *): Bytes buscados, en orden de memoria.
+ *         length (int): Largo del patron (>= 1).
+ *         alignment (int): Solo direcciones multiplo de este valor.
+ *
+ * Returns: uint64_t: Cantidad de coincidencias.
+ */
+uint64_t memsearch_bytes(const uint8_t *pattern, int length, int alignment) {
+    static scan_bytes_fn scan;
+    int n;
+
+    if (scan == NULL)
+        scan = select_scan_bytes();
+    NMATCHES = 0;
+    ALIGNMENT = alignment;
+    n = snprintf(DESCRIPTION, sizeof(DESCRIPTION), "bytes");
+    for (int i = 0; i < length && n < (int)sizeof(DESCRIPTION) - 4; i++)
+        n += snprintf(DESCRIPTION + n, sizeof(DESCRIPTION) - n, " %02x", pattern[i]);
+
+    for (int r = 0; r < MEM_NREGIONS; r++) {
+        BASE = MEM_REGIONS[r].start;
+        scan(MEM_REGIONS[r].mem, MEM_REGIONS[r].size, pattern, length);
+    }
+    return NMATCHES;
+}
+
+
+/**
+ * Busca las palabras alineadas con (palabra & mask) == value.
+ *
+ * Returns: uint64_t: Cantidad de coincidencias.
+ */
+uint64_t memsearch_masked(uint32_t value, uint32_t mask) {
+    static scan_masked_fn scan;
+
+    if (scan == NULL)
+        scan = select_scan_masked();
+    NMATCHES = 0;
+    ALIGNMENT = 4;
+    snprintf(DESCRIPTION, sizeof(DESCRIPTION), "word 0x%x mask 0x%x", value, mask);
+
+    for (int r = 0; r < MEM_NREGIONS; r++) {
+        BASE = MEM_REGIONS[r].start;
+        scan(MEM_REGIONS[r].mem, MEM_REGIONS[r].size, value & mask, mask);
+    }
+    return NMATCHES;
+}
+
+
+/**
+ * Imprime las direcciones encontradas por la ultima busqueda.
+ *
+ * Params: out (FILE *): Archivo de salida.
+ */
+void memsearch_report(FILE *out) {
+    fprintf(out, "\nSearch for %s : %" PRIu64 " matches\n", DESCRIPTION, NMATCHES);
+    fprintf(out, "-------------------------------------\n");
+    for (uint64_t i = 0; i < NMATCHES && i < MAX_MATCHES_SHOWN; i++)
+        fprintf(out, "  0x%08" PRIx64 "\n", MATCHES[i]);
+    if (NMATCHES > MAX_MATCHES_SHOWN)
+        fprintf(out, "  ... %" PRIu64 " more\n", NMATCHES - MAX_MATCHES_SHOWN);
+    fprintf(out, "\n");
+}
@@ -0,0 +1,17 @@
+/***************************************************************/
+/*                                                             */
+/*   Busqueda de valores en la memoria simulada                */
+/*                                                             */
+/***************************************************************/
+
+#ifndef _SIM_MEMSEARCH_H_
+#define _SIM_MEMSEARCH_H_
+
+#include <stdio.h>
+#include <inttypes.h>
+
+uint64_t memsearch_bytes(const uint8_t *pattern, int length, int alignment);
+uint64_t memsearch_masked(uint32_t value, uint32_t mask);
+void     memsearch_report(FILE *out);
+
+#endif
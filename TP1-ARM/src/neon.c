@@ -0,0 +1,272 @@
+#include <stdio.h>
+#include <string.h>
+#include "shell.h"
+#include "neon.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+/*
+ * Operaciones por elemento de Advanced SIMD.
+ *
+ * Con SSE4.2 cada operacion de 128 bits es una o pocas instrucciones del
+ * host (PADD, PMULLW/PMULLD, PCMPEQ, PCMPGT, PMAX, PMIN, PSHUFB); las
+ * reducciones se pliegan a la mitad con desplazamientos de bytes. Sin
+ * SSE4.2 se recorren los elementos. Los registros de ARM son de 128 bits,
+ * asi que AVX2 no agrega nada.
+ */
+
+
+/**
+ * Lee un elemento de un registro V.
+ *
+ * Params: size (int): log2 del tamano en bytes.
+ *         index (int): Numero de elemento.
+ */
+uint64_t neon_lane(vreg_t v, int size, int index) {
+    switch (size) {
+    case 0: return v.b[index];
+    case 1: return v.h[index];
+    case 2: return v.s[index];
+    default: return v.d[index];
+    }
+}
+
+void neon_set_lane(vreg_t *v, int size, int index, uint64_t value) {
+    switch (size) {
+    case 0: v->b[index] = value; break;
+    case 1: v->h[index] = value; break;
+    case 2: v->s[index] = value; break;
+    default: v->d[index] = value; break;
+    }
+}
+
+/* Repite value en todos los elementos. */
+vreg_t neon_dup(uint64_t value, int size) {
+    vreg_t v;
+
+    for (int i = 0; i < 16 >> size; i++)
+        neon_set_lane(&v, size, i, value);
+    return v;
+}
+
+/* Elemento con signo (extendido a 64 bits). */
+static int64_t signed_lane(vreg_t v, int size, int index) {
+    int unused = 64 - (8 << size);
+    return (int64_t)(neon_lane(v, size, index) << unused) >> unused;
+}
+
+static uint64_t lane_mask(int size) {
+    return size == 3 ? ~0ULL : (1ULL << (8 << size)) - 1;
+}
+
+static uint64_t scalar_op(int op, uint64_t a, uint64_t b, int64_t sa, int64_t sb) {
+    switch (op) {
+    case NEON_ADD: return a + b;
+    case NEON_SUB: return a - b;
+    case NEON_MUL: return a * b;
+    case NEON_SMAX: return sa > sb ? a : b;
+    case NEON_UMAX: return a > b ? a : b;
+    case NEON_SMIN: return sa < sb ? a : b;
+    default: return a < b ? a : b;
+    }
+}
+
+
+/* ---- implementacion portable ---- */
+
+static vreg_t arith_portable(int op, vreg_t a, vreg_t b, int size) {
+    vreg_t r;
+
+    for (int i = 0; i < 16 >> size; i++)
+        neon_set_lane(&r, size, i, scalar_op(op, neon_lane(a, size, i), neon_lane(b, size, i),
+                                             signed_lane(a, size, i), signed_lane(b, size, i)));
+    return r;
+}
+
+static vreg_t compare_portable(int op, vreg_t a, vreg_t b, int size) {
+    vreg_t r;
+
+    for (int i = 0; i < 16 >> size; i++) {
+        uint64_t x = neon_lane(a, size, i), y = neon_lane(b, size, i);
+        int64_t sx = signed_lane(a, size, i), sy = signed_lane(b, size, i);
+        int result;
+        switch (op) {
+        case NEON_EQ: result = x == y; break;
+        case NEON_GT: result = sx > sy; break;
+        case NEON_GE: result = sx >= sy; break;
+        case NEON_HI: result = x > y; break;
+        case NEON_HS: result = x >= y; break;
+        default: result = (x & y) != 0; break;
+        }
+        neon_set_lane(&r, size, i, result ? ~0ULL : 0);
+    }
+    return r;
+}
+
+static uint64_t reduce_portable(int op, vreg_t a, int size, int q) {
+    int lanes = (q ? 16 : 8) >> size;
+    uint64_t acc = neon_lane(a, size, 0);
+
+    for (int i = 1; i < lanes; i++) {
+        vreg_t pair = a;
+        neon_set_lane(&pair, size, 0, acc);
+        acc = scalar_op(op, acc, neon_lane(a, size, i), signed_lane(pair, size, 0), signed_lane(a, size, i));
+    }
+    return acc & lane_mask(size);
+}
+
+static vreg_t table_portable(const vreg_t *table, int n, vreg_t index, vreg_t fallback) {
+    for (int i = 0; i < 16; i++)
+        if (index.b[i] < 16 * n)
+            fallback.b[i] = table[index.b[i] >> 4].b[index.b[i] & 15];
+    return fallback;
+}
+
+
+/* ---- implementacion con SSE4.2 ---- */
+
+#if defined(__x86_64__)
+static __m128i to_host(vreg_t v) {
+    return _mm_loadu_si128((const __m128i *)&v);
+}
+
+static vreg_t from_host(__m128i x) {
+    vreg_t v;
+    _mm_storeu_si128((__m128i *)&v, x);
+    return v;
+}
+
+/* MUL de bytes: productos de 16 bits de los bytes pares e impares */
+__attribute__((target("sse4.2")))
+static __m128i mul_bytes(__m128i a, __m128i b) {
+    __m128i even = _mm_mullo_epi16(a, b);
+    __m128i odd = _mm_mullo_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+    return _mm_or_si128(_mm_and_si128(even, _mm_set1_epi16(0xFF)), _mm_slli_epi16(odd, 8));
+}
+
+__attribute__((target("sse4.2")))
+static __m128i lane_op(int op, __m128i a, __m128i b, int size) {
+    switch (op * 4 + size) {
+    case NEON_ADD * 4 + 0: return _mm_add_epi8(a, b);
+    case NEON_ADD * 4 + 1: return _mm_add_epi16(a, b);
+    case NEON_ADD * 4 + 2: return _mm_add_epi32(a, b);
+    case NEON_ADD * 4 + 3: return _mm_add_epi64(a, b);
+    case NEON_SUB * 4 + 0: return _mm_sub_epi8(a, b);
+    case NEON_SUB * 4 + 1: return _mm_sub_epi16(a, b);
+    case NEON_SUB * 4 + 2: return _mm_sub_epi32(a, b);
+    case NEON_SUB * 4 + 3: return _mm_sub_epi64(a, b);
+    case NEON_MUL * 4 + 0: return mul_bytes(a, b);
+    case NEON_MUL * 4 + 1: return _mm_mullo_epi16(a, b);
+    case NEON_MUL * 4 + 2: return _mm_mullo_epi32(a, b);
+    case NEON_SMAX * 4 + 0: return _mm_max_epi8(a, b);
+    case NEON_SMAX * 4 + 1: return _mm_max_epi16(a, b);
+    case NEON_SMAX * 4 + 2: return _mm_max_epi32(a, b);
+    case NEON_UMAX * 4 + 0: return _mm_max_epu8(a, b);
+    case NEON_UMAX * 4 + 1: return _mm_max_epu16(a, b);
+    case NEON_UMAX * 4 + 2: return _mm_max_epu32(a, b);
+    case NEON_SMIN * 4 + 0: return _mm_min_epi8(a, b);
+    case NEON_SMIN * 4 + 1: return _mm_min_epi16(a, b);
+    case NEON_SMIN * 4 + 2: return _mm_min_epi32(a, b);
+    case NEON_UMIN * 4 + 0: return _mm_min_epu8(a, b);
+    case NEON_UMIN * 4 + 1: return _mm_min_epu16(a, b);
+    case NEON_UMIN * 4 + 2: return _mm_min_epu32(a, b);
+    default: return to_host(arith_portable(op, from_host(a), from_host(b), size));
+    }
+}
+
+__attribute__((target("sse4.2")))
+static vreg_t arith_sse42(int op, vreg_t a, vreg_t b, int size) {
+    return from_host(lane_op(op, to_host(a), to_host(b), size));
+}
+
+__attribute__((target("sse4.2")))
+static __m128i greater(__m128i a, __m128i b, int size) {
+    switch (size) {
+    case 0: return _mm_cmpgt_epi8(a, b);
+    case 1: return _mm_cmpgt_epi16(a, b);
+    case 2: return _mm_cmpgt_epi32(a, b);
+    default: return _mm_cmpgt_epi64(a, b);
+    }
+}
+
+__attribute__((target("sse4.2")))
+static __m128i equal(__m128i a, __m128i b, int size) {
+    switch (size) {
+    case 0: return _mm_cmpeq_epi8(a, b);
+    case 1: return _mm_cmpeq_epi16(a, b);
+    case 2: return _mm_cmpeq_epi32(a, b);
+    default: return _mm_cmpeq_epi64(a, b);
+    }
+}
+
+__attribute__((target("sse4.2")))
+static vreg_t compare_sse42(int op, vreg_t a, vreg_t b, int size) {
+    __m128i x = to_host(a), y = to_host(b), ones = _mm_set1_epi8(-1);
+    /* sin signo: se invierte el bit de signo y se compara con signo */
+    __m128i bias = to_host(neon_dup(1ULL << ((8 << size) - 1), size));
+
+    switch (op) {
+    case NEON_EQ: return from_host(equal(x, y, size));
+    case NEON_GT: return from_host(greater(x, y, size));
+    case NEON_GE: return from_host(_mm_xor_si128(greater(y, x, size), ones));
+    case NEON_HI: return from_host(greater(_mm_xor_si128(x, bias), _mm_xor_si128(y, bias), size));
+    case NEON_HS: return from_host(_mm_xor_si128(greater(_mm_xor_si128(y, bias), _mm_xor_si128(x, bias), size), ones));
+    default: return from_host(_mm_xor_si128(equal(_mm_and_si128(x, y), _mm_setzero_si128(), size), ones));
+    }
+}
+
+static __m128i shift_bytes(__m128i v, int bytes) {
+    switch (bytes) {
+    case 8: return _mm_srli_si128(v, 8);
+    case 4: return _mm_srli_si128(v, 4);
+    case 2: return _mm_srli_si128(v, 2);
+    default: return _mm_srli_si128(v, 1);
+    }
+}
+
+/* Pliega el vector a la mitad hasta que queda un solo elemento. */
+__attribute__((target("sse4.2")))
+static uint64_t reduce_sse42(int op, vreg_t a, int size, int q) {
+    __m128i v = to_host(a);
+
+    if (size == 3)
+        return reduce_portable(op, a, size, q);
+    for (int bytes = q ? 8 : 4; bytes >= 1 << size; bytes >>= 1)
+        v = lane_op(op, v, shift_bytes(v, bytes), size);
+    return (uint64_t)_mm_cvtsi128_si64(v) & lane_mask(size);
+}
+
+/* PSHUFB da 0 si el bit 7 del indice esta en 1: se satura lo que queda fuera */
+__attribute__((target("sse4.2")))
+static vreg_t table_sse42(const vreg_t *table, int n, vreg_t index, vreg_t fallback) {
+    __m128i idx = to_host(index), result = _mm_setzero_si128();
+    __m128i in_range = _mm_cmpeq_epi8(_mm_min_epu8(idx, _mm_set1_epi8(16 * n - 1)), idx);
+
+    for (int k = 0; k < n; k++) {
+        __m128i local = _mm_adds_epu8(_mm_sub_epi8(idx, _mm_set1_epi8(16 * k)), _mm_set1_epi8(0x70));
+        result = _mm_or_si128(result, _mm_shuffle_epi8(to_host(table[k]), local));
+    }
+    return from_host(_mm_blendv_epi8(to_host(fallback), result, in_range));
+}
+#endif
+
+neon_t NEON = {arith_portable, compare_portable, reduce_portable, table_portable, "portable"};
+
+
+/**
+ * Elige las implementaciones segun la CPU del host.
+ */
+void neon_init() {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        NEON.arith = arith_sse42;
+        NEON.compare = compare_sse42;
+        NEON.reduce = reduce_sse42;
+        NEON.table = table_sse42;
+        NEON.name = "sse4.2";
+    }
+#endif
+}
@@ -0,0 +1,36 @@
+/***************************************************************/
+/*                                                             */
+/*   Operaciones de Advanced SIMD (NEON) sobre registros V     */
+/*                                                             */
+/***************************************************************/
+
+#ifndef _SIM_NEON_H_
+#define _SIM_NEON_H_
+
+#include <inttypes.h>
+#include "shell.h"
+
+/* operaciones por elemento; size es log2 del tamano en bytes (0-3) */
+enum { NEON_ADD, NEON_SUB, NEON_MUL, NEON_SMAX, NEON_UMAX, NEON_SMIN, NEON_UMIN };
+enum { NEON_EQ, NEON_GT, NEON_GE, NEON_HI, NEON_HS, NEON_TST };
+
+/*
+ * Implementacion elegida al iniciar segun la CPU del host. Todas operan
+ * sobre los 128 bits; el llamador descarta la mitad alta si Q = 0.
+ */
+typedef struct {
+    vreg_t   (*arith)(int op, vreg_t a, vreg_t b, int size);
+    vreg_t   (*compare)(int op, vreg_t a, vreg_t b, int size);
+    uint64_t (*reduce)(int op, vreg_t a, int size, int q);
+    vreg_t   (*table)(const vreg_t *table, int n, vreg_t index, vreg_t fallback);
+    const char *name;
+} neon_t;
+
+extern neon_t NEON;
+
+void     neon_init();
+uint64_t neon_lane(vreg_t v, int size, int index);
+void     neon_set_lane(vreg_t *v, int size, int index, uint64_t value);
+vreg_t   neon_dup(uint64_t value, int size);
+
+#endif
@@ -0,0 +1,314 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "shell.h"
+#include "sim.h"
+#include "pdcache.h"
+
+/*
+ * Cache en disco de las tablas de predecodificacion de sim.c (indice de
+ * cada instruccion, palabra y mapa de bloques basicos).
+ *
+ * Esta desactivado salvo que se pida: ARM_SIM_CACHE=on usa
+ * $XDG_CACHE_HOME/arm-sim (o ~/.cache/arm-sim) y cualquier otro valor
+ * distinto de "off" es el directorio a usar.
+ *
+ * El archivo se llama <hash>.pdc, donde el hash cubre el contenido del
+ * segmento de texto cargado y lo que determina las tablas: INSTRUCTION_SET
+ * (mascara, valor, efectos y nombre de cada entrada) y PDCACHE_VERSION,
+ * que hay que subir si cambia el formato o como predecode_program arma el
+ * mapa de bloques. El directorio no pasa de PDCACHE_MAX_BYTES ocupados en
+ * disco: al guardar uno nuevo se borran los menos usados (cada uso
+ * actualiza la fecha de modificacion del archivo).
+ *
+ * Formato: una cabecera de PDCACHE_ALIGN bytes y las tres tablas
+ * completas a continuacion, cada una alineada a PDCACHE_ALIGN. Solo se
+ * escribe la parte que ocupa el programa; el resto es un hueco del archivo
+ * (se lee como cero = "sin decodificar"). Al lanzar el simulador de nuevo
+ * con la misma imagen, el archivo se mapea con MAP_PRIVATE y sus tablas se
+ * instalan con predecode_attach, sin decodificar nada.
+ */
+
+#define PDCACHE_MAGIC       "ARMPDC"
+#define PDCACHE_VERSION     2
+#define PDCACHE_ALIGN       0x10000
+#define PDCACHE_MAX_BYTES   (32 << 20)
+
+#define ENTRIES_SIZE        (PREDECODE_WORDS * sizeof(uint16_t))
+#define WORDS_SIZE          (PREDECODE_WORDS * sizeof(uint32_t))
+#define LEADERS_SIZE        (PREDECODE_WORDS / 8)
+
+#define ENTRIES_OFFSET      PDCACHE_ALIGN
+#define WORDS_OFFSET        (ENTRIES_OFFSET + align_up(ENTRIES_SIZE))
+#define LEADERS_OFFSET      (WORDS_OFFSET + align_up(WORDS_SIZE))
+#define FILE_SIZE           (LEADERS_OFFSET + align_up(LEADERS_SIZE))
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t text_size;
+    uint64_t build;
+    uint64_t image[2];
+    uint64_t nwords;
+    uint64_t entry;
+} pdcache_header_t;
+
+/* cache mapeado en uso */
+static void *MAPPED;
+
+
+static uint64_t align_up(uint64_t value) {
+    return (value + PDCACHE_ALIGN - 1) & ~(uint64_t)(PDCACHE_ALIGN - 1);
+}
+
+/* Mezcla de 64 bits (finalizador de splitmix64). */
+static uint64_t mix(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBULL;
+    return h ^ (h >> 31);
+}
+
+static uint64_t hash_bytes(const uint8_t *data, uint64_t length, uint64_t seed) {
+    uint64_t h = mix(seed ^ length), i = 0;
+
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        h = mix(h ^ word) + i;
+    }
+    for (; i < length; i++)
+        h = mix(h ^ data[i]);
+    return h;
+}
+
+/*
+ * Identifica la tabla de instrucciones: los indices guardados y el mapa de
+ * bloques solo dependen de ella (no de los handlers), asi que un binario
+ * nuevo con la misma tabla reusa los caches.
+ */
+static uint64_t build_hash() {
+    uint64_t h = mix((uint64_t)PDCACHE_VERSION << 32 | INSTRUCTION_SET_SIZE);
+
+    for (int i = 0; i < INSTRUCTION_SET_SIZE; i++) {
+        h = mix(h ^ ((uint64_t)INSTRUCTION_SET[i].mask << 32 | INSTRUCTION_SET[i].value));
+        h = mix(h ^ INSTRUCTION_SET[i].effects);
+        h = hash_bytes((const uint8_t *)INSTRUCTION_SET[i].name, strlen(INSTRUCTION_SET[i].name), h);
+    }
+    return h;
+}
+
+static mem_region_t *text_region() {
+    for (int i = 0; i < MEM_NREGIONS; i++)
+        if (MEM_REGIONS[i].start == MEM_TEXT_START)
+            return &MEM_REGIONS[i];
+    return NULL;
+}
+
+/* Palabras del programa: hasta la ultima palabra distinta de cero. */
+static uint64_t program_words(const mem_region_t *text) {
+    uint64_t n = text->size / 4;
+
+    while (n > 0 && memcmp(text->mem + 4 * (n - 1), "\0\0\0\0", 4) == 0)
+        n--;
+    return n;
+}
+
+static int cache_path(char *path, size_t size, char *base, size_t base_size,
+                      const pdcache_header_t *header) {
+    const char *dir = getenv("ARM_SIM_CACHE");
+    int length;
+
+    if (dir == NULL || dir[0] == '\0' || strcmp(dir, "off") == 0)
+        return FALSE;
+    if (strcmp(dir, "on") != 0)
+        length = snprintf(base, base_size, "%s", dir);
+    else if (getenv("XDG_CACHE_HOME") != NULL && getenv("XDG_CACHE_HOME")[0] != '\0')
+        length = snprintf(base, base_size, "%s/arm-sim", getenv("XDG_CACHE_HOME"));
+    else if (getenv("HOME") != NULL)
+        length = snprintf(base, base_size, "%s/.cache/arm-sim", getenv("HOME"));
+    else
+        return FALSE;
+    /* un nombre cortado apuntaria a otro archivo: mejor sin cache */
+    if (length < 0 || (size_t)length >= base_size)
+        return FALSE;
+
+    /* crea el directorio (y ~/.cache si hace falta) */
+    for (char *p = strchr(base + 1, '/'); ; p = strchr(p + 1, '/')) {
+        if (p != NULL)
+            *p = '\0';
+        if (mkdir(base, 0755) != 0 && errno != EEXIST)
+            return FALSE;
+        if (p == NULL)
+            break;
+        *p = '/';
+    }
+    length = snprintf(path, size, "%s/%016" PRIx64 "%016" PRIx64 ".pdc", base,
+                      header->image[0] ^ header->build, header->image[1]);
+    return length >= 0 && (size_t)length < size;
+}
+
+/* Mapea un cache existente; TRUE si era valido y quedo instalado. */
+static int attach(const char *path, const pdcache_header_t *expected) {
+    pdcache_header_t header;
+    struct stat st;
+    uint8_t *map;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+        return FALSE;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size != FILE_SIZE ||
+            pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+            memcmp(&header, expected, sizeof(header)) != 0) {
+        close(fd);
+        return FALSE;
+    }
+    map = mmap(NULL, FILE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    futimens(fd, NULL);       /* recien usado: ultimo en desalojarse */
+    close(fd);
+    if (map == MAP_FAILED)
+        return FALSE;
+
+    predecode_attach((uint16_t *)(map + ENTRIES_OFFSET), (uint32_t *)(map + WORDS_OFFSET),
+                     (uint64_t *)(map + LEADERS_OFFSET));
+    MAPPED = map;
+    return TRUE;
+}
+
+/* Escribe las tablas recien construidas; los errores solo evitan el cache. */
+static void store(const char *path, const pdcache_header_t *header) {
+    char temporary[PATH_MAX + 32];     /* path + ".<pid>.tmp" */
+    uint16_t *entries;
+    uint32_t *words;
+    uint64_t *leaders;
+    uint64_t n = header->nwords;
+    int fd, ok;
+
+    predecode_tables(&entries, &words, &leaders);
+    snprintf(temporary, sizeof(temporary), "%s.%d.tmp", path, (int)getpid());
+    fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return;
+    ok = pwrite(fd, header, sizeof(*header), 0) == sizeof(*header) &&
+         ftruncate(fd, FILE_SIZE) == 0 &&
+         pwrite(fd, entries, n * sizeof(uint16_t), ENTRIES_OFFSET) == (ssize_t)(n * sizeof(uint16_t)) &&
+         pwrite(fd, words, n * sizeof(uint32_t), WORDS_OFFSET) == (ssize_t)(n * sizeof(uint32_t)) &&
+         pwrite(fd, leaders, LEADERS_SIZE, LEADERS_OFFSET) == LEADERS_SIZE;
+    if (close(fd) != 0 || !ok || rename(temporary, path) != 0)
+        unlink(temporary);
+}
+
+typedef struct {
+    char name[256];
+    uint64_t bytes;
+    struct timespec used;
+} cache_file_t;
+
+static int older_first(const void *a, const void *b) {
+    const struct timespec *x = &((const cache_file_t *)a)->used;
+    const struct timespec *y = &((const cache_file_t *)b)->used;
+
+    if (x->tv_sec != y->tv_sec)
+        return x->tv_sec < y->tv_sec ? -1 : 1;
+    return (x->tv_nsec > y->tv_nsec) - (x->tv_nsec < y->tv_nsec);
+}
+
+/*
+ * Borra los caches menos usados de dir hasta que los .pdc ocupen en disco
+ * (los archivos tienen huecos: cuentan los bloques) a lo sumo
+ * PDCACHE_MAX_BYTES. keep es el recien guardado, que nunca se borra.
+ */
+static void evict(const char *dir, const char *keep) {
+    cache_file_t *files = NULL;
+    int n = 0, capacity = 0;
+    uint64_t total = 0;
+    struct dirent *e;
+    DIR *d = opendir(dir);
+
+    if (d == NULL)
+        return;
+    while ((e = readdir(d)) != NULL) {
+        size_t length = strlen(e->d_name);
+        char path[PATH_MAX + sizeof(files->name)];
+        struct stat st;
+
+        if (length < 4 || length >= sizeof(files->name) ||
+                strcmp(e->d_name + length - 4, ".pdc") != 0)
+            continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+        if (stat(path, &st) != 0)
+            continue;
+        if (n == capacity) {
+            cache_file_t *grown = realloc(files, (capacity = 2 * capacity + 16) * sizeof(*files));
+            if (grown == NULL)
+                break;
+            files = grown;
+        }
+        snprintf(files[n].name, sizeof(files[n].name), "%s", e->d_name);
+        files[n].bytes = (uint64_t)st.st_blocks * 512;
+        files[n].used = st.st_mtim;
+        total += files[n++].bytes;
+    }
+    closedir(d);
+
+    qsort(files, n, sizeof(*files), older_first);
+    for (int i = 0; i < n && total > PDCACHE_MAX_BYTES; i++) {
+        char path[PATH_MAX + sizeof(files->name)];
+
+        snprintf(path, sizeof(path), "%s/%s", dir, files[i].name);
+        if (strcmp(path, keep) != 0 && unlink(path) == 0)
+            total -= files[i].bytes;
+    }
+    free(files);
+}
+
+
+/**
+ * Deja predecodificado el programa recien cargado: mapea el cache que le
+ * corresponde o, si no existe, lo decodifica entero y guarda el cache.
+ * Sin ARM_SIM_CACHE solo decodifica.
+ *
+ * Params: entry (uint64_t): PC inicial del programa.
+ *
+ * Returns: int: TRUE si se uso un cache existente.
+ */
+int pdcache_prepare(uint64_t entry) {
+    mem_region_t *text = text_region();
+    pdcache_header_t header;
+    char path[PATH_MAX], base[PATH_MAX];
+
+    if (MAPPED != NULL) {
+        predecode_reset();
+        munmap(MAPPED, FILE_SIZE);
+        MAPPED = NULL;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PDCACHE_MAGIC, sizeof(PDCACHE_MAGIC));
+    header.version = PDCACHE_VERSION;
+    header.text_size = MEM_TEXT_SIZE;
+    header.build = build_hash();
+    header.nwords = program_words(text);
+    header.image[0] = hash_bytes(text->mem, 4 * header.nwords, 0x0123456789ABCDEFULL);
+    header.image[1] = hash_bytes(text->mem, 4 * header.nwords, 0xFEDCBA9876543210ULL);
+    header.entry = entry;
+
+    if (!cache_path(path, sizeof(path), base, sizeof(base), &header)) {
+        predecode_program(header.nwords, entry);
+        return FALSE;
+    }
+    if (attach(path, &header))
+        return TRUE;
+    predecode_program(header.nwords, entry);
+    store(path, &header);
+    evict(base, path);
+    return FALSE;
+}
@@ -0,0 +1,14 @@
+/***************************************************************/
+/*                                                             */
+/*   Cache en disco del programa predecodificado               */
+/*                                                             */
+/***************************************************************/
+
+#ifndef _SIM_PDCACHE_H_
+#define _SIM_PDCACHE_H_
+
+#include <inttypes.h>
+
+int pdcache_prepare(uint64_t entry);
+
+#endif
@@ -0,0 +1,59 @@
+/***************************************************************/
+/*                                                             */
+/*   ABI de plugins de instrumentacion                         */
+/*                                                             */
+/*   Un plugin es una biblioteca compartida (.so) que exporta  */
+/*   SIM_PLUGIN_INIT_SYMBOL con el tipo sim_plugin_init_fn y,  */
+/*   opcionalmente, SIM_PLUGIN_FINI_SYMBOL. Se carga desde el  */
+/*   shell con "plugin load <archivo.so> [argumentos]".        */
+/*                                                             */
+/***************************************************************/
+
+#ifndef _SIM_PLUGIN_H_
+#define _SIM_PLUGIN_H_
+
+#include <inttypes.h>
+
+#define SIM_PLUGIN_API_VERSION  1
+
+#define SIM_PLUGIN_INIT_SYMBOL  "sim_plugin_init"
+#define SIM_PLUGIN_FINI_SYMBOL  "sim_plugin_fini"
+
+/*
+ * Callbacks del plugin. Los que queden en NULL no se instrumentan: solo
+ * se paga por los eventos que algun plugin pidio. `data` se pasa tal cual
+ * a cada callback.
+ */
+typedef struct sim_plugin_hooks {
+    void *data;
+
+    /* antes de ejecutar cada instruccion */
+    void (*instruction)(void *data, uint64_t pc, uint32_t instruction);
+    /* antes de la primera instruccion de cada bloque basico */
+    void (*block)(void *data, uint64_t pc);
+    /* cada lectura o escritura de datos de 32 bits */
+    void (*mem_access)(void *data, uint64_t address, int is_write);
+    /* despues de cada salto (tomado o no) */
+    void (*branch)(void *data, uint64_t pc, uint64_t target, int taken);
+    /* cuando el programa ejecuta HLT */
+    void (*halt)(void *data, uint64_t instruction_count);
+} sim_plugin_hooks;
+
+/* Servicios del simulador que el plugin puede usar. */
+typedef struct sim_plugin_host {
+    uint32_t api_version;
+    uint64_t (*read_pc)(void);
+    int64_t  (*read_register)(int reg);
+    uint32_t (*read_memory_32)(uint64_t address);
+    uint64_t (*instruction_count)(void);
+} sim_plugin_host;
+
+/*
+ * Devuelve 0 si el plugin se inicializo y completo `hooks`, otro valor
+ * para rechazar la carga. `args` nunca es NULL.
+ */
+typedef int  (*sim_plugin_init_fn)(const sim_plugin_host *host, const char *args,
+                                   sim_plugin_hooks *hooks);
+typedef void (*sim_plugin_fini_fn)(void *data);
+
+#endif
@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+#include "shell.h"
+#include "sim.h"
+#include "plugin.h"
+#include "plugin_loader.h"
+#include "fpu.h"
+
+/*
+ * Los plugins se cargan con dlopen y registran sus callbacks en un
+ * sim_plugin_hooks. El shell solo usa el ciclo instrumentado
+ * (plugin_before_instruction / plugin_after_instruction) mientras
+ * PLUGINS_ACTIVE, y la memoria solo avisa a los plugins si alguno pidio
+ * mem_access: sin plugins, el ciclo por defecto no cambia. Los callbacks
+ * corren con el entorno de punto flotante del host (fpu_host_enter).
+ */
+
+#define MAX_PLUGINS 8
+
+typedef struct {
+    void *handle;
+    char path[256];
+    sim_plugin_hooks hooks;
+} plugin_t;
+
+int PLUGINS_ACTIVE = FALSE;
+int PLUGIN_MEM_HOOKS = FALSE;
+
+static plugin_t PLUGINS[MAX_PLUGINS];
+static int NPLUGINS;
+
+/* instruccion en curso del ciclo instrumentado */
+static uint64_t CUR_PC;
+static int CUR_INDEX;
+static int BLOCK_START = TRUE;
+
+
+static uint64_t host_read_pc(void) {
+    return CURRENT_STATE.PC;
+}
+
+static int64_t host_read_register(int reg) {
+    return (reg >= 0 && reg < ARM_REGS) ? CURRENT_STATE.REGS[reg] : 0;
+}
+
+static uint64_t host_instruction_count(void) {
+    return INSTRUCTION_COUNT;
+}
+
+static const sim_plugin_host HOST = {
+    SIM_PLUGIN_API_VERSION,
+    host_read_pc,
+    host_read_register,
+    mem_peek_32,
+    host_instruction_count,
+};
+
+static void update_flags() {
+    PLUGINS_ACTIVE = FALSE;
+    PLUGIN_MEM_HOOKS = FALSE;
+    for (int i = 0; i < NPLUGINS; i++) {
+        sim_plugin_hooks *h = &PLUGINS[i].hooks;
+        if (h->instruction || h->block || h->branch || h->halt)
+            PLUGINS_ACTIVE = TRUE;
+        if (h->mem_access)
+            PLUGIN_MEM_HOOKS = TRUE;
+    }
+}
+
+
+/**
+ * Carga un plugin y lo inicializa.
+ *
+ * Params: path (const char *): Ruta de la biblioteca compartida.
+ *         args (const char *): Argumentos para el plugin.
+ *
+ * Returns: int: TRUE si el plugin quedo cargado.
+ */
+int plugin_load(const char *path, const char *args) {
+    plugin_t *p;
+    sim_plugin_init_fn init;
+
+    if (NPLUGINS == MAX_PLUGINS) {
+        printf("Error: at most %d plugins can be loaded\n", MAX_PLUGINS);
+        return FALSE;
+    }
+    p = &PLUGINS[NPLUGINS];
+    memset(p, 0, sizeof(*p));
+
+    p->handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (p->handle == NULL) {
+        printf("Error: %s\n", dlerror());
+        return FALSE;
+    }
+    init = (sim_plugin_init_fn)dlsym(p->handle, SIM_PLUGIN_INIT_SYMBOL);
+    if (init == NULL) {
+        printf("Error: %s does not export %s\n", path, SIM_PLUGIN_INIT_SYMBOL);
+        dlclose(p->handle);
+        return FALSE;
+    }
+    if (init(&HOST, args, &p->hooks) != 0) {
+        printf("Error: %s rejected initialization\n", path);
+        dlclose(p->handle);
+        return FALSE;
+    }
+    snprintf(p->path, sizeof(p->path), "%s", path);
+    NPLUGINS++;
+    update_flags();
+    return TRUE;
+}
+
+
+/**
+ * Finaliza y descarga todos los plugins.
+ */
+void plugin_unload_all() {
+    for (int i = 0; i < NPLUGINS; i++) {
+        sim_plugin_fini_fn fini = (sim_plugin_fini_fn)dlsym(PLUGINS[i].handle, SIM_PLUGIN_FINI_SYMBOL);
+        if (fini)
+            fini(PLUGINS[i].hooks.data);
+        dlclose(PLUGINS[i].handle);
+    }
+    NPLUGINS = 0;
+    update_flags();
+}
+
+
+/**
+ * Lista los plugins cargados y los eventos que instrumentan.
+ */
+void plugin_list() {
+    if (NPLUGINS == 0)
+        printf("No plugins loaded\n");
+    for (int i = 0; i < NPLUGINS; i++) {
+        sim_plugin_hooks *h = &PLUGINS[i].hooks;
+        printf("%d: %s [%s%s%s%s%s ]\n", i, PLUGINS[i].path,
+               h->instruction ? " instruction" : "", h->block ? " block" : "",
+               h->mem_access ? " mem" : "", h->branch ? " branch" : "",
+               h->halt ? " halt" : "");
+    }
+    printf("\n");
+}
+
+
+/**
+ * Eventos previos a ejecutar la instruccion en CURRENT_STATE.PC.
+ */
+void plugin_before_instruction() {
+    uint32_t instruction;
+
+    CUR_PC = CURRENT_STATE.PC;
+    CUR_INDEX = predecode(CUR_PC, &instruction);
+    fpu_host_enter();
+    for (int i = 0; i < NPLUGINS; i++) {
+        sim_plugin_hooks *h = &PLUGINS[i].hooks;
+        if (BLOCK_START && h->block)
+            h->block(h->data, CUR_PC);
+        if (h->instruction)
+            h->instruction(h->data, CUR_PC, instruction);
+    }
+    fpu_host_leave();
+    BLOCK_START = FALSE;
+}
+
+
+/**
+ * Eventos posteriores: salto y HLT. Se llama despues del commit, con el
+ * PC siguiente ya en CURRENT_STATE.
+ */
+void plugin_after_instruction() {
+    int is_branch = CUR_INDEX >= 0 && (INSTRUCTION_SET[CUR_INDEX].effects & EFFECT_BRANCH);
+
+    fpu_host_enter();
+    for (int i = 0; i < NPLUGINS; i++) {
+        sim_plugin_hooks *h = &PLUGINS[i].hooks;
+        if (is_branch && h->branch)
+            h->branch(h->data, CUR_PC, CURRENT_STATE.PC, CURRENT_STATE.PC != CUR_PC + 4);
+        if (RUN_BIT == FALSE && h->halt)
+            h->halt(h->data, INSTRUCTION_COUNT);
+    }
+    fpu_host_leave();
+    if (is_branch || RUN_BIT == FALSE)
+        BLOCK_START = TRUE;
+}
+
+
+/**
+ * Acceso a datos del programa simulado.
+ *
+ * Params: address (uint64_t): Direccion accedida.
+ *         is_write (int): TRUE si es una escritura.
+ */
+void plugin_mem_access(uint64_t address, int is_write) {
+    fpu_host_enter();
+    for (int i = 0; i < NPLUGINS; i++) {
+        sim_plugin_hooks *h = &PLUGINS[i].hooks;
+        if (h->mem_access)
+            h->mem_access(h->data, address, is_write);
+    }
+    fpu_host_leave();
+}
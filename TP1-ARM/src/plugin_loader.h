@@ -0,0 +1,22 @@
+/***************************************************************/
+/*                                                             */
+/*   Carga de plugins y despacho de eventos                    */
+/*                                                             */
+/***************************************************************/
+
+#ifndef _SIM_PLUGIN_LOADER_H_
+#define _SIM_PLUGIN_LOADER_H_
+
+#include <inttypes.h>
+
+extern int PLUGINS_ACTIVE;          /* hay hooks de instruccion/bloque/salto/halt */
+extern int PLUGIN_MEM_HOOKS;        /* hay hooks de memoria */
+
+int  plugin_load(const char *path, const char *args);
+void plugin_unload_all();
+void plugin_list();
+void plugin_before_instruction();
+void plugin_after_instruction();
+void plugin_mem_access(uint64_t address, int is_write);
+
+#endif
@@ -0,0 +1,282 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "shell.h"
+#include "reuse.h"
+
+/*
+ * Distancia de pila (Mattson) sobre los accesos de datos del programa.
+ *
+ * Para cada tamanio de linea se guarda, por linea, el "timestamp" de su
+ * ultimo acceso, y un arbol de Fenwick marca los timestamps que siguen vivos
+ * (el acceso mas reciente de cada linea). La distancia de reuso de un acceso
+ * es la cantidad de marcas entre el acceso anterior a la misma linea y ahora,
+ * o sea la cantidad de lineas distintas tocadas en el medio. Con un solo
+ * histograma de distancias se obtiene la tasa de fallos de TODAS las caches
+ * LRU totalmente asociativas: un acceso falla en una cache de C lineas sii
+ * su distancia es >= C.
+ *
+ * Cuando los timestamps llenan el arbol se renumeran las lineas vivas en
+ * orden (compactacion), asi la memoria depende de la cantidad de lineas
+ * distintas y no de la cantidad de accesos.
+ */
+
+#define REUSE_NLINE_SIZES   5
+#define REUSE_MIN_TREE      (1 << 16)
+
+static const uint32_t LINE_SHIFTS[REUSE_NLINE_SIZES] = { 4, 5, 6, 7, 8 };
+
+typedef struct {
+    uint32_t line_shift;
+
+    /* tabla hash: linea + 1 (0 = vacio) -> timestamp del ultimo acceso */
+    uint64_t *keys;
+    uint64_t *stamps;
+    uint64_t capacity;
+    uint64_t count;
+
+    /* arbol de Fenwick sobre timestamps [0, tree_size) */
+    uint32_t *tree;
+    uint64_t tree_size;
+    uint64_t now;
+
+    /* histogram[d] = accesos con distancia d */
+    uint64_t *histogram;
+    uint64_t histogram_size;
+    uint64_t cold_misses;
+    uint64_t accesses;
+} reuse_tracker_t;
+
+int REUSE_ENABLED = FALSE;
+static reuse_tracker_t TRACKERS[REUSE_NLINE_SIZES];
+
+
+static void fenwick_add(reuse_tracker_t *t, uint64_t pos, int32_t delta) {
+    for (pos++; pos <= t->tree_size; pos += pos & -pos)
+        t->tree[pos - 1] += delta;
+}
+
+/* Suma de las marcas en [0, pos). */
+static uint64_t fenwick_prefix(reuse_tracker_t *t, uint64_t pos) {
+    uint64_t sum = 0;
+    for (; pos > 0; pos -= pos & -pos)
+        sum += t->tree[pos - 1];
+    return sum;
+}
+
+static uint64_t hash_line(uint64_t line, uint64_t capacity) {
+    return (line * 0x9E3779B97F4A7C15ULL) >> 32 & (capacity - 1);
+}
+
+/**
+ * Busca la entrada de una linea en la tabla hash.
+ *
+ * Returns: uint64_t: indice de la entrada (ocupada por la linea o vacia).
+ */
+static uint64_t find_slot(reuse_tracker_t *t, uint64_t key) {
+    uint64_t i = hash_line(key, t->capacity);
+    while (t->keys[i] != 0 && t->keys[i] != key)
+        i = (i + 1) & (t->capacity - 1);
+    return i;
+}
+
+static void grow_table(reuse_tracker_t *t) {
+    uint64_t *old_keys = t->keys, *old_stamps = t->stamps;
+    uint64_t old_capacity = t->capacity;
+
+    t->capacity *= 2;
+    t->keys = calloc(t->capacity, sizeof(uint64_t));
+    t->stamps = malloc(t->capacity * sizeof(uint64_t));
+    for (uint64_t i = 0; i < old_capacity; i++) {
+        if (old_keys[i] == 0) continue;
+        uint64_t j = find_slot(t, old_keys[i]);
+        t->keys[j] = old_keys[i];
+        t->stamps[j] = old_stamps[i];
+    }
+    free(old_keys);
+    free(old_stamps);
+}
+
+static int compare_stamps(const void *a, const void *b) {
+    uint64_t x = **(uint64_t * const *)a, y = **(uint64_t * const *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Renumera los timestamps vivos a 0..count-1 manteniendo el orden
+ * y reconstruye el arbol. Si las lineas vivas ocupan mas de la mitad
+ * del arbol, lo agranda primero.
+ */
+static void compact(reuse_tracker_t *t) {
+    uint64_t **live = malloc(t->count * sizeof(uint64_t *));
+    uint64_t n = 0;
+
+    for (uint64_t i = 0; i < t->capacity; i++)
+        if (t->keys[i] != 0)
+            live[n++] = &t->stamps[i];
+    qsort(live, n, sizeof(uint64_t *), compare_stamps);
+    for (uint64_t i = 0; i < n; i++)
+        *live[i] = i;
+    free(live);
+
+    if (2 * n > t->tree_size) {
+        t->tree_size *= 2;
+        t->tree = realloc(t->tree, t->tree_size * sizeof(uint32_t));
+    }
+    /* construccion O(n): cada nodo propaga su suma al padre */
+    for (uint64_t i = 0; i < t->tree_size; i++)
+        t->tree[i] = i < n;
+    for (uint64_t i = 1; i <= t->tree_size; i++) {
+        uint64_t parent = i + (i & -i);
+        if (parent <= t->tree_size)
+            t->tree[parent - 1] += t->tree[i - 1];
+    }
+    t->now = n;
+}
+
+static void record_distance(reuse_tracker_t *t, uint64_t distance) {
+    if (distance >= t->histogram_size) {
+        uint64_t size = t->histogram_size;
+        while (distance >= size) size *= 2;
+        t->histogram = realloc(t->histogram, size * sizeof(uint64_t));
+        memset(t->histogram + t->histogram_size, 0,
+               (size - t->histogram_size) * sizeof(uint64_t));
+        t->histogram_size = size;
+    }
+    t->histogram[distance]++;
+}
+
+static void tracker_access(reuse_tracker_t *t, uint64_t address) {
+    uint64_t key = (address >> t->line_shift) + 1;
+    uint64_t slot;
+
+    if (t->now == t->tree_size)
+        compact(t);
+
+    t->accesses++;
+    slot = find_slot(t, key);
+    if (t->keys[slot] == key) {
+        uint64_t last = t->stamps[slot];
+        uint64_t distance = fenwick_prefix(t, t->now) - fenwick_prefix(t, last + 1);
+        record_distance(t, distance);
+        fenwick_add(t, last, -1);
+    } else {
+        t->cold_misses++;
+        t->keys[slot] = key;
+        if (++t->count * 2 > t->capacity) {
+            grow_table(t);
+            slot = find_slot(t, key);
+        }
+    }
+    t->stamps[slot] = t->now;
+    fenwick_add(t, t->now, 1);
+    t->now++;
+}
+
+static void tracker_free(reuse_tracker_t *t) {
+    free(t->keys);
+    free(t->stamps);
+    free(t->tree);
+    free(t->histogram);
+    memset(t, 0, sizeof(*t));
+}
+
+
+/**
+ * Descarta los resultados anteriores y empieza a registrar accesos.
+ */
+void reuse_start() {
+    for (int i = 0; i < REUSE_NLINE_SIZES; i++) {
+        reuse_tracker_t *t = &TRACKERS[i];
+        tracker_free(t);
+        t->line_shift = LINE_SHIFTS[i];
+        t->capacity = 1024;
+        t->keys = calloc(t->capacity, sizeof(uint64_t));
+        t->stamps = malloc(t->capacity * sizeof(uint64_t));
+        t->tree_size = REUSE_MIN_TREE;
+        t->tree = calloc(t->tree_size, sizeof(uint32_t));
+        t->histogram_size = 1024;
+        t->histogram = calloc(t->histogram_size, sizeof(uint64_t));
+    }
+    REUSE_ENABLED = TRUE;
+}
+
+
+/**
+ * Deja de registrar accesos. Los histogramas se conservan para el reporte.
+ */
+void reuse_stop() {
+    REUSE_ENABLED = FALSE;
+}
+
+
+/**
+ * Registra un acceso de datos del programa simulado en todos los
+ * tamanios de linea.
+ *
+ * Params: address (uint64_t): Direccion accedida.
+ */
+void reuse_access(uint64_t address) {
+    for (int i = 0; i < REUSE_NLINE_SIZES; i++)
+        tracker_access(&TRACKERS[i], address);
+}
+
+
+/**
+ * Imprime las curvas de tasa de fallos: una fila por tamanio de cache
+ * (potencias de dos, en bytes) y una columna por tamanio de linea.
+ *
+ * Params: out (FILE *): Archivo de salida.
+ */
+void reuse_report(FILE *out) {
+    uint64_t *misses_from[REUSE_NLINE_SIZES];
+    uint64_t max_bytes = 0;
+
+    if (TRACKERS[0].accesses == 0) {
+        fprintf(out, "\nReuse distance: no accesses recorded\n\n");
+        return;
+    }
+
+    /* misses_from[i][d] = accesos con distancia >= d (sin contar los frios) */
+    for (int i = 0; i < REUSE_NLINE_SIZES; i++) {
+        reuse_tracker_t *t = &TRACKERS[i];
+        misses_from[i] = malloc((t->histogram_size + 1) * sizeof(uint64_t));
+        misses_from[i][t->histogram_size] = 0;
+        for (uint64_t d = t->histogram_size; d > 0; d--)
+            misses_from[i][d - 1] = misses_from[i][d] + t->histogram[d - 1];
+        if ((t->count << t->line_shift) > max_bytes)
+            max_bytes = t->count << t->line_shift;
+    }
+
+    fprintf(out, "\nMiss ratio curve (fully-associative LRU, %" PRIu64 " accesses) :\n",
+            TRACKERS[0].accesses);
+    fprintf(out, "-------------------------------------\n");
+    fprintf(out, "%12s", "cache bytes");
+    for (int i = 0; i < REUSE_NLINE_SIZES; i++)
+        fprintf(out, "  %5uB line", 1u << LINE_SHIFTS[i]);
+    fprintf(out, "\n");
+
+    for (uint64_t bytes = 1u << LINE_SHIFTS[0];
+         bytes < max_bytes * 2; bytes *= 2) {
+        fprintf(out, "%12" PRIu64, bytes);
+        for (int i = 0; i < REUSE_NLINE_SIZES; i++) {
+            reuse_tracker_t *t = &TRACKERS[i];
+            uint64_t lines = bytes >> t->line_shift;
+            if (lines == 0) {
+                fprintf(out, "  %11s", "-");
+                continue;
+            }
+            uint64_t misses = t->cold_misses +
+                (lines < t->histogram_size ? misses_from[i][lines] : 0);
+            fprintf(out, "  %11.6f", (double)misses / t->accesses);
+        }
+        fprintf(out, "\n");
+    }
+    fprintf(out, "%12s", "cold");
+    for (int i = 0; i < REUSE_NLINE_SIZES; i++)
+        fprintf(out, "  %11" PRIu64, TRACKERS[i].cold_misses);
+    fprintf(out, "\n\n");
+
+    for (int i = 0; i < REUSE_NLINE_SIZES; i++)
+        free(misses_from[i]);
+}
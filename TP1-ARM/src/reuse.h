@@ -0,0 +1,20 @@
+/***************************************************************/
+/*                                                             */
+/*   Analisis de distancia de reuso (Mattson)                  */
+/*                                                             */
+/***************************************************************/
+
+#ifndef _SIM_REUSE_H_
+#define _SIM_REUSE_H_
+
+#include <stdio.h>
+#include <inttypes.h>
+
+extern int REUSE_ENABLED;
+
+void reuse_start();
+void reuse_stop();
+void reuse_access(uint64_t address);
+void reuse_report(FILE *out);
+
+#endif
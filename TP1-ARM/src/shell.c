@@ -25,42 +25,54 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
+#include <math.h>
 #include <inttypes.h>
 #include "shell.h"
+#include "reuse.h"
+#include "ilp.h"
+#include "bbv.h"
+#include "sim.h"
+#include "timing.h"
+#include "hprof.h"
+#include "plugin_loader.h"
+#include "live.h"
+#include "checkpoint.h"
+#include "dirty.h"
+#include "timetravel.h"
+#include "breakpoint.h"
+#include "memdiff.h"
+#include "memsearch.h"
+#include "loader.h"
+#include "elfload.h"
+#include "pdcache.h"
+#include "syscalls.h"
+#include "bitops.h"
+#include "crypto.h"
+#include "neon.h"
+#include "fpu.h"
+#include "callgraph.h"
 
 /***************************************************************/
 /* Main memory.                                                */
 /***************************************************************/
 
-#define MEM_DATA_START  0x10000000
-#define MEM_DATA_SIZE   0x00100000
-#define MEM_TEXT_START  0x00400000
-#define MEM_TEXT_SIZE   0x00100000
-#define MEM_STACK_START 0xfffffffc
-#define MEM_STACK_SIZE  0x00100000
-
-typedef struct {
-    uint64_t start, size;
-    uint8_t *mem;
-} mem_region_t;
-
 /* memory will be dynamically allocated at initialization */
-mem_region_t MEM_REGIONS[] = {
+mem_region_t MEM_REGIONS[MEM_NREGIONS] = {
     { MEM_TEXT_START, MEM_TEXT_SIZE, NULL },
     { MEM_DATA_START, MEM_DATA_SIZE, NULL },
     { MEM_STACK_START, MEM_STACK_SIZE, NULL },
 };
 
-#define MEM_NREGIONS (sizeof(MEM_REGIONS)/sizeof(mem_region_t))
-
 /***************************************************************/
 /* CPU State info.                                             */
 /***************************************************************/
 
 CPU_State CURRENT_STATE, NEXT_STATE;
 int RUN_BIT;	/* run bit */
-int INSTRUCTION_COUNT;
+uint64_t INSTRUCTION_COUNT;
+uint32_t VECTORS_WRITTEN;
 
 
 /***************************************************************/
@@ -71,6 +83,32 @@ int INSTRUCTION_COUNT;
 /*                                                             */
 /***************************************************************/
 uint32_t mem_read_32(uint64_t address)
+{
+    if (REUSE_ENABLED)
+        reuse_access(address);
+    if (ILP_ENABLED)
+        ilp_mem_read(address);
+    if (TIMING_ENABLED)
+        timing_mem_access(address);
+    if (PLUGIN_MEM_HOOKS)
+        plugin_mem_access(address, FALSE);
+    if (LIVE_ENABLED)
+        live_mem_access(FALSE);
+    if (WATCHPOINTS_SET)
+        watch_access(address, FALSE);
+
+    return mem_peek_32(address);
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure: mem_peek_32                                      */
+/*                                                             */
+/* Purpose: Read a 32-bit word from memory without reporting   */
+/*          the access to the analyzers (fetch, mdump)         */
+/*                                                             */
+/***************************************************************/
+uint32_t mem_peek_32(uint64_t address)
 {
     int i;
     for (i = 0; i < MEM_NREGIONS; i++) {
@@ -99,6 +137,20 @@ uint32_t mem_read_32(uint64_t address)
 void mem_write_32(uint64_t address, uint32_t value)
 {
     int i;
+
+    if (REUSE_ENABLED)
+        reuse_access(address);
+    if (ILP_ENABLED)
+        ilp_mem_write(address);
+    if (TIMING_ENABLED)
+        timing_mem_access(address);
+    if (PLUGIN_MEM_HOOKS)
+        plugin_mem_access(address, TRUE);
+    if (LIVE_ENABLED)
+        live_mem_access(TRUE);
+    if (WATCHPOINTS_SET)
+        watch_access(address, TRUE);
+
     for (i = 0; i < MEM_NREGIONS; i++) {
         if (address >= MEM_REGIONS[i].start &&
                 address < (MEM_REGIONS[i].start + MEM_REGIONS[i].size)) {
@@ -108,6 +160,10 @@ void mem_write_32(uint64_t address, uint32_t value)
             MEM_REGIONS[i].mem[offset+2] = (value >> 16) & 0xFF;
             MEM_REGIONS[i].mem[offset+1] = (value >>  8) & 0xFF;
             MEM_REGIONS[i].mem[offset+0] = (value >>  0) & 0xFF;
+            if (DIRTY_TRACKING)
+                dirty_write(i, offset);
+            if (MEM_REGIONS[i].start == MEM_TEXT_START)
+                predecode_invalidate(address);
             return;
         }
     }
@@ -126,10 +182,57 @@ void help() {
   printf("mdump low high   -  dump memory from low to high      \n");
   printf("rdump            -  dump the register & bus values    \n");
   printf("input reg_no reg_value - set GPR reg_no to reg_value  \n");
+  printf("reuse on|off|report - stack-distance miss ratio curves \n");
+  printf("ilp on|off|report - dataflow critical path / ideal IPC \n");
+  printf("ilp latency class n - set alu|mul|load|store|branch|div|fp latency\n");
+  printf("bbv on n         -  collect block vectors every n instructions\n");
+  printf("bbv off|report k -  stop / pick SimPoints with up to k clusters\n");
+  printf("sample p w u     -  run to HALT, warming w and measuring u\n");
+  printf("                    instructions in detail every p instructions\n");
+  printf("                    (only this fast path fuses instructions)\n");
+  printf("hprof on n|off|report - host cost per handler, 1 of n insts\n");
+  printf("callgraph on|off|report - per-function inclusive/self costs\n");
+  printf("callgraph dump f -  write the call graph in callgrind format\n");
+  printf("plugin load f [args] - load an instrumentation plugin\n");
+  printf("plugin unload|list -  unload all / list loaded plugins  \n");
+  printf("live on [name]|off - publish live counters for simtop \n");
+  printf("save file        -  checkpoint the machine state      \n");
+  printf("restore file     -  map a checkpoint back (copy-on-write)\n");
+  printf("timetravel on n|off|report - record history, snapshot every n\n");
+  printf("reverse-step [n] -  go back n instructions (default 1) \n");
+  printf("reverse-continue -  go back to the previous stop point \n");
+  printf("goto k           -  go to the state before instruction k\n");
+  printf("break addr|del addr|list - instruction breakpoints    \n");
+  printf("watch lo hi r|w|rw - stop after accesses to [lo, hi]  \n");
+  printf("watch del n|list -  delete / list watchpoints         \n");
+  printf("snapshot mark|diff - compare memory against a mark   \n");
+  printf("search bytes b0 b1 .. - find a byte sequence in memory\n");
+  printf("search word|dword v - find an aligned 32/64-bit value  \n");
+  printf("search masked v m - find aligned words with (w & m) == v\n");
   printf("?                -  display this help menu            \n");
   printf("quit             -  exit the program                  \n\n");
 }
 
+/***************************************************************/
+/*                                                             */
+/* Procedure : commit_state                                    */
+/*                                                             */
+/* Purpose   : Make NEXT_STATE the current state. Only the     */
+/*             vector registers the instruction wrote are      */
+/*             copied: the whole V file is 512 bytes and       */
+/*             copying it every instruction made integer code  */
+/*             about 20% slower.                               */
+/*                                                             */
+/***************************************************************/
+void commit_state() {
+  memcpy(&CURRENT_STATE, &NEXT_STATE, offsetof(CPU_State, V));
+  while (VECTORS_WRITTEN) {
+    int r = __builtin_ctz(VECTORS_WRITTEN);
+    CURRENT_STATE.V[r] = NEXT_STATE.V[r];
+    VECTORS_WRITTEN &= VECTORS_WRITTEN - 1;
+  }
+}
+
 /***************************************************************/
 /*                                                             */
 /* Procedure : cycle                                           */
@@ -138,10 +241,102 @@ void help() {
 /*                                                             */
 /***************************************************************/
 void cycle() {                                                
+  uint64_t pc = CURRENT_STATE.PC;
 
+  if (HPROF_ENABLED)
+    hprof_begin();
+  if (PLUGINS_ACTIVE)
+    plugin_before_instruction();
   process_instruction();
-  CURRENT_STATE = NEXT_STATE;
+  commit_state();
+  INSTRUCTION_COUNT++;
+  if (CALLGRAPH_ENABLED)
+    callgraph_tick(pc);
+  if (PLUGINS_ACTIVE)
+    plugin_after_instruction();
+  if (LIVE_ENABLED)
+    live_tick();
+  if (TIMETRAVEL_ENABLED)
+    timetravel_tick();
+  if (HPROF_ACTIVE)
+    hprof_end();
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : cycle_fast                                      */
+/*                                                             */
+/* Purpose   : Execute a cycle through the predecoded path.    */
+/*             With no per-instruction hook active, a fused    */
+/*             sequence of up to budget instructions retires   */
+/*             in one step. Returns the instructions executed. */
+/*                                                             */
+/***************************************************************/
+int cycle_fast(uint64_t budget) {
+  uint64_t pc = CURRENT_STATE.PC;
+  int retired;
+
+  if (!HPROF_ENABLED && !PLUGINS_ACTIVE && !CALLGRAPH_ENABLED &&
+      !LIVE_ENABLED && !TIMETRAVEL_ENABLED &&
+      (retired = process_fused(budget)) > 0) {
+    commit_state();
+    INSTRUCTION_COUNT += retired;
+    return retired;
+  }
+
+  if (HPROF_ENABLED)
+    hprof_begin();
+  if (PLUGINS_ACTIVE)
+    plugin_before_instruction();
+  process_instruction_fast();
+  commit_state();
   INSTRUCTION_COUNT++;
+  if (CALLGRAPH_ENABLED)
+    callgraph_tick(pc);
+  if (PLUGINS_ACTIVE)
+    plugin_after_instruction();
+  if (LIVE_ENABLED)
+    live_tick();
+  if (TIMETRAVEL_ENABLED)
+    timetravel_tick();
+  if (HPROF_ACTIVE)
+    hprof_end();
+  return 1;
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : cycle_detailed                                  */
+/*                                                             */
+/* Purpose   : Execute a cycle through the predecoded path and */
+/*             feed it to the timing model                     */
+/*                                                             */
+/***************************************************************/
+void cycle_detailed() {
+  uint64_t pc = CURRENT_STATE.PC;
+  int index;
+
+  if (HPROF_ENABLED)
+    hprof_begin();
+  if (PLUGINS_ACTIVE)
+    plugin_before_instruction();
+  index = process_instruction_fast();
+
+  timing_instruction(pc, mem_peek_32(pc),
+                     index < 0 ? 0 : INSTRUCTION_SET[index].effects,
+                     NEXT_STATE.PC);
+  commit_state();
+  INSTRUCTION_COUNT++;
+  if (CALLGRAPH_ENABLED)
+    callgraph_tick(pc);
+  if (PLUGINS_ACTIVE)
+    plugin_after_instruction();
+  if (LIVE_ENABLED)
+    live_tick();
+  if (TIMETRAVEL_ENABLED)
+    timetravel_tick();
+  if (HPROF_ACTIVE)
+    hprof_end();
 }
 
 /***************************************************************/
@@ -160,13 +355,21 @@ void run(int num_cycles) {
   }
 
   printf("Simulating for %d cycles...\n\n", num_cycles);
+  debug_resume();
+  fpu_resume();
   for (i = 0; i < num_cycles; i++) {
     if (RUN_BIT == FALSE) {
 	    printf("Simulator halted\n\n");
 	    break;
     }
     cycle();
+    if (DEBUG_ACTIVE && debug_check()) {
+      printf("\n");
+      break;
+    }
   }
+  fpu_suspend();
+  syscall_flush();
 }
 
 /***************************************************************/ 
@@ -183,14 +386,14 @@ void mdump(FILE * dumpsim_file, int start, int stop) {
   printf("\nMemory content [0x%08x..0x%08x] :\n", start, stop);
   printf("-------------------------------------\n");
   for (address = start; address <= stop; address += 4)
-    printf("  0x%08x (%d) : 0x%x\n", address, address, mem_read_32(address));
+    printf("  0x%08x (%d) : 0x%x\n", address, address, mem_peek_32(address));
   printf("\n");
 
   /* dump the memory contents into the dumpsim file */
   fprintf(dumpsim_file, "\nMemory content [0x%08x..0x%08x] :\n", start, stop);
   fprintf(dumpsim_file, "-------------------------------------\n");
   for (address = start; address <= stop; address += 4)
-    fprintf(dumpsim_file, "  0x%08x (%d) : 0x%x\n", address, address, mem_read_32(address));
+    fprintf(dumpsim_file, "  0x%08x (%d) : 0x%x\n", address, address, mem_peek_32(address));
   fprintf(dumpsim_file, "\n");
 }
 
@@ -207,7 +410,7 @@ void rdump(FILE * dumpsim_file) {
 
   printf("\nCurrent register/bus values :\n");
   printf("-------------------------------------\n");
-  printf("Instruction Count : %u\n", INSTRUCTION_COUNT);
+  printf("Instruction Count : %" PRIu64 "\n", INSTRUCTION_COUNT);
   printf("PC                : 0x%" PRIx64 "\n", CURRENT_STATE.PC);
   printf("Registers:\n");
   for (k = 0; k < ARM_REGS; k++)
@@ -219,7 +422,7 @@ void rdump(FILE * dumpsim_file) {
   /* dump the state information into the dumpsim file */
   fprintf(dumpsim_file, "\nCurrent register/bus values :\n");
   fprintf(dumpsim_file, "-------------------------------------\n");
-  fprintf(dumpsim_file, "Instruction Count : %u\n", INSTRUCTION_COUNT);
+  fprintf(dumpsim_file, "Instruction Count : %" PRIu64 "\n", INSTRUCTION_COUNT);
   fprintf(dumpsim_file, "PC                : 0x%" PRIx64 "\n", CURRENT_STATE.PC);
   fprintf(dumpsim_file, "Registers:\n");
   for (k = 0; k < ARM_REGS; k++)
@@ -242,16 +445,599 @@ void go(FILE * dumpsim_file) {
   }
 
   printf("Simulating...\n\n");
+  debug_resume();
+  fpu_resume();
   while (RUN_BIT) {
     cycle();
+    if (DEBUG_ACTIVE && debug_check()) {
+      fpu_suspend();
+      syscall_flush();
+      printf("\n");
+      return;
+    }
     //printf("Going\n");
     //rdump(dumpsim_file);
     //mdump(dumpsim_file, MEM_DATA_START, MEM_DATA_START+0x100);
   }
+  fpu_suspend();
+  syscall_flush();
   printf("Simulator halted\n\n");
 }
 
 
+/***************************************************************/
+/*                                                             */
+/* Procedure : reuse_command                                   */
+/*                                                             */
+/* Purpose   : Start, stop or report the reuse-distance        */
+/*             analysis of the data access stream.             */
+/*                                                             */
+/***************************************************************/
+void reuse_command(FILE * dumpsim_file, char *action) {
+  if (strcmp(action, "on") == 0) {
+    reuse_start();
+    printf("Reuse-distance analysis enabled\n\n");
+  }
+  else if (strcmp(action, "off") == 0) {
+    reuse_stop();
+    printf("Reuse-distance analysis disabled\n\n");
+  }
+  else if (strcmp(action, "report") == 0) {
+    reuse_report(stdout);
+    reuse_report(dumpsim_file);
+  }
+  else
+    printf("Invalid Command\n");
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : ilp_command                                     */
+/*                                                             */
+/* Purpose   : Control the dataflow critical-path analyzer.    */
+/*                                                             */
+/***************************************************************/
+void ilp_command(FILE * dumpsim_file, char *action) {
+  char class_name[20];
+  int cycles;
+
+  if (strcmp(action, "on") == 0) {
+    ilp_start();
+    printf("Critical-path analysis enabled\n\n");
+  }
+  else if (strcmp(action, "off") == 0) {
+    ilp_stop();
+    printf("Critical-path analysis disabled\n\n");
+  }
+  else if (strcmp(action, "report") == 0) {
+    ilp_report(stdout);
+    ilp_report(dumpsim_file);
+  }
+  else if (strcmp(action, "latency") == 0) {
+    if (scanf("%19s %d", class_name, &cycles) != 2) return;
+    if (!ilp_set_latency(class_name, cycles))
+      printf("Invalid latency class or value\n\n");
+  }
+  else
+    printf("Invalid Command\n");
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : callgraph_command                               */
+/*                                                             */
+/* Purpose   : Control the guest call-graph profiler.          */
+/*                                                             */
+/***************************************************************/
+void callgraph_command(FILE * dumpsim_file, char *action) {
+  char path[256];
+
+  if (strcmp(action, "on") == 0) {
+    callgraph_start();
+    printf("Call-graph profiling enabled\n\n");
+  }
+  else if (strcmp(action, "off") == 0) {
+    callgraph_stop();
+    printf("Call-graph profiling disabled\n\n");
+  }
+  else if (strcmp(action, "report") == 0) {
+    callgraph_report(stdout);
+    callgraph_report(dumpsim_file);
+  }
+  else if (strcmp(action, "dump") == 0) {
+    if (scanf("%255s", path) != 1) return;
+    if (callgraph_dump(path))
+      printf("Call graph written to %s\n\n", path);
+    else
+      printf("Error: can't write call graph to %s\n\n", path);
+  }
+  else
+    printf("Invalid Command\n");
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : bbv_command                                     */
+/*                                                             */
+/* Purpose   : Collect basic-block vectors and report the      */
+/*             representative intervals (SimPoints).           */
+/*                                                             */
+/***************************************************************/
+void bbv_command(FILE * dumpsim_file, char *action) {
+  int64_t interval;
+  int max_k;
+
+  if (strcmp(action, "on") == 0) {
+    if (scanf("%" SCNd64, &interval) != 1 || interval <= 0) {
+      printf("Invalid interval length\n\n");
+      return;
+    }
+    bbv_start(interval);
+    printf("Collecting basic-block vectors every %" PRId64 " instructions\n\n", interval);
+  }
+  else if (strcmp(action, "off") == 0) {
+    bbv_stop();
+    printf("Basic-block vector collection disabled\n\n");
+  }
+  else if (strcmp(action, "report") == 0) {
+    if (scanf("%d", &max_k) != 1) return;
+    bbv_report(stdout, max_k);
+    bbv_report(dumpsim_file, max_k);
+  }
+  else
+    printf("Invalid Command\n");
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : sample                                          */
+/*                                                             */
+/* Purpose   : Simulate ARM until HALTed, alternating fast     */
+/*             functional execution with detailed windows      */
+/*             (SMARTS-style systematic sampling): every       */
+/*             period instructions, warm the timing model for  */
+/*             warmup instructions and measure the next        */
+/*             window instructions. Reports CPI with a 95%     */
+/*             confidence interval.                            */
+/*                                                             */
+/***************************************************************/
+void sample(FILE * dumpsim_file, uint64_t period, uint64_t warmup, uint64_t window) {
+  uint64_t start_count = INSTRUCTION_COUNT, i, n = 0, dispatches = 0, fast;
+  double mean = 0, m2 = 0, deviation = 0, half_width = 0;
+
+  if (RUN_BIT == FALSE) {
+    printf("Can't simulate, Simulator is halted\n\n");
+    return;
+  }
+  if (window == 0 || warmup + window > period) {
+    printf("Error: sample needs 0 < window and warmup + window <= period\n\n");
+    return;
+  }
+
+  printf("Sampling...\n\n");
+  timing_reset();
+  fpu_resume();
+  while (RUN_BIT) {
+    fast = period - warmup - window;
+    for (i = 0; i < fast && RUN_BIT; dispatches++)
+      i += cycle_fast(fast - i);
+
+    TIMING_ENABLED = TRUE;
+    for (i = 0; i < warmup && RUN_BIT; i++, dispatches++)
+      cycle_detailed();
+
+    uint64_t cycles = timing_cycles();
+    timing_set_measuring(TRUE);
+    for (i = 0; i < window && RUN_BIT; i++, dispatches++)
+      cycle_detailed();
+    timing_set_measuring(FALSE);
+    TIMING_ENABLED = FALSE;
+
+    /* keep the host FP flags of these statistics out of the guest's FPSR */
+    fpu_suspend();
+    /* a window cut short by HALT is not a valid sample */
+    if (i == window) {
+      /* Welford: mean and squared deviations without cancellation */
+      double cpi = (double)(timing_cycles() - cycles) / window;
+      double delta = cpi - mean;
+      n++;
+      mean += delta / n;
+      m2 += delta * (cpi - mean);
+    }
+    fpu_resume();
+  }
+  fpu_suspend();
+  printf("Simulator halted\n\n");
+
+  if (n > 1) {
+    deviation = sqrt(m2 / (n - 1));
+    half_width = 1.96 * deviation / sqrt(n);
+  }
+
+  for (int k = 0; k < 2; k++) {
+    FILE *out = k ? dumpsim_file : stdout;
+    fprintf(out, "\nSampled simulation :\n");
+    fprintf(out, "-------------------------------------\n");
+    fprintf(out, "Instructions          : %" PRIu64 "\n", INSTRUCTION_COUNT - start_count);
+    fprintf(out, "Samples               : %" PRIu64 " (period %" PRIu64 ", warmup %" PRIu64 ", window %" PRIu64 ")\n",
+            n, period, warmup, window);
+    fprintf(out, "CPI                   : %.4f +/- %.4f (95%% confidence", mean, half_width);
+    if (mean > 0)
+      fprintf(out, ", %.2f%%", 100 * half_width / mean);
+    fprintf(out, ")\n");
+    fprintf(out, "Estimated cycles      : %.0f\n", mean * (INSTRUCTION_COUNT - start_count));
+    if (INSTRUCTION_COUNT > start_count)
+      fprintf(out, "Dispatches            : %" PRIu64 " (%.3f per instruction)\n", dispatches,
+              (double)dispatches / (INSTRUCTION_COUNT - start_count));
+    timing_report(out);
+    fprintf(out, "\n");
+  }
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : hprof_command                                   */
+/*                                                             */
+/* Purpose   : Profile the host cost of the simulator itself.  */
+/*                                                             */
+/***************************************************************/
+void hprof_command(FILE * dumpsim_file, char *action) {
+  int64_t every;
+
+  if (strcmp(action, "on") == 0) {
+    if (scanf("%" SCNd64, &every) != 1 || every <= 0) {
+      printf("Invalid sampling period\n\n");
+      return;
+    }
+    hprof_start(every);
+    printf("Host profiling enabled (1 of every %" PRId64 " instructions)\n\n", every);
+  }
+  else if (strcmp(action, "off") == 0) {
+    hprof_stop();
+    printf("Host profiling disabled\n\n");
+  }
+  else if (strcmp(action, "report") == 0) {
+    hprof_report(stdout);
+    hprof_report(dumpsim_file);
+  }
+  else
+    printf("Invalid Command\n");
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : rest_of_line                                    */
+/*                                                             */
+/* Purpose   : Read the optional arguments left on the command */
+/*             line, without leading blanks or the newline.    */
+/*                                                             */
+/***************************************************************/
+char *rest_of_line(char *line, int size) {
+  if (fgets(line, size, stdin) == NULL) line[0] = '\0';
+  line[strcspn(line, "\n")] = '\0';
+  return line + strspn(line, " \t");
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : plugin_command                                  */
+/*                                                             */
+/* Purpose   : Load, unload or list instrumentation plugins.   */
+/*                                                             */
+/***************************************************************/
+void plugin_command(FILE * dumpsim_file, char *action) {
+  char path[256], args[256];
+
+  if (strcmp(action, "load") == 0) {
+    if (scanf("%255s", path) != 1) return;
+    /* the rest of the line is passed to the plugin */
+    if (plugin_load(path, rest_of_line(args, sizeof(args))))
+      printf("Plugin %s loaded\n\n", path);
+    else
+      printf("\n");
+  }
+  else if (strcmp(action, "unload") == 0) {
+    plugin_unload_all();
+    printf("Plugins unloaded\n\n");
+  }
+  else if (strcmp(action, "list") == 0)
+    plugin_list();
+  else
+    printf("Invalid Command\n");
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : live_command                                    */
+/*                                                             */
+/* Purpose   : Start or stop publishing live counters in       */
+/*             shared memory.                                  */
+/*                                                             */
+/***************************************************************/
+void live_command(FILE * dumpsim_file, char *action) {
+  char line[64], *name;
+
+  if (strcmp(action, "on") == 0) {
+    /* the name is optional: read the rest of the line */
+    name = rest_of_line(line, sizeof(line));
+    name[strcspn(name, " \t")] = '\0';
+    live_start(name[0] ? name : NULL);
+    printf("\n");
+  }
+  else if (strcmp(action, "off") == 0) {
+    live_stop();
+    printf("Live counters disabled\n\n");
+  }
+  else
+    printf("Invalid Command\n");
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : timetravel_command                              */
+/*                                                             */
+/* Purpose   : Start, stop or report the execution history     */
+/*             used by reverse-step, reverse-continue and goto.*/
+/*                                                             */
+/***************************************************************/
+void timetravel_command(FILE * dumpsim_file, char *action) {
+  int64_t interval;
+
+  if (strcmp(action, "on") == 0) {
+    if (scanf("%" SCNd64, &interval) != 1 || interval <= 0) {
+      printf("Invalid snapshot interval\n\n");
+      return;
+    }
+    timetravel_start(interval);
+    printf("Recording history from instruction %" PRIu64 " (snapshot every %" PRId64 ")\n\n",
+           INSTRUCTION_COUNT, interval);
+  }
+  else if (strcmp(action, "off") == 0) {
+    timetravel_stop();
+    printf("History discarded\n\n");
+  }
+  else if (strcmp(action, "report") == 0) {
+    timetravel_report(stdout);
+    timetravel_report(dumpsim_file);
+  }
+  else
+    printf("Invalid Command\n");
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : travel                                          */
+/*                                                             */
+/* Purpose   : Move through the recorded history: back n       */
+/*             instructions, back to the previous stop point,  */
+/*             or to an absolute instruction number.           */
+/*                                                             */
+/***************************************************************/
+void travel(char *command) {
+  char line[64];
+  uint64_t target = 0, steps = 1;
+
+  if (!TIMETRAVEL_ENABLED) {
+    printf("No history: use 'timetravel on n' first\n\n");
+    rest_of_line(line, sizeof(line));
+    return;
+  }
+
+  if (strcmp(command, "goto") == 0) {
+    if (scanf("%" SCNu64, &target) != 1) return;
+    timetravel_goto(target);
+  }
+  else if (strcmp(command, "reverse-step") == 0) {
+    char *count = rest_of_line(line, sizeof(line));
+    if (count[0] && sscanf(count, "%" SCNu64, &steps) != 1) {
+      printf("Invalid step count\n\n");
+      return;
+    }
+    timetravel_goto(steps > INSTRUCTION_COUNT ? 0 : INSTRUCTION_COUNT - steps);
+  }
+  else {
+    TIMETRAVEL_STOP_CONDITION = DEBUG_ACTIVE ? debug_replay_condition : NULL;
+    if (!timetravel_reverse_continue())
+      printf("Reached the start of the history\n");
+  }
+
+  printf("At instruction %" PRIu64 ", PC 0x%" PRIx64 "%s\n\n", INSTRUCTION_COUNT,
+         CURRENT_STATE.PC, RUN_BIT ? "" : " (halted)");
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : break_command                                   */
+/*                                                             */
+/* Purpose   : Add, delete or list breakpoints.                */
+/*                                                             */
+/***************************************************************/
+void break_command(FILE * dumpsim_file, char *argument) {
+  uint64_t address;
+  char location[128];
+
+  if (strcmp(argument, "list") == 0) {
+    breakpoint_list(stdout);
+    breakpoint_list(dumpsim_file);
+  }
+  else if (strcmp(argument, "del") == 0) {
+    if (scanf("%127s", location) != 1) return;
+    if (!elf_parse_address(location, &address)) {
+      printf("Unknown address or symbol %s\n\n", location);
+      return;
+    }
+    if (breakpoint_delete(address))
+      printf("Breakpoint at 0x%" PRIx64 " deleted\n", address);
+    printf("\n");
+  }
+  else if (elf_parse_address(argument, &address)) {
+    if (breakpoint_add(address)) {
+      printf("Breakpoint at 0x%" PRIx64, address);
+      elf_print_address(stdout, address);
+      printf("\n");
+    }
+    printf("\n");
+  }
+  else
+    printf("Unknown address or symbol %s\n\n", argument);
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : watch_command                                   */
+/*                                                             */
+/* Purpose   : Add, delete or list watchpoints.                */
+/*                                                             */
+/***************************************************************/
+void watch_command(FILE * dumpsim_file, char *argument) {
+  int64_t low, high;
+  char mode[4];
+  int number;
+
+  if (strcmp(argument, "list") == 0) {
+    watchpoint_list(stdout);
+    watchpoint_list(dumpsim_file);
+  }
+  else if (strcmp(argument, "del") == 0) {
+    if (scanf("%d", &number) != 1) return;
+    if (watchpoint_delete(number))
+      printf("Watchpoint %d deleted\n", number);
+    printf("\n");
+  }
+  else if (sscanf(argument, "%" SCNi64, &low) == 1) {
+    if (scanf("%" SCNi64 " %3s", &high, mode) != 2) return;
+    if (watchpoint_add(low, high, (strchr(mode, 'r') ? WATCH_READ : 0) |
+                                  (strchr(mode, 'w') ? WATCH_WRITE : 0)))
+      printf("Watching 0x%" PRIx64 "..0x%" PRIx64 " (%s)\n", low, high, mode);
+    printf("\n");
+  }
+  else
+    printf("Invalid Command\n");
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : search_command                                  */
+/*                                                             */
+/* Purpose   : Search guest memory for a byte sequence, an      */
+/*             aligned 32/64-bit value or a masked word.       */
+/*                                                             */
+/***************************************************************/
+void search_command(FILE * dumpsim_file, char *kind) {
+  char line[256], *token;
+  uint8_t pattern[64];
+  int length = 0;
+  uint64_t value, mask;
+
+  if (strcmp(kind, "bytes") == 0) {
+    /* hex bytes, either separated ("de ad") or run together ("dead") */
+    for (token = strtok(rest_of_line(line, sizeof(line)), " \t"); token; token = strtok(NULL, " \t")) {
+      if (strncmp(token, "0x", 2) == 0) token += 2;
+      for (; token[0] && token[1] && length < (int)sizeof(pattern); token += 2) {
+        unsigned int byte;
+        if (sscanf(token, "%2x", &byte) != 1) break;
+        pattern[length++] = byte;
+      }
+    }
+    if (length == 0) {
+      printf("Invalid byte pattern\n\n");
+      return;
+    }
+    memsearch_bytes(pattern, length, 1);
+  }
+  else if (strcmp(kind, "word") == 0) {
+    if (scanf("%" SCNi64, &value) != 1) return;
+    memsearch_masked(value, 0xFFFFFFFF);
+  }
+  else if (strcmp(kind, "dword") == 0) {
+    if (scanf("%" SCNi64, &value) != 1) return;
+    for (length = 0; length < 8; length++)
+      pattern[length] = value >> (8 * length);
+    memsearch_bytes(pattern, 8, 4);
+  }
+  else if (strcmp(kind, "masked") == 0) {
+    if (scanf("%" SCNi64 " %" SCNi64, &value, &mask) != 2) return;
+    memsearch_masked(value, mask);
+  }
+  else {
+    printf("Invalid Command\n");
+    return;
+  }
+  memsearch_report(stdout);
+  memsearch_report(dumpsim_file);
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : snapshot_command                                */
+/*                                                             */
+/* Purpose   : Mark memory or report what changed since the    */
+/*             mark.                                           */
+/*                                                             */
+/***************************************************************/
+void snapshot_command(FILE * dumpsim_file, char *action) {
+  if (strcmp(action, "mark") == 0) {
+    memdiff_mark();
+    printf("Memory marked at instruction %" PRIu64 "\n\n", INSTRUCTION_COUNT);
+  }
+  else if (strcmp(action, "diff") == 0) {
+    memdiff_report(stdout);
+    memdiff_report(dumpsim_file);
+  }
+  else
+    printf("Invalid Command\n");
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : save_command                                    */
+/*                                                             */
+/* Purpose   : Write a checkpoint of the whole machine.        */
+/*                                                             */
+/***************************************************************/
+void save_command() {
+  char path[256];
+
+  if (scanf("%255s", path) != 1) return;
+  checkpoint_save(path);
+  printf("\n");
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : restore_command                                 */
+/*                                                             */
+/* Purpose   : Load a checkpoint; the time-travel history no    */
+/*             longer applies and is dropped.                  */
+/*                                                             */
+/***************************************************************/
+void restore_command() {
+  char path[256];
+
+  if (scanf("%255s", path) != 1) return;
+  if (checkpoint_restore(path) && TIMETRAVEL_ENABLED) {
+    timetravel_stop();
+    printf("History discarded\n");
+  }
+  printf("\n");
+}
+
+/***************************************************************/
+/*                                                             */
+/* Procedure : sample_command                                  */
+/*                                                             */
+/* Purpose   : Read the sampling period, warm-up and window,   */
+/*             then run the sampled simulation.                */
+/*                                                             */
+/***************************************************************/
+void sample_command(FILE * dumpsim_file) {
+  uint64_t period, warmup, window;
+
+  if (scanf("%" SCNu64 " %" SCNu64 " %" SCNu64, &period, &warmup, &window) != 3)
+    return;
+  sample(dumpsim_file, period, warmup, window);
+}
+
 /***************************************************************/
 /*                                                             */
 /* Procedure : get_command                                     */
@@ -269,13 +1055,52 @@ void get_command(FILE * dumpsim_file) {
 
   if (scanf("%s", buffer) == EOF)
       exit(0);
+  /* program input (SVC read from fd 0) starts on the next line */
+  syscall_shell_command();
 
   printf("\n");
 
   switch(buffer[0]) {
   case 'G':
   case 'g':
-    go(dumpsim_file);
+    if (strcmp(buffer, "goto") == 0)
+      travel(buffer);
+    else
+      go(dumpsim_file);
+    break;
+
+  case 'B':
+  case 'b':
+    if (strcmp(buffer, "bbv") == 0) {
+      if (scanf("%19s", buffer) != 1) break;
+      bbv_command(dumpsim_file, buffer);
+    }
+    else if (strcmp(buffer, "break") == 0) {
+      if (scanf("%19s", buffer) != 1) break;
+      break_command(dumpsim_file, buffer);
+    }
+    else
+      printf("Invalid Command\n");
+    break;
+
+  case 'C':
+  case 'c':
+    if (strcmp(buffer, "callgraph") == 0) {
+      if (scanf("%19s", buffer) != 1) break;
+      callgraph_command(dumpsim_file, buffer);
+    }
+    else
+      printf("Invalid Command\n");
+    break;
+
+  case 'L':
+  case 'l':
+    if (strcmp(buffer, "live") == 0) {
+      if (scanf("%19s", buffer) != 1) break;
+      live_command(dumpsim_file, buffer);
+    }
+    else
+      printf("Invalid Command\n");
     break;
 
   case 'M':
@@ -290,14 +1115,61 @@ void get_command(FILE * dumpsim_file) {
     help();
     break;
 
+  case 'S':
+  case 's':
+    if (strcmp(buffer, "snapshot") == 0) {
+      if (scanf("%19s", buffer) != 1) break;
+      snapshot_command(dumpsim_file, buffer);
+    }
+    else if (strcmp(buffer, "search") == 0) {
+      if (scanf("%19s", buffer) != 1) break;
+      search_command(dumpsim_file, buffer);
+    }
+    else if (strcmp(buffer, "save") == 0)
+      save_command();
+    else
+      sample_command(dumpsim_file);
+    break;
+
+  case 'P':
+  case 'p':
+    if (strcmp(buffer, "plugin") == 0) {
+      if (scanf("%19s", buffer) != 1) break;
+      plugin_command(dumpsim_file, buffer);
+    }
+    else
+      printf("Invalid Command\n");
+    break;
+
+  case 'T':
+  case 't':
+    if (strcmp(buffer, "timetravel") == 0) {
+      if (scanf("%19s", buffer) != 1) break;
+      timetravel_command(dumpsim_file, buffer);
+    }
+    else
+      printf("Invalid Command\n");
+    break;
+
   case 'Q':
   case 'q':
+    plugin_unload_all();
+    live_stop();
+    syscall_flush();
     printf("Bye.\n");
     exit(0);
 
   case 'R':
   case 'r':
-    if (buffer[1] == 'd' || buffer[1] == 'D')
+    if (strcmp(buffer, "reuse") == 0) {
+      if (scanf("%19s", buffer) != 1) break;
+      reuse_command(dumpsim_file, buffer);
+    }
+    else if (strcmp(buffer, "restore") == 0)
+      restore_command();
+    else if (strcmp(buffer, "reverse-step") == 0 || strcmp(buffer, "reverse-continue") == 0)
+      travel(buffer);
+    else if (buffer[1] == 'd' || buffer[1] == 'D')
 	    rdump(dumpsim_file);
     else {
 	    if (scanf("%d", &cycles) != 1) break;
@@ -305,14 +1177,39 @@ void get_command(FILE * dumpsim_file) {
     }
     break;
 
+  case 'H':
+  case 'h':
+    if (strcmp(buffer, "hprof") == 0) {
+      if (scanf("%19s", buffer) != 1) break;
+      hprof_command(dumpsim_file, buffer);
+    }
+    else
+      printf("Invalid Command\n");
+    break;
+
   case 'I':
   case 'i':
+   if (strcmp(buffer, "ilp") == 0) {
+     if (scanf("%19s", buffer) != 1) break;
+     ilp_command(dumpsim_file, buffer);
+     break;
+   }
    if (scanf("%i %" PRIx64, &register_no, &register_value) != 2)
       break;
    CURRENT_STATE.REGS[register_no] = register_value;
    NEXT_STATE.REGS[register_no] = register_value;
    break;
 
+  case 'W':
+  case 'w':
+    if (strcmp(buffer, "watch") == 0) {
+      if (scanf("%19s", buffer) != 1) break;
+      watch_command(dumpsim_file, buffer);
+    }
+    else
+      printf("Invalid Command\n");
+    break;
+
   default:
     printf("Invalid Command\n");
     break;
@@ -343,32 +1240,49 @@ void init_memory() {
 /*                                                            */
 /**************************************************************/
 void load_program(char *program_filename) {                   
-  FILE * prog;
-  int ii, word;
+  int64_t words;
+  uint64_t entry, data_end, phdr, phnum;
 
-  /* Open program file. */
-  prog = fopen(program_filename, "r");
-  if (prog == NULL) {
-    printf("Error: Can't open program file %s\n", program_filename);
-    exit(-1);
+  /* ELF executables and objects carry their own layout and entry point. */
+  if (elf_is_image(program_filename)) {
+    int loaded = elf_load(program_filename, &entry);
+    if (loaded < 0)
+      exit(-1);
+    CURRENT_STATE.PC = entry;
+    /* Linux process environment for SVC #0 programs (see syscalls.c). */
+    elf_image_layout(&data_end, &phdr, &phnum);
+    syscall_reset(data_end);
+    syscall_setup_process(program_filename, entry, phdr, phnum);
+    printf("Read ELF image with %d sections/segments, entry 0x%" PRIx64 ".\n\n", loaded, entry);
+    return;
   }
 
-  /* Read in the program. */
-
-  ii = 0;
-  int bytes_read = EOF;
-  while ((bytes_read=fscanf(prog, "%x\n", &word)) > 0) {
-    mem_write_32(MEM_TEXT_START + ii, word);
-    ii += 4;
-  }
-  if (bytes_read == 0) {
-    printf("Error: Malformed program file %s\n", program_filename);
+  /* Read in the program (mmap + table-driven hex parse, see loader.c). */
+  words = load_hex_image(program_filename);
+  if (words < 0)        /* already reported, with line and column */
     exit(-1);
-  }
 
   CURRENT_STATE.PC = MEM_TEXT_START;
+  syscall_reset(MEM_DATA_START);
 
-  printf("Read %d words from program into memory.\n\n", ii/4);
+  printf("Read %d words from program into memory.\n\n", (int)words);
+}
+
+/************************************************************/
+/*                                                          */
+/* Procedure : init_tables                                  */
+/*                                                          */
+/* Purpose   : Build the lookup tables and pick the host     */
+/*             implementations (bitops, crypto, NEON, FPU).  */
+/*             Needed by every start, including sim -r.      */
+/*                                                          */
+/************************************************************/
+void init_tables() {
+  loader_init();
+  bitops_init();
+  crypto_init();
+  neon_init();
+  fpu_init();
 }
 
 /************************************************************/
@@ -383,10 +1297,13 @@ void initialize(char *program_filename, int num_prog_files) {
   int i;
 
   init_memory();
+  init_tables();
   for ( i = 0; i < num_prog_files; i++ ) {
     load_program(program_filename);
     while(*program_filename++ != '\0');
   }
+  /* Predecode the whole image, or map it from the on-disk cache. */
+  pdcache_prepare(CURRENT_STATE.PC);
   NEXT_STATE = CURRENT_STATE;
     
   RUN_BIT = TRUE;
@@ -401,15 +1318,24 @@ int main(int argc, char *argv[]) {
   FILE * dumpsim_file;
 
   /* Error Checking */
-  if (argc < 2) {
+  if (argc < 2 || (strcmp(argv[1], "-r") == 0 && argc != 3)) {
     printf("Error: usage: %s <program_file_1> <program_file_2> ...\n",
            argv[0]);
+    printf("       %s -r <checkpoint_file>\n", argv[0]);
     exit(1);
   }
 
   printf("ARM Simulator\n\n");
 
-  initialize(argv[1], argc - 1);
+  if (strcmp(argv[1], "-r") == 0) {
+    /* start from a checkpoint: no program is parsed or copied */
+    init_tables();
+    if (!checkpoint_restore(argv[2]))
+      exit(1);
+    printf("\n");
+  }
+  else
+    initialize(argv[1], argc - 1);
 
   if ( (dumpsim_file = fopen( "dumpsim", "w" )) == NULL ) {
     printf("Error: Can't open dumpsim file\n");
@@ -21,11 +21,41 @@
 
 #define ARM_REGS 32
 
+#define MEM_DATA_START  0x10000000
+#define MEM_DATA_SIZE   0x00100000
+#define MEM_TEXT_START  0x00400000
+#define MEM_TEXT_SIZE   0x00100000
+#define MEM_STACK_START 0xfffffffc
+#define MEM_STACK_SIZE  0x00100000
+
+typedef struct {
+    uint64_t start, size;
+    uint8_t *mem;
+} mem_region_t;
+
+#define MEM_NREGIONS 3
+
+extern mem_region_t MEM_REGIONS[MEM_NREGIONS];
+
+/* Registro SIMD/FP de 128 bits; el elemento 0 es el de menor peso. */
+typedef union {
+    uint8_t b[16];
+    uint16_t h[8];
+    uint32_t s[4];
+    uint64_t d[2];
+} vreg_t;
+
 typedef struct CPU_State_Struct {
   uint64_t PC;		          /* program counter */
   int64_t REGS[ARM_REGS];   /* register file. */
+  uint64_t SP;              /* stack pointer */
   int FLAG_N;               /* flag N */
   int FLAG_Z;               /* flag Z */
+  int FLAG_C;               /* flag C */
+  int FLAG_V;               /* flag V */
+  uint32_t FPCR;            /* control de punto flotante */
+  uint32_t FPSR;            /* estado de punto flotante */
+  vreg_t V[32];             /* registros SIMD/FP (Q0-Q31), ver commit_state */
 } CPU_State;
 
 /* Data Structure for Latch */
@@ -33,9 +63,14 @@ typedef struct CPU_State_Struct {
 extern CPU_State CURRENT_STATE, NEXT_STATE;
 
 extern int RUN_BIT;	/* run bit */
+extern uint64_t INSTRUCTION_COUNT;
+extern uint32_t VECTORS_WRITTEN;	/* registros V escritos en NEXT_STATE */
+
+void commit_state();
 
 uint32_t mem_read_32(uint64_t address);
 void     mem_write_32(uint64_t address, uint32_t value);
+uint32_t mem_peek_32(uint64_t address);
 
 /* YOU IMPLEMENT THIS FUNCTION */
 void process_instruction();
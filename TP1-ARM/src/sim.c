@@ -1,9 +1,20 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include "shell.h"
+#include "sim.h"
+#include "ilp.h"
+#include "bbv.h"
+#include "hprof.h"
+#include "live.h"
+#include "syscalls.h"
+#include "bitops.h"
+#include "crypto.h"
+#include "neon.h"
+#include "fpu.h"
 #include "inttypes.h"
 
 void decode_instruction();
@@ -12,8 +23,7 @@ void decode_adds_immediate(uint32_t instruction);
 void decode_subs_extended(uint32_t instruction);
 void decode_subs_immediate(uint32_t instruction);
 void decode_halt(uint32_t instruction);
-void decode_cmp_immediate(uint32_t instruction);
-void decode_cmp_extended(uint32_t instruction);
+void decode_svc(uint32_t instruction);
 void decode_ands(uint32_t instruction);
 void decode_eor(uint32_t instruction);
 void decode_orr(uint32_t instruction);
@@ -33,7 +43,50 @@ void decode_ldur(uint32_t instruction);
 void decode_ldurb(uint32_t instruction);
 void decode_ldurh(uint32_t instruction);
 bool calculate_address(uint32_t instruction, uint64_t *address, uint32_t *Rt);
-void decode_lsl_lsr_imm(uint32_t instruction);
+void decode_movk(uint32_t instruction);
+void decode_movn(uint32_t instruction);
+void decode_adr(uint32_t instruction);
+void decode_add_sub_immediate(uint32_t instruction);
+void decode_add_sub_shifted(uint32_t instruction);
+void decode_add_sub_extended(uint32_t instruction);
+void decode_logical_shifted(uint32_t instruction);
+void decode_conditional_select(uint32_t instruction);
+void decode_tbz(uint32_t instruction);
+void decode_load_store_pair(uint32_t instruction);
+void decode_load_store_unsigned(uint32_t instruction);
+void decode_load_store_imm9(uint32_t instruction);
+void decode_load_store_register(uint32_t instruction);
+void decode_load_literal(uint32_t instruction);
+void decode_bitfield(uint32_t instruction);
+void decode_extr(uint32_t instruction);
+void decode_data_1source(uint32_t instruction);
+void decode_logical_immediate(uint32_t instruction);
+void decode_madd(uint32_t instruction);
+void decode_multiply_long(uint32_t instruction);
+void decode_multiply_high(uint32_t instruction);
+void decode_divide(uint32_t instruction);
+void decode_crc32(uint32_t instruction);
+void decode_aes(uint32_t instruction);
+void decode_sha_three(uint32_t instruction);
+void decode_sha_two(uint32_t instruction);
+void decode_load_store_vector(uint32_t instruction);
+void decode_load_store_vector_pair(uint32_t instruction);
+void decode_simd_load_store_multiple(uint32_t instruction);
+void decode_simd_three_same(uint32_t instruction);
+void decode_simd_two_misc(uint32_t instruction);
+void decode_simd_across(uint32_t instruction);
+void decode_simd_copy(uint32_t instruction);
+void decode_simd_table(uint32_t instruction);
+void decode_fp_2source(uint32_t instruction);
+void decode_fp_1source(uint32_t instruction);
+void decode_fp_3source(uint32_t instruction);
+void decode_fp_compare(uint32_t instruction);
+void decode_fp_select(uint32_t instruction);
+void decode_fp_immediate(uint32_t instruction);
+void decode_fp_integer(uint32_t instruction);
+void decode_fp_system_register(uint32_t instruction);
+void decode_bl(uint32_t instruction);
+void decode_blr_ret(uint32_t instruction);
 
 
 
@@ -49,49 +102,148 @@ void process_instruction()
 }
 
 
-typedef struct instruction_information{
-    uint32_t opcode;
-    void* function;
-} inst_info; 
-
+/*
+ * Cada entrada reconoce las instrucciones con (instruccion & mask) == value
+ * y gana la primera que coincide. OPCODE(bits, n) arma mask y value para
+ * un opcode de n bits en la parte alta de la instruccion.
+ *
+ * Las primeras entradas son las formas de 64 bits mas comunes (sin flags
+ * extra, sin writeback), con handlers que solo extraen los campos que
+ * usan: son el camino rapido de la predecodificacion. Las formas generales
+ * (registros W, indices pre/post, pares, ...) van despues.
+ */
+#define OPCODE(bits, width) (uint32_t)(0xFFFFFFFFU << (32 - (width))), (uint32_t)(bits) << (32 - (width))
 
 inst_info INSTRUCTION_SET[] = {
-    {0b10101011000, &decode_adds_extended},
-    {0b10110001, &decode_adds_immediate},
-    {0b11101011000, &decode_subs_extended},
-    {0b11110001, &decode_subs_immediate},
-    {0b11010100010, &decode_halt},
-    {0b11110001 , &decode_cmp_immediate},
-    {0b11101011001, &decode_cmp_extended}, 
-    {0b11101010000, &decode_ands},
-    {0b11001010000, &decode_eor},
-    {0b10101010000, &decode_orr},
-    {0b01010100, &decode_b_cond},
-    {0b11010010100, &decode_movz},
-    {0b000101, &decode_b},
-    {0b11010110000, &decode_br},
-    {0b10010001, &decode_add_immediate},
-    {0b10001011000, &decode_add_extended_register}, //preguntar opcode porque enverdad termina en 1 por el simulador me lo tire con 0
-    {0b10110101, &decode_cbnz},
-    {0b10110100, &decode_cbz},
-    {0b10011011000, &decode_mul},
-    {0b11111000000, &decode_stur},
-    {0b00111000000, &decode_sturb},
-    {0b01111000000, &decode_sturh},
-    {0b11111000010, &decode_ldur},
-    {0b00111000010, &decode_ldurb},
-    {0b01111000010, &decode_ldurh},
-    {0b110100110, &decode_lsl_lsr_imm}
-
+    {OPCODE(0b10101011000, 11), &decode_adds_extended, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_SETS_FLAGS, "adds_extended"},
+    {OPCODE(0b10110001, 8), &decode_adds_immediate, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_SETS_FLAGS, "adds_immediate"},
+    {OPCODE(0b11101011000, 11), &decode_subs_extended, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_SETS_FLAGS, "subs_extended"},
+    {OPCODE(0b11110001, 8), &decode_subs_immediate, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_SETS_FLAGS, "subs_immediate"},
+    {OPCODE(0b11010100010, 11), &decode_halt, 0, "halt"},
+    {OPCODE(0b11010100000, 11), &decode_svc, 0, "svc"},
+    {OPCODE(0b11101010000, 11), &decode_ands, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_SETS_FLAGS, "ands"},
+    {OPCODE(0b11001010000, 11), &decode_eor, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM, "eor"},
+    {OPCODE(0b10101010000, 11), &decode_orr, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM, "orr"},
+    {0xFF000010, 0x54000000, &decode_b_cond, EFFECT_READS_FLAGS | EFFECT_BRANCH, "b_cond"},
+    {OPCODE(0b000101, 6), &decode_b, EFFECT_BRANCH, "b"},
+    {OPCODE(0b11010110000, 11), &decode_br, EFFECT_READS_RN | EFFECT_BRANCH, "br"},
+    {OPCODE(0b10010001, 8), &decode_add_immediate, EFFECT_WRITES_RD | EFFECT_READS_RN, "add_immediate"},
+    {OPCODE(0b10001011000, 11), &decode_add_extended_register, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM, "add_extended_register"}, //preguntar opcode porque enverdad termina en 1 por el simulador me lo tire con 0
+    {0x7F000000, 0x35000000, &decode_cbnz, EFFECT_READS_RD | EFFECT_BRANCH, "cbnz"},
+    {0x7F000000, 0x34000000, &decode_cbz, EFFECT_READS_RD | EFFECT_BRANCH, "cbz"},
+    {0xFFE0FC00, 0x9B007C00, &decode_mul, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_MULTIPLY, "mul"},
+    {0xFFE00C00, 0xF8000000, &decode_stur, EFFECT_READS_RD | EFFECT_READS_RN | EFFECT_STORE, "stur"},
+    {0xFFE00C00, 0x38000000, &decode_sturb, EFFECT_READS_RD | EFFECT_READS_RN | EFFECT_STORE, "sturb"},
+    {0xFFE00C00, 0x78000000, &decode_sturh, EFFECT_READS_RD | EFFECT_READS_RN | EFFECT_STORE, "sturh"},
+    {0xFFE00C00, 0xF8400000, &decode_ldur, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_LOAD, "ldur"},
+    {0xFFE00C00, 0x38400000, &decode_ldurb, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_LOAD, "ldurb"},
+    {0xFFE00C00, 0x78400000, &decode_ldurh, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_LOAD, "ldurh"},
+
+    /* formas generales */
+    {0x7F800000, 0x52800000, &decode_movz, EFFECT_WRITES_RD, "movz"},
+    {0x7F800000, 0x72800000, &decode_movk, EFFECT_WRITES_RD | EFFECT_READS_RD, "movk"},
+    {0x7F800000, 0x12800000, &decode_movn, EFFECT_WRITES_RD, "movn"},
+    {0x9F000000, 0x10000000, &decode_adr, EFFECT_WRITES_RD, "adr"},
+    {0x9F000000, 0x90000000, &decode_adr, EFFECT_WRITES_RD, "adrp"},
+    {0x3F800000, 0x11000000, &decode_add_sub_immediate, EFFECT_WRITES_RD | EFFECT_READS_RN, "add_sub_immediate"},
+    {0x3F800000, 0x31000000, &decode_add_sub_immediate, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_SETS_FLAGS, "adds_subs_immediate"},
+    {0x3F200000, 0x0B000000, &decode_add_sub_shifted, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM, "add_sub_shifted"},
+    {0x3F200000, 0x2B000000, &decode_add_sub_shifted, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_SETS_FLAGS, "adds_subs_shifted"},
+    {0x3FE00000, 0x0B200000, &decode_add_sub_extended, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM, "add_sub_extended"},
+    {0x3FE00000, 0x2B200000, &decode_add_sub_extended, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_SETS_FLAGS, "adds_subs_extended"},
+    {0x7F000000, 0x6A000000, &decode_logical_shifted, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_SETS_FLAGS, "ands_bics_shifted"},
+    {0x1F000000, 0x0A000000, &decode_logical_shifted, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM, "logical_shifted"},
+    {0x3FE00800, 0x1A800000, &decode_conditional_select, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_READS_FLAGS, "conditional_select"},
+    {0x7E000000, 0x36000000, &decode_tbz, EFFECT_READS_RD | EFFECT_BRANCH, "tbz_tbnz"},
+    {0xFC000000, 0x94000000, &decode_bl, EFFECT_BRANCH | EFFECT_WRITES_LINK, "bl"},
+    {0xFFFFFC1F, 0xD63F0000, &decode_blr_ret, EFFECT_READS_RN | EFFECT_BRANCH | EFFECT_WRITES_LINK, "blr"},
+    {0xFFFFFC1F, 0xD65F0000, &decode_blr_ret, EFFECT_READS_RN | EFFECT_BRANCH, "ret"},
+    {0x3EC00000, 0x28800000, &decode_load_store_pair, EFFECT_READS_RD | EFFECT_READS_RT2 | EFFECT_READS_RN | EFFECT_WRITEBACK | EFFECT_STORE, "store_pair_index"},
+    {0x3EC00000, 0x28C00000, &decode_load_store_pair, EFFECT_WRITES_RD | EFFECT_WRITES_RT2 | EFFECT_READS_RN | EFFECT_WRITEBACK | EFFECT_LOAD, "load_pair_index"},
+    {0x3E400000, 0x28000000, &decode_load_store_pair, EFFECT_READS_RD | EFFECT_READS_RT2 | EFFECT_READS_RN | EFFECT_STORE, "store_pair"},
+    {0x3E400000, 0x28400000, &decode_load_store_pair, EFFECT_WRITES_RD | EFFECT_WRITES_RT2 | EFFECT_READS_RN | EFFECT_LOAD, "load_pair"},
+    {0x3FC00000, 0x39000000, &decode_load_store_unsigned, EFFECT_READS_RD | EFFECT_READS_RN | EFFECT_STORE, "store_unsigned"},
+    {0x3F000000, 0x39000000, &decode_load_store_unsigned, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_LOAD, "load_unsigned"},
+    {0x3FE00400, 0x38000400, &decode_load_store_imm9, EFFECT_READS_RD | EFFECT_READS_RN | EFFECT_WRITEBACK | EFFECT_STORE, "store_imm9_index"},
+    {0x3F200400, 0x38000400, &decode_load_store_imm9, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_WRITEBACK | EFFECT_LOAD, "load_imm9_index"},
+    {0x3FE00000, 0x38000000, &decode_load_store_imm9, EFFECT_READS_RD | EFFECT_READS_RN | EFFECT_STORE, "store_imm9"},
+    {0x3F200000, 0x38000000, &decode_load_store_imm9, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_LOAD, "load_imm9"},
+    {0x3FE00C00, 0x38200800, &decode_load_store_register, EFFECT_READS_RD | EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_STORE, "store_register"},
+    {0x3F200C00, 0x38200800, &decode_load_store_register, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_LOAD, "load_register"},
+    {0x3F000000, 0x18000000, &decode_load_literal, EFFECT_WRITES_RD | EFFECT_LOAD, "load_literal"},
+    {0x7F800000, 0x72000000, &decode_logical_immediate, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_SETS_FLAGS, "ands_immediate"},
+    {0x1F800000, 0x12000000, &decode_logical_immediate, EFFECT_WRITES_RD | EFFECT_READS_RN, "logical_immediate"},
+    {0x7FE00000, 0x1B000000, &decode_madd, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_READS_RA | EFFECT_MULTIPLY, "madd_msub"},
+    {0xFF600000, 0x9B200000, &decode_multiply_long, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_READS_RA | EFFECT_MULTIPLY, "smaddl_umaddl"},
+    {0xFF60FC00, 0x9B407C00, &decode_multiply_high, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_MULTIPLY, "smulh_umulh"},
+    {0x7FE0F800, 0x1AC00800, &decode_divide, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_DIVIDE, "udiv_sdiv"},
+    {0x7FE0E000, 0x1AC04000, &decode_crc32, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM, "crc32"},
+    {0xFFFFEC00, 0x4E286800, &decode_aes, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_VECTOR_RD | EFFECT_VECTOR_RN, "aesmc_aesimc"},
+    {0xFFFFCC00, 0x4E284800, &decode_aes, EFFECT_WRITES_RD | EFFECT_READS_RD | EFFECT_READS_RN | EFFECT_VECTOR_RD | EFFECT_VECTOR_RN, "aes"},
+    {0xFFE08C00, 0x5E000000, &decode_sha_three, EFFECT_WRITES_RD | EFFECT_READS_RD | EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_VECTOR_RD | EFFECT_VECTOR_RN, "sha_three"},
+    {0xFFFFFC00, 0x5E280800, &decode_sha_two, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_VECTOR_RD | EFFECT_VECTOR_RN, "sha1h"},
+    {0xFFFFCC00, 0x5E280800, &decode_sha_two, EFFECT_WRITES_RD | EFFECT_READS_RD | EFFECT_READS_RN | EFFECT_VECTOR_RD | EFFECT_VECTOR_RN, "sha_two"},
+    {0x3F400000, 0x3D000000, &decode_load_store_vector, EFFECT_READS_RD | EFFECT_READS_RN | EFFECT_STORE | EFFECT_VECTOR_RD, "vector_store_unsigned"},
+    {0x3F400000, 0x3D400000, &decode_load_store_vector, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_LOAD | EFFECT_VECTOR_RD, "vector_load_unsigned"},
+    {0x3F600400, 0x3C000400, &decode_load_store_vector, EFFECT_READS_RD | EFFECT_READS_RN | EFFECT_WRITEBACK | EFFECT_STORE | EFFECT_VECTOR_RD, "vector_store_imm9_index"},
+    {0x3F600400, 0x3C400400, &decode_load_store_vector, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_WRITEBACK | EFFECT_LOAD | EFFECT_VECTOR_RD, "vector_load_imm9_index"},
+    {0x3F600000, 0x3C000000, &decode_load_store_vector, EFFECT_READS_RD | EFFECT_READS_RN | EFFECT_STORE | EFFECT_VECTOR_RD, "vector_store_imm9"},
+    {0x3F600000, 0x3C400000, &decode_load_store_vector, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_LOAD | EFFECT_VECTOR_RD, "vector_load_imm9"},
+    {0x3EC00000, 0x2C800000, &decode_load_store_vector_pair, EFFECT_READS_RD | EFFECT_READS_RT2 | EFFECT_READS_RN | EFFECT_WRITEBACK | EFFECT_STORE | EFFECT_VECTOR_RD, "vector_store_pair_index"},
+    {0x3EC00000, 0x2CC00000, &decode_load_store_vector_pair, EFFECT_WRITES_RD | EFFECT_WRITES_RT2 | EFFECT_READS_RN | EFFECT_WRITEBACK | EFFECT_LOAD | EFFECT_VECTOR_RD, "vector_load_pair_index"},
+    {0x3EC00000, 0x2C000000, &decode_load_store_vector_pair, EFFECT_READS_RD | EFFECT_READS_RT2 | EFFECT_READS_RN | EFFECT_STORE | EFFECT_VECTOR_RD, "vector_store_pair"},
+    {0x3EC00000, 0x2C400000, &decode_load_store_vector_pair, EFFECT_WRITES_RD | EFFECT_WRITES_RT2 | EFFECT_READS_RN | EFFECT_LOAD | EFFECT_VECTOR_RD, "vector_load_pair"},
+    {0xBFFF0000, 0x0C000000, &decode_simd_load_store_multiple, EFFECT_READS_RD | EFFECT_READS_RN | EFFECT_STORE | EFFECT_VECTOR_RD, "st1"},
+    {0xBFFF0000, 0x0C400000, &decode_simd_load_store_multiple, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_LOAD | EFFECT_VECTOR_RD, "ld1"},
+    {0xBFE00000, 0x0C800000, &decode_simd_load_store_multiple, EFFECT_READS_RD | EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_WRITEBACK | EFFECT_STORE | EFFECT_VECTOR_RD, "st1_post"},
+    {0xBFE00000, 0x0CC00000, &decode_simd_load_store_multiple, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_WRITEBACK | EFFECT_LOAD | EFFECT_VECTOR_RD, "ld1_post"},
+    {0xBFE0FC00, 0x2E601C00, &decode_simd_three_same, EFFECT_WRITES_RD | EFFECT_READS_RD | EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_VECTOR_RD | EFFECT_VECTOR_RN, "bsl"},
+    {0xBFA0FC00, 0x2EA01C00, &decode_simd_three_same, EFFECT_WRITES_RD | EFFECT_READS_RD | EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_VECTOR_RD | EFFECT_VECTOR_RN, "bit_bif"},
+    {0x9F200400, 0x0E200400, &decode_simd_three_same, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_VECTOR_RD | EFFECT_VECTOR_RN, "simd_three_same"},
+    {0x9F3E0C00, 0x0E200800, &decode_simd_two_misc, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_VECTOR_RD | EFFECT_VECTOR_RN, "simd_two_misc"},
+    {0x9F3E0C00, 0x0E300800, &decode_simd_across, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_VECTOR_RD | EFFECT_VECTOR_RN, "simd_across"},
+    {0xBFE08400, 0x2E000400, &decode_simd_copy, EFFECT_WRITES_RD | EFFECT_READS_RD | EFFECT_READS_RN | EFFECT_VECTOR_RD | EFFECT_VECTOR_RN, "ins_element"},
+    {0xBFE0FC00, 0x0E000400, &decode_simd_copy, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_VECTOR_RD | EFFECT_VECTOR_RN, "dup_element"},
+    {0xBFE0FC00, 0x0E000C00, &decode_simd_copy, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_VECTOR_RD, "dup_general"},
+    {0xBFE0FC00, 0x0E001C00, &decode_simd_copy, EFFECT_WRITES_RD | EFFECT_READS_RD | EFFECT_READS_RN | EFFECT_VECTOR_RD, "ins_general"},
+    {0xBFE0EC00, 0x0E002C00, &decode_simd_copy, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_VECTOR_RN, "smov_umov"},
+    {0x9FE08400, 0x0E000400, &decode_simd_copy, 0, "simd_copy"},
+    {0xBFE09C00, 0x0E001000, &decode_simd_table, EFFECT_WRITES_RD | EFFECT_READS_RD | EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_VECTOR_RD | EFFECT_VECTOR_RN, "tbx"},
+    {0xBFE08C00, 0x0E000000, &decode_simd_table, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_VECTOR_RD | EFFECT_VECTOR_RN, "tbl"},
+    {0x3F000000, 0x1C000000, &decode_load_literal, EFFECT_WRITES_RD | EFFECT_LOAD | EFFECT_VECTOR_RD, "vector_literal"},
+    {0x3F600C00, 0x3C200800, &decode_load_store_vector, EFFECT_READS_RD | EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_STORE | EFFECT_VECTOR_RD, "vector_store_register"},
+    {0x3F600C00, 0x3C600800, &decode_load_store_vector, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_LOAD | EFFECT_VECTOR_RD, "vector_load_register"},
+    {0xFF20FC00, 0x1E201800, &decode_fp_2source, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_VECTOR_RD | EFFECT_VECTOR_RN | EFFECT_FP | EFFECT_DIVIDE, "fdiv"},
+    {0xFF200C00, 0x1E200800, &decode_fp_2source, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_VECTOR_RD | EFFECT_VECTOR_RN | EFFECT_FP, "fp_2source"},
+    {0xFF3FFC00, 0x1E21C000, &decode_fp_1source, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_VECTOR_RD | EFFECT_VECTOR_RN | EFFECT_FP | EFFECT_DIVIDE, "fsqrt"},
+    {0xFF207C00, 0x1E204000, &decode_fp_1source, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_VECTOR_RD | EFFECT_VECTOR_RN | EFFECT_FP, "fp_1source"},
+    {0xFF000000, 0x1F000000, &decode_fp_3source, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_READS_RA | EFFECT_VECTOR_RD | EFFECT_VECTOR_RN | EFFECT_FP, "fp_3source"},
+    {0xFF20FC0F, 0x1E202008, &decode_fp_compare, EFFECT_READS_RN | EFFECT_SETS_FLAGS | EFFECT_VECTOR_RN | EFFECT_FP, "fp_compare_zero"},
+    {0xFF20FC07, 0x1E202000, &decode_fp_compare, EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_SETS_FLAGS | EFFECT_VECTOR_RN | EFFECT_FP, "fp_compare"},
+    {0xFF200C00, 0x1E200C00, &decode_fp_select, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM | EFFECT_READS_FLAGS | EFFECT_VECTOR_RD | EFFECT_VECTOR_RN, "fp_select"},
+    {0xFF201FE0, 0x1E201000, &decode_fp_immediate, EFFECT_WRITES_RD | EFFECT_VECTOR_RD, "fp_immediate"},
+    {0x7F3FFC00, 0x1E2F0000, &decode_fp_integer, EFFECT_WRITES_RD | EFFECT_READS_RD | EFFECT_READS_RN | EFFECT_VECTOR_RD, "fmov_to_upper"},
+    {0x7F27FC00, 0x1E270000, &decode_fp_integer, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_VECTOR_RD, "fmov_from_general"},
+    {0x7F26FC00, 0x1E220000, &decode_fp_integer, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_VECTOR_RD | EFFECT_FP, "scvtf_ucvtf"},
+    {0x7F20FC00, 0x1E200000, &decode_fp_integer, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_VECTOR_RN | EFFECT_FP, "fp_to_general"},
+    {0xFFFFFFC0, 0xD53B4400, &decode_fp_system_register, EFFECT_WRITES_RD, "mrs_fp"},
+    {0xFFFFFFC0, 0xD51B4400, &decode_fp_system_register, EFFECT_READS_RD, "msr_fp"},
+    {0x7F800000, 0x53000000, &decode_bitfield, EFFECT_WRITES_RD | EFFECT_READS_RN, "ubfm"},
+    {0x7F800000, 0x13000000, &decode_bitfield, EFFECT_WRITES_RD | EFFECT_READS_RN, "sbfm"},
+    {0x7F800000, 0x33000000, &decode_bitfield, EFFECT_WRITES_RD | EFFECT_READS_RD | EFFECT_READS_RN, "bfm"},
+    {0x7FA00000, 0x13800000, &decode_extr, EFFECT_WRITES_RD | EFFECT_READS_RN | EFFECT_READS_RM, "extr"},
+    {0x7FFFF800, 0x5AC01000, &decode_data_1source, EFFECT_WRITES_RD | EFFECT_READS_RN, "clz_cls"},
+    {0x7FFFF000, 0x5AC00000, &decode_data_1source, EFFECT_WRITES_RD | EFFECT_READS_RN, "rbit_rev"},
 };
 
-#define INSTRUCTION_SET_SIZE (sizeof(INSTRUCTION_SET) / sizeof(INSTRUCTION_SET[0]))
+const int INSTRUCTION_SET_SIZE = sizeof(INSTRUCTION_SET) / sizeof(INSTRUCTION_SET[0]);
 
 /** 
  * Actualiza los flags y opcionalmente almacena el resultado en un registro.  
  * 
  * - FLAG_N se establece según el bit más significativo del resultado.  
  * - FLAG_Z se establece en 1 si el resultado es 0, de lo contrario, 0.  
+ * - FLAG_C y FLAG_V quedan en 0 (flags de una operacion logica).  
  * - PC se incrementa en 4 para avanzar a la siguiente instrucción.  
  * - Si `rd == -1`, no almacena el resultado (uso en CMP).  
  *
@@ -105,6 +257,8 @@ void update_result_and_flags(uint64_t result, int32_t rd) {
     }
     NEXT_STATE.FLAG_N = (result >> 63) & 1;
     NEXT_STATE.FLAG_Z = (result == 0) ? 1 : 0;
+    NEXT_STATE.FLAG_C = 0;
+    NEXT_STATE.FLAG_V = 0;
     NEXT_STATE.PC = CURRENT_STATE.PC + 4;
 }
 
@@ -144,6 +298,193 @@ int32_t sign_extend(int32_t value, int bits) {
 }
 
 
+/*
+ * Operandos. El registro 31 es XZR salvo como base de un acceso a memoria
+ * y en ADD/SUB sin flags, donde es SP. Con sf = 0 (registros W) el
+ * resultado se trunca a 32 bits y se extiende con ceros.
+ */
+static uint64_t read_register_sp(uint32_t r) {
+    return r == 31 ? CURRENT_STATE.SP : (uint64_t)CURRENT_STATE.REGS[r];
+}
+
+static void write_register(uint32_t r, uint64_t value, int sf) {
+    if (r != 31)
+        NEXT_STATE.REGS[r] = sf ? value : (uint32_t)value;
+}
+
+static void write_register_sp(uint32_t r, uint64_t value, int sf) {
+    if (!sf)
+        value = (uint32_t)value;
+    if (r == 31)
+        NEXT_STATE.SP = value;
+    else
+        NEXT_STATE.REGS[r] = value;
+}
+
+/*
+ * Los registros V no se copian enteros de NEXT_STATE a CURRENT_STATE en
+ * cada instruccion: commit_state solo lleva los marcados aca.
+ */
+static void write_vector(uint32_t r, vreg_t v) {
+    NEXT_STATE.V[r] = v;
+    VECTORS_WRITTEN |= 1u << r;
+}
+
+static void set_nz(uint64_t result, int sf) {
+    NEXT_STATE.FLAG_N = sf ? (result >> 63) & 1 : (result >> 31) & 1;
+    NEXT_STATE.FLAG_Z = sf ? result == 0 : (uint32_t)result == 0;
+}
+
+
+/**
+ * Suma x + y + carry en 64 o 32 bits (AddWithCarry del manual de ARM).
+ * La resta x - y es add_with_carry(x, ~y, 1, ...).
+ *
+ * Params: set_flags (int): Si es TRUE actualiza N, Z, C y V.
+ *
+ * Returns: uint64_t: Resultado (truncado a 32 bits si sf = 0).
+ */
+static uint64_t add_with_carry(uint64_t x, uint64_t y, int carry, int sf, int set_flags) {
+    uint64_t result;
+
+    if (sf) {
+        result = x + y + carry;
+        if (set_flags) {
+            NEXT_STATE.FLAG_C = result < x || (carry && result == x);
+            NEXT_STATE.FLAG_V = (~(x ^ y) & (x ^ result)) >> 63;
+        }
+    } else {
+        uint32_t a = x, b = y;
+        uint64_t wide = (uint64_t)a + b + carry;
+        result = (uint32_t)wide;
+        if (set_flags) {
+            NEXT_STATE.FLAG_C = wide >> 32;
+            NEXT_STATE.FLAG_V = (~(a ^ b) & (a ^ (uint32_t)result)) >> 31;
+        }
+    }
+    if (set_flags)
+        set_nz(result, sf);
+    return result;
+}
+
+
+/* Desplazamiento de un registro: 0 LSL, 1 LSR, 2 ASR, 3 ROR. */
+static uint64_t shift_register(uint64_t value, uint32_t type, uint32_t amount, int sf) {
+    if (!sf) {
+        uint32_t v = value;
+        amount &= 31;
+        switch (type) {
+        case 0: return (uint32_t)(v << amount);
+        case 1: return v >> amount;
+        case 2: return (uint32_t)((int32_t)v >> amount);
+        default: return amount ? (uint32_t)((v >> amount) | (v << (32 - amount))) : v;
+        }
+    }
+    amount &= 63;
+    switch (type) {
+    case 0: return value << amount;
+    case 1: return value >> amount;
+    case 2: return (uint64_t)((int64_t)value >> amount);
+    default: return amount ? (value >> amount) | (value << (64 - amount)) : value;
+    }
+}
+
+
+/* Extension de un registro (UXTB..SXTX) seguida de LSL #shift. */
+static uint64_t extend_register(uint64_t value, uint32_t option, uint32_t shift) {
+    switch (option) {
+    case 0: value = (uint8_t)value; break;
+    case 1: value = (uint16_t)value; break;
+    case 2: value = (uint32_t)value; break;
+    case 4: value = (int64_t)(int8_t)value; break;
+    case 5: value = (int64_t)(int16_t)value; break;
+    case 6: value = (int64_t)(int32_t)value; break;
+    default: break;
+    }
+    return value << shift;
+}
+
+
+/* Evalua una condicion de 4 bits (EQ, NE, CS, ..., AL) sobre NZCV. */
+static int condition_holds(uint32_t cond) {
+    int n = CURRENT_STATE.FLAG_N, z = CURRENT_STATE.FLAG_Z;
+    int c = CURRENT_STATE.FLAG_C, v = CURRENT_STATE.FLAG_V;
+    int result;
+
+    switch (cond >> 1) {
+    case 0: result = z; break;                  /* EQ / NE */
+    case 1: result = c; break;                  /* CS / CC */
+    case 2: result = n; break;                  /* MI / PL */
+    case 3: result = v; break;                  /* VS / VC */
+    case 4: result = c && !z; break;            /* HI / LS */
+    case 5: result = n == v; break;             /* GE / LT */
+    case 6: result = !z && n == v; break;       /* GT / LE */
+    default: return TRUE;                       /* AL */
+    }
+    return (cond & 1) ? !result : result;
+}
+
+
+/*
+ * Memoria. Los accesos de 64 bits son dos de 32 y los de 8 y 16 bits
+ * leen la palabra y modifican solo sus bytes.
+ */
+static uint64_t load_memory(uint64_t address, int bytes) {
+    uint32_t low = mem_read_32(address);
+
+    if (bytes == 8)
+        return low | (uint64_t)mem_read_32(address + 4) << 32;
+    return bytes == 4 ? low : low & ((1U << (8 * bytes)) - 1);
+}
+
+static void store_memory(uint64_t address, uint64_t value, int bytes) {
+    if (bytes == 8) {
+        mem_write_32(address, value);
+        mem_write_32(address + 4, value >> 32);
+        return;
+    }
+    if (bytes < 4) {
+        uint32_t mask = (1U << (8 * bytes)) - 1;
+        value = (mem_peek_32(address) & ~mask) | (value & mask);
+    }
+    mem_write_32(address, value);
+}
+
+
+/*
+ * Calcula la direccion de un acceso con indice (bits 11-10 o 24-23 segun
+ * el formato): offset, post-indexado o pre-indexado. Con writeback la base
+ * se actualiza en NEXT_STATE.
+ */
+static uint64_t indexed_address(uint32_t rn, int64_t offset, int post, int writeback) {
+    uint64_t base = read_register_sp(rn);
+    uint64_t address = post ? base : base + offset;
+
+    if (writeback)
+        write_register_sp(rn, base + offset, TRUE);
+    return address;
+}
+
+
+/**
+ * Acceso de un LDR/STR entero segun los campos size (bits 31-30) y opc
+ * (bits 23-22): STR, LDR, LDRS de 64 bits y LDRS de 32 bits. PRFM no
+ * tiene efecto.
+ */
+static void load_store(uint32_t size, uint32_t opc, uint32_t rt, uint64_t address) {
+    int bytes = 1 << size, unused = 64 - 8 * bytes;
+
+    if (opc == 0) {
+        store_memory(address, CURRENT_STATE.REGS[rt], bytes);
+    } else if (opc == 1) {
+        write_register(rt, load_memory(address, bytes), TRUE);
+    } else if (size < 2 || (size == 2 && opc == 2)) {
+        int64_t value = (int64_t)(load_memory(address, bytes) << unused) >> unused;
+        write_register(rt, value, opc == 2);
+    }
+}
+
+
 /**
  * Decodifica, ejecuta y almacena el resultado de ADDS extendida.  
  * Suma los registros fuente, guarda el resultado y actualiza flags.  
@@ -154,11 +495,11 @@ void decode_adds_extended(uint32_t instruction) {
     uint32_t rd = (instruction >> 0) & 0b11111;
     uint32_t rn = (instruction >> 5) & 0b11111;
     uint32_t rm = (instruction >> 16) & 0b11111;
-    uint32_t imm3 = (instruction >> 10) & 0b111;
-    uint32_t option = (instruction >> 13) & 0b111;
+    uint32_t imm6 = (instruction >> 10) & 0b111111;
 
-    uint64_t result = CURRENT_STATE.REGS[rn] + CURRENT_STATE.REGS[rm];
-    update_result_and_flags(result, rd);
+    uint64_t result = add_with_carry(CURRENT_STATE.REGS[rn], CURRENT_STATE.REGS[rm] << imm6, 0, TRUE, TRUE);
+    write_register(rd, result, TRUE);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
 }
 
 
@@ -172,11 +513,11 @@ void decode_subs_extended(uint32_t instruction) {
     uint32_t rd = (instruction >> 0) & 0b11111;
     uint32_t rn = (instruction >> 5) & 0b11111;
     uint32_t rm = (instruction >> 16) & 0b11111;
-    uint32_t imm3 = (instruction >> 10) & 0b111;
-    uint32_t option = (instruction >> 13) & 0b111;
+    uint32_t imm6 = (instruction >> 10) & 0b111111;
 
-    uint64_t result = CURRENT_STATE.REGS[rn] - CURRENT_STATE.REGS[rm];
-    update_result_and_flags(result, rd);
+    uint64_t result = add_with_carry(CURRENT_STATE.REGS[rn], ~(CURRENT_STATE.REGS[rm] << imm6), 1, TRUE, TRUE);
+    write_register(rd, result, TRUE);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
 }
 
 
@@ -195,8 +536,9 @@ void decode_adds_immediate(uint32_t instruction){
     imm12 = apply_shift(imm12, shift);
     if (shift != 0x0 && shift != 0x1) return;
 
-    uint64_t result = CURRENT_STATE.REGS[rn] + imm12;
-    update_result_and_flags(result, rd);
+    uint64_t result = add_with_carry(read_register_sp(rn), imm12, 0, TRUE, TRUE);
+    write_register(rd, result, TRUE);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
 }
 
 
@@ -215,8 +557,9 @@ void decode_subs_immediate(uint32_t instruction){
     imm12 = apply_shift(imm12, shift);
     if (shift != 0x0 && shift != 0x1) return;
     
-    uint64_t result = CURRENT_STATE.REGS[rn] - imm12;
-    update_result_and_flags(result, rd);
+    uint64_t result = add_with_carry(read_register_sp(rn), ~(uint64_t)imm12, 1, TRUE, TRUE);
+    write_register(rd, result, TRUE);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
 }
 
 
@@ -231,39 +574,16 @@ void decode_halt(uint32_t instruction){
 }
 
 
-/** 
- * Decodifica, ejecuta y actualiza los flags de CMP inmediata.  
- * Compara un registro con un inmediato y actualiza los flags sin almacenar el resultado.  
- *
- * Params: instruction (uint32_t) - Instrucción codificada en 32 bits.
- */
-void decode_cmp_immediate(uint32_t instruction){
-    uint32_t rn = (instruction >> 5) & 0b11111;
-    uint32_t imm12 = (instruction >> 10) & 0b111111111111;
-
-    uint32_t shift = (instruction >> 22) & 0b11;
-    imm12 = apply_shift(imm12, shift);
-    if (shift != 0x0 && shift != 0x1) return;
-    
-    uint64_t result = CURRENT_STATE.REGS[rn] - imm12;
-    update_result_and_flags(result, -1);
-}
-
-
-/** 
- * Decodifica, ejecuta y actualiza los flags de CMP extendida.  
- * Compara dos registros y actualiza los flags sin almacenar el resultado.  
+/**
+ * SVC #0: llamada al sistema de Linux (ver syscalls.c). El resultado
+ * queda en X0. Otros inmediatos no hacen nada.
  *
  * Params: instruction (uint32_t) - Instrucción codificada en 32 bits.
  */
-void decode_cmp_extended(uint32_t instruction){
-    uint32_t rn = (instruction >> 5) & 0b11111;
-    uint32_t rm = (instruction >> 16) & 0b11111;
-    uint32_t imm3 = (instruction >> 10) & 0b111;
-    uint32_t option = (instruction >> 13) & 0b111;
-
-    uint64_t result = CURRENT_STATE.REGS[rn] - CURRENT_STATE.REGS[rm];
-    update_result_and_flags(result, -1);
+void decode_svc(uint32_t instruction){
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+    if ((instruction & 0x1FFFFF) == 0x000001)
+        syscall_handle();
 }
 
 
@@ -280,15 +600,15 @@ void decode_ands(uint32_t instruction){
     uint32_t rm = (instruction >> 16) & 0b11111;
     uint32_t imm6 = (instruction >> 10) & 0b111111;
 
-    uint64_t result = CURRENT_STATE.REGS[rn] & CURRENT_STATE.REGS[rm];
+    uint64_t result = CURRENT_STATE.REGS[rn] & (CURRENT_STATE.REGS[rm] << imm6);
     update_result_and_flags(result, rd);
 }
 
 
 /** 
  * Decodifica, ejecuta y almacena el resultado de EOR.  
- * Aplica una operación XOR bit a bit entre dos registros,  
- * guarda el resultado y actualiza los flags.  
+ * Aplica una operación XOR bit a bit entre dos registros  
+ * y guarda el resultado (EOR no modifica los flags).  
  *
  * Params: instruction (uint32_t) - Instrucción codificada en 32 bits.
  */
@@ -298,15 +618,16 @@ void decode_eor(uint32_t instruction){
     uint32_t rm = (instruction >> 16) & 0b11111;
     uint32_t imm6 = (instruction >> 10) & 0b111111;
 
-    uint64_t result = CURRENT_STATE.REGS[rn] ^ CURRENT_STATE.REGS[rm];
-    update_result_and_flags(result, rd);
+    uint64_t result = CURRENT_STATE.REGS[rn] ^ (CURRENT_STATE.REGS[rm] << imm6);
+    write_register(rd, result, TRUE);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
 }
 
 
 /** 
  * Decodifica, ejecuta y almacena el resultado de ORR.  
- * Aplica una operación OR bit a bit entre dos registros,  
- * guarda el resultado y actualiza los flags.  
+ * Aplica una operación OR bit a bit entre dos registros  
+ * y guarda el resultado (ORR no modifica los flags).  
  *
  * Params: instruction (uint32_t) - Instrucción codificada en 32 bits.
  */
@@ -316,8 +637,9 @@ void decode_orr(uint32_t instruction){
     uint32_t rm = (instruction >> 16) & 0b11111;
     uint32_t imm6 = (instruction >> 10) & 0b111111;
 
-    uint64_t result = CURRENT_STATE.REGS[rn] | CURRENT_STATE.REGS[rm];
-    update_result_and_flags(result, rd);
+    uint64_t result = CURRENT_STATE.REGS[rn] | (CURRENT_STATE.REGS[rm] << imm6);
+    write_register(rd, result, TRUE);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
 }
 
 
@@ -342,53 +664,52 @@ void decode_b(uint32_t instruction) {
  * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
  */
 void decode_br(uint32_t instruction) {
-    uint8_t Rn = (instruction >> 16) & 0x1F;
+    uint8_t Rn = (instruction >> 5) & 0x1F;
     NEXT_STATE.PC = CURRENT_STATE.REGS[Rn];
 }
 
 
 /**
- * Decodifica y ejecuta la instrucción B.cond en ARM.
- * Realiza un salto condicional basado en los flags del procesador.
+ * Decodifica y ejecuta BL: salta a PC + offset de 26 bits y deja la
+ * direccion de retorno en X30.
  *
  * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
  */
-void decode_b_cond(uint32_t instruction) {
-    uint8_t cond = instruction & 0xF;  
-    int32_t imm19 = (instruction >> 5) & 0x7FFFF;
-    int32_t offset = sign_extend(imm19 << 2, 21);
-
-    int should_branch = 0;
-
-    switch (cond) {
-        case 0x0: // BEQ (Branch if Equal)
-            should_branch = (CURRENT_STATE.FLAG_Z == 1);
-            break;
+void decode_bl(uint32_t instruction) {
+    int32_t offset = sign_extend((instruction & 0x03FFFFFF) << 2, 28);
+    NEXT_STATE.REGS[30] = CURRENT_STATE.PC + 4;
+    NEXT_STATE.PC = CURRENT_STATE.PC + offset;
+}
 
-        case 0x1: // BNE (Branch if Not Equal)
-            should_branch = (CURRENT_STATE.FLAG_Z == 0);
-            break;
 
-        case 0xA: // BGE (Branch if Greater Than or Equal)
-            should_branch = (CURRENT_STATE.FLAG_N == 0);
-            break;
+/**
+ * Decodifica y ejecuta BLR (salta a Xn y deja la direccion de retorno en
+ * X30) y RET (salta a Xn, por defecto X30).
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_blr_ret(uint32_t instruction) {
+    uint64_t target = CURRENT_STATE.REGS[(instruction >> 5) & 0x1F];
 
-        case 0xB: // BLT (Branch if Less Than)
-            should_branch = (CURRENT_STATE.FLAG_N == 1);
-            break;
+    if (((instruction >> 21) & 3) == 1)
+        NEXT_STATE.REGS[30] = CURRENT_STATE.PC + 4;
+    NEXT_STATE.PC = target;
+}
 
-        case 0xC: // BGT (Branch if Greater Than)
-            should_branch = (CURRENT_STATE.FLAG_Z == 0 && CURRENT_STATE.FLAG_N == 0);
-            break;
 
-        case 0xD: // BLE (Branch if Less Than or Equal)
-            should_branch = (CURRENT_STATE.FLAG_Z == 1 || CURRENT_STATE.FLAG_N == 1);
-            break;
+/**
+ * Decodifica y ejecuta la instrucción B.cond en ARM.
+ * Realiza un salto condicional basado en los flags del procesador
+ * (las 16 condiciones, sobre N, Z, C y V).
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_b_cond(uint32_t instruction) {
+    uint8_t cond = instruction & 0xF;  
+    int32_t imm19 = (instruction >> 5) & 0x7FFFF;
+    int32_t offset = sign_extend(imm19 << 2, 21);
 
-        default:
-            printf("Error: Condición no reconocida (cond = 0x%X)\n", cond);
-            return;
-    }
+    int should_branch = condition_holds(cond);
 
     if (should_branch) {
         NEXT_STATE.PC = CURRENT_STATE.PC + offset;
@@ -398,109 +719,96 @@ void decode_b_cond(uint32_t instruction) {
 }
 
 
-void decode_stur(uint32_t instruction) {
-    uint32_t rt = instruction & 0b11111;
-    uint32_t rn = (instruction >> 5) & 0b11111;
-    int32_t imm9 = (instruction >> 12) & 0b111111111;  // Extraer 9 bits
-    
-    // Extensión de signo para imm9 (de 9 a 32 bits)
-    imm9 = (imm9 & 0x100) ? (imm9 | ~0x1FF) : imm9;
-    
-    uint64_t address = CURRENT_STATE.REGS[rn] + (int64_t)imm9;
-
-    // Escribir los 32 bits menos significativos del registro
-    mem_write_32(address, (uint32_t)(CURRENT_STATE.REGS[rt] & 0xFFFFFFFF));
+/*
+ * STUR/LDUR de 64, 16 y 8 bits: offset de 9 bits con signo y sin escalar
+ * sobre Rn (o SP). Las demas formas de LDR/STR estan en
+ * decode_load_store_imm9 y siguientes.
+ */
+static uint64_t unscaled_address(uint32_t instruction) {
+    int32_t imm9 = sign_extend((instruction >> 12) & 0x1FF, 9);
+    return read_register_sp((instruction >> 5) & 0x1F) + (int64_t)imm9;
+}
 
+void decode_stur(uint32_t instruction) {
+    store_memory(unscaled_address(instruction), CURRENT_STATE.REGS[instruction & 0x1F], 8);
     NEXT_STATE.PC = CURRENT_STATE.PC + 4;
 }
 
 void decode_sturb(uint32_t instruction) {
-    int rt = instruction & 0b11111;
-    int rn = (instruction & (0b11111 << 5)) >> 5;
-    int imm9 = (instruction & (0b111111111 << 12)) >> 12;
-
-    uint64_t address = CURRENT_STATE.REGS[rn] + imm9;
-    uint8_t byte_value = (uint8_t)(CURRENT_STATE.REGS[rt] & 0xFF);
-    mem_write_32(address, byte_value);
-
+    store_memory(unscaled_address(instruction), CURRENT_STATE.REGS[instruction & 0x1F], 1);
     NEXT_STATE.PC = CURRENT_STATE.PC + 4;
 }
-void decode_sturh(uint32_t instruction) {
-    int val5 = 0b11111;
-    int val9 = 0b111111111;
-
-    int rt = instruction & val5;
-    int rn = (instruction & (val5 << 5)) >> 5;
-    int imm9 = (instruction & (val9 << 12)) >> 12;
-
-    uint64_t address = CURRENT_STATE.REGS[rn] + imm9;
-    uint16_t halfword_value = (uint16_t)(CURRENT_STATE.REGS[rt] & 0xFFFF);
-    mem_write_32(address, halfword_value);
 
+void decode_sturh(uint32_t instruction) {
+    store_memory(unscaled_address(instruction), CURRENT_STATE.REGS[instruction & 0x1F], 2);
     NEXT_STATE.PC = CURRENT_STATE.PC + 4;
 }
 
 void decode_ldur(uint32_t instruction) {
-    int val5 = 0b11111;
-    int val9 = 0b111111111;
-    int rt = instruction & val5;
-    int rn = (instruction & (val5 << 5)) >> 5;
-    int imm9 = (instruction & (val9 << 12)) >> 12;
-
-    uint64_t address = CURRENT_STATE.REGS[rn] + imm9;
-
-    uint32_t low = mem_read_32(address);
-    uint32_t high = mem_read_32(address + 4);
-        
-    NEXT_STATE.REGS[rt] = ((uint64_t) high << 32) | low;;
+    write_register(instruction & 0x1F, load_memory(unscaled_address(instruction), 8), TRUE);
     NEXT_STATE.PC = CURRENT_STATE.PC + 4;
 }
-void decode_ldurh(uint32_t instruction) {
-    int val5 = 0b11111;
-    int val9 = 0b111111111;
-    int rt = instruction & val5;
-    int rn = (instruction & (val5 << 5)) >> 5;
-    int imm9 = (instruction & (val9 << 12)) >> 12;
-
-    uint64_t address = CURRENT_STATE.REGS[rn] + imm9;
-    uint16_t halfword_value = mem_read_32(address) & 0xFFFF;
-    NEXT_STATE.REGS[rt] = (uint64_t)halfword_value;
 
+void decode_ldurh(uint32_t instruction) {
+    write_register(instruction & 0x1F, load_memory(unscaled_address(instruction), 2), TRUE);
     NEXT_STATE.PC = CURRENT_STATE.PC + 4;
 }
-void decode_ldurb(uint32_t instruction) {
-    int val5 = 0b11111;
-    int val9 = 0b111111111;
-    int rt = instruction & val5;
-    int rn = (instruction & (val5 << 5)) >> 5;
-    int imm9 = (instruction & (val9 << 12)) >> 12;
-
-    uint64_t address = CURRENT_STATE.REGS[rn] + imm9;
-    uint8_t byte_value = mem_read_32(address) & 0xFF;
-    NEXT_STATE.REGS[rt] = (uint64_t)byte_value;
 
+void decode_ldurb(uint32_t instruction) {
+    write_register(instruction & 0x1F, load_memory(unscaled_address(instruction), 1), TRUE);
     NEXT_STATE.PC = CURRENT_STATE.PC + 4;
 }
 
 
 /**
  * Decodifica y ejecuta la instrucción MOVZ en ARM.
- * Carga un valor inmediato de 16 bits en un registro sin desplazamiento.
+ * Carga un valor inmediato de 16 bits desplazado 16 * hw bits, con el
+ * resto del registro en cero.
  * 
  * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
  */
 void decode_movz(uint32_t instruction) {
-    uint16_t imm16 = (instruction >> 5) & 0xFFFF;
+    uint64_t imm16 = (instruction >> 5) & 0xFFFF;
+    uint32_t Rd = (instruction >> 0) & 0x1F;
+    uint32_t hw = (instruction >> 21) & 0x3;
+    int sf = instruction >> 31;
+
+    write_register(Rd, imm16 << (16 * hw), sf);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta MOVK: reemplaza 16 bits del registro (en la
+ * posicion 16 * hw) y conserva el resto.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_movk(uint32_t instruction) {
+    uint64_t imm16 = (instruction >> 5) & 0xFFFF;
     uint32_t Rd = (instruction >> 0) & 0x1F;
+    uint32_t shift = 16 * ((instruction >> 21) & 0x3);
+    int sf = instruction >> 31;
+
+    uint64_t value = (CURRENT_STATE.REGS[Rd] & ~(0xFFFFULL << shift)) | (imm16 << shift);
+    write_register(Rd, value, sf);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
 
+
+/**
+ * Decodifica y ejecuta MOVN: carga el complemento del inmediato
+ * desplazado 16 * hw bits.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_movn(uint32_t instruction) {
+    uint64_t imm16 = (instruction >> 5) & 0xFFFF;
+    uint32_t Rd = (instruction >> 0) & 0x1F;
     uint32_t hw = (instruction >> 21) & 0x3;
-    if (hw != 0) {
-        printf("Error: hw debe ser 0 para esta implementación de MOVZ.\n");
-        return;
-    }
+    int sf = instruction >> 31;
 
-    uint64_t value = imm16;
-    NEXT_STATE.REGS[Rd] = value;
+    write_register(Rd, ~(imm16 << (16 * hw)), sf);
     NEXT_STATE.PC = CURRENT_STATE.PC + 4;
 }
 
@@ -520,8 +828,8 @@ void decode_add_immediate(uint32_t instruction) {
     imm12 = apply_shift(imm12, shift);
     if (shift != 0x0 && shift != 0x1) return;
 
-    uint64_t result = CURRENT_STATE.REGS[rn] + imm12;
-    NEXT_STATE.REGS[rd] = result;
+    uint64_t result = read_register_sp(rn) + imm12;
+    write_register_sp(rd, result, TRUE);
     NEXT_STATE.PC = CURRENT_STATE.PC + 4;
 }
 
@@ -536,8 +844,9 @@ void decode_add_extended_register(uint32_t instruction) {
     uint32_t rd = (instruction >> 0) & 0b11111;
     uint32_t rn = (instruction >> 5) & 0b11111;
     uint32_t rm = (instruction >> 16) & 0b11111;
+    uint32_t imm6 = (instruction >> 10) & 0b111111;
 
-    uint64_t result = CURRENT_STATE.REGS[rn] + CURRENT_STATE.REGS[rm];
+    uint64_t result = CURRENT_STATE.REGS[rn] + (CURRENT_STATE.REGS[rm] << imm6);
     NEXT_STATE.REGS[rd] = result;
     NEXT_STATE.PC = CURRENT_STATE.PC + 4;
 }
@@ -556,7 +865,7 @@ void decode_mul(uint32_t instruction) {
 
 /** 
  * Decodifica y ejecuta una instrucción CBZ (Compare and Branch on Zero).  
- * Si el registro es cero, salta a la dirección calculada.  
+ * Si el registro (X o W) es cero, salta a la dirección calculada.  
  *
  * Params: instruction (uint32_t) - Instrucción codificada en 32 bits.
  */
@@ -565,7 +874,9 @@ void decode_cbz(uint32_t instruction) {
     int32_t imm19 = (instruction >> 5) & 0x7FFFF;
     int32_t offset = sign_extend(imm19 << 2, 21);
 
-    if (CURRENT_STATE.REGS[rt] == 0) {
+    uint64_t value = (instruction >> 31) ? CURRENT_STATE.REGS[rt] : (uint32_t)CURRENT_STATE.REGS[rt];
+
+    if (value == 0) {
         NEXT_STATE.PC = CURRENT_STATE.PC + offset;
     } else {
         NEXT_STATE.PC = CURRENT_STATE.PC + 4;
@@ -575,7 +886,7 @@ void decode_cbz(uint32_t instruction) {
 
 /** 
  * Decodifica y ejecuta una instrucción CBNZ (Compare and Branch on Non-Zero).  
- * Si el registro no es cero, salta a la dirección calculada.  
+ * Si el registro (X o W) no es cero, salta a la dirección calculada.  
  *
  * Params: instruction (uint32_t) - Instrucción codificada en 32 bits.
  */
@@ -584,64 +895,1810 @@ void decode_cbnz(uint32_t instruction) {
     int32_t imm19 = (instruction >> 5) & 0x7FFFF;
     int32_t offset = sign_extend(imm19 << 2, 21);
 
-    if (CURRENT_STATE.REGS[rt] != 0) {
+    uint64_t value = (instruction >> 31) ? CURRENT_STATE.REGS[rt] : (uint32_t)CURRENT_STATE.REGS[rt];
+
+    if (value != 0) {
         NEXT_STATE.PC = CURRENT_STATE.PC + offset;
     } else {
         NEXT_STATE.PC = CURRENT_STATE.PC + 4;
     }
 }
 
-void decode_lsl_lsr_imm(uint32_t instruction) {
-    // Extraer campos comunes
-    uint32_t Rd = instruction & 0x1F;
-    uint32_t Rn = (instruction >> 5) & 0x1F;
-    uint32_t immr = (instruction >> 16) & 0x3F;
-    uint32_t imms = (instruction >> 10) & 0x3F;
-    
-    uint64_t source = CURRENT_STATE.REGS[Rn];
-    uint64_t result;
-    
-    // Determinar si es LSL o LSR
-    if (imms != 63) {
-        // LSL: imms = 63 - shift
-        uint32_t shift = 63 - imms;
-        result = (shift >= 64) ? 0 : (source << shift);
+/**
+ * Decodifica y ejecuta AND, ORR, EOR y ANDS con inmediato de mascara de
+ * bits (y los alias TST y MOV). El inmediato sale de BITMASK_IMMEDIATES
+ * con los 13 bits N:immr:imms. Salvo ANDS, Rd puede ser SP.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_logical_immediate(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    uint32_t opc = (instruction >> 29) & 3;
+    int sf = instruction >> 31;
+    uint64_t imm = BITMASK_IMMEDIATES[(instruction >> 10) & 0x1FFF];
+    uint64_t a = CURRENT_STATE.REGS[rn], result;
+
+    if (imm == 0 || (!sf && ((instruction >> 22) & 1))) {
+        printf("Error: inmediato logico reservado 0x%08X\n", instruction);
+        NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+        return;
+    }
+    switch (opc) {
+    case 0: result = a & imm; break;
+    case 1: result = a | imm; break;
+    case 2: result = a ^ imm; break;
+    default: result = a & imm; break;
+    }
+    if (!sf)
+        result = (uint32_t)result;
+    if (opc == 3) {
+        set_nz(result, sf);
+        NEXT_STATE.FLAG_C = 0;
+        NEXT_STATE.FLAG_V = 0;
+        write_register(rd, result, sf);
     } else {
-        // LSR: imms siempre es 63
-        uint32_t shift = immr;
-        result = (shift >= 64) ? 0 : (source >> shift);
+        write_register_sp(rd, result, sf);
     }
-    
-    NEXT_STATE.REGS[Rd] = result;
     NEXT_STATE.PC = CURRENT_STATE.PC + 4;
 }
 
-void decode_instruction(){
 
-    printf("Decoding instruction\n");
-    uint32_t instruction = mem_read_32(CURRENT_STATE.PC);
-    printf("Instruction: 0x%X\n", instruction);
+/**
+ * Decodifica y ejecuta MADD y MSUB (MUL y MNEG son alias con Ra = XZR):
+ * Rd = Ra +/- Rn * Rm, en 64 o 32 bits.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_madd(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    uint32_t ra = (instruction >> 10) & 0x1F;
+    uint32_t rm = (instruction >> 16) & 0x1F;
+    uint64_t product = (uint64_t)CURRENT_STATE.REGS[rn] * (uint64_t)CURRENT_STATE.REGS[rm];
+
+    if ((instruction >> 15) & 1)
+        write_register(rd, CURRENT_STATE.REGS[ra] - product, instruction >> 31);
+    else
+        write_register(rd, CURRENT_STATE.REGS[ra] + product, instruction >> 31);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
 
-    // Posibles opcodes con diferentes tamaños según el formato de instrucción
-    uint32_t opcode_11 = (instruction >> 21) & 0x7FF;  // 11 bits (R, I, D, IW)
-    uint32_t opcode_8  = (instruction >> 24) & 0xFF;   // 8 bits (CB)
-    uint32_t opcode_6  = (instruction >> 26) & 0x3F;   // 6 bits (B)
-    uint32_t opcode_9 = (instruction >> 23) & 0x1FF;
 
-    printf("Opcodes: 11-bit: 0x%X, 8-bit: 0x%X, 6-bit: 0x%X\n", opcode_11, opcode_8, opcode_6);
+/**
+ * Decodifica y ejecuta SMADDL, SMSUBL, UMADDL y UMSUBL (y SMULL, UMULL,
+ * SMNEGL, UMNEGL): producto de 64 bits de dos registros W, con o sin
+ * signo, sumado o restado a Xa.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_multiply_long(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    uint32_t ra = (instruction >> 10) & 0x1F;
+    uint32_t rm = (instruction >> 16) & 0x1F;
+    uint64_t product;
+
+    if ((instruction >> 23) & 1)
+        product = (uint64_t)(uint32_t)CURRENT_STATE.REGS[rn] * (uint32_t)CURRENT_STATE.REGS[rm];
+    else
+        product = (uint64_t)((int64_t)(int32_t)CURRENT_STATE.REGS[rn] * (int32_t)CURRENT_STATE.REGS[rm]);
+
+    if ((instruction >> 15) & 1)
+        write_register(rd, CURRENT_STATE.REGS[ra] - product, TRUE);
+    else
+        write_register(rd, CURRENT_STATE.REGS[ra] + product, TRUE);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
 
-    // Buscar el opcode en el conjunto de instrucciones
-    for (int i = 0; i < INSTRUCTION_SET_SIZE; i++) {
-        if (INSTRUCTION_SET[i].opcode == opcode_11 || 
-            INSTRUCTION_SET[i].opcode == opcode_8  || 
-            INSTRUCTION_SET[i].opcode == opcode_6  ||
-            INSTRUCTION_SET[i].opcode == opcode_9){
-
-            printf("Match found\n");
-            void (*decode_function)(uint32_t) = INSTRUCTION_SET[i].function;
-            decode_function(instruction);
-            NEXT_STATE.REGS[31] = 0;
-            return;
-        }
+
+/**
+ * Decodifica y ejecuta SMULH y UMULH: los 64 bits altos del producto de
+ * 128 bits, calculado con __int128 del host.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_multiply_high(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    uint32_t rm = (instruction >> 16) & 0x1F;
+    uint64_t high;
+
+    if ((instruction >> 23) & 1)
+        high = ((unsigned __int128)(uint64_t)CURRENT_STATE.REGS[rn] * (uint64_t)CURRENT_STATE.REGS[rm]) >> 64;
+    else
+        high = (uint64_t)(((__int128)CURRENT_STATE.REGS[rn] * CURRENT_STATE.REGS[rm]) >> 64);
+    write_register(rd, high, TRUE);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta UDIV y SDIV, en 64 o 32 bits. Como en ARM, dividir
+ * por cero da 0 y el minimo negativo dividido -1 da el mismo minimo (en
+ * el host esos casos serian una excepcion, asi que se resuelven antes).
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_divide(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    uint32_t rm = (instruction >> 16) & 0x1F;
+    int sf = instruction >> 31, is_signed = (instruction >> 10) & 1;
+    uint64_t result;
+
+    if (sf) {
+        uint64_t n = CURRENT_STATE.REGS[rn], m = CURRENT_STATE.REGS[rm];
+        if (m == 0)
+            result = 0;
+        else if (!is_signed)
+            result = n / m;
+        else if ((int64_t)m == -1)
+            result = -n;
+        else
+            result = (uint64_t)((int64_t)n / (int64_t)m);
+    } else {
+        uint32_t n = CURRENT_STATE.REGS[rn], m = CURRENT_STATE.REGS[rm];
+        if (m == 0)
+            result = 0;
+        else if (!is_signed)
+            result = n / m;
+        else if ((int32_t)m == -1)
+            result = (uint32_t)-n;
+        else
+            result = (uint32_t)((int32_t)n / (int32_t)m);
     }
+    write_register(rd, result, sf);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta CRC32B/H/W/X y CRC32CB/H/W/X: Wd = CRC de los
+ * datos de Rm (1, 2, 4 u 8 bytes) sobre el acumulador Wn.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_crc32(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    uint32_t rm = (instruction >> 16) & 0x1F;
+    uint32_t size = (instruction >> 10) & 3;
+    uint32_t crc = CURRENT_STATE.REGS[rn];
+    uint64_t data = CURRENT_STATE.REGS[rm];
+
+    if ((size == 3) != (instruction >> 31)) {
+        printf("Error: CRC32 no soportado 0x%08X\n", instruction);
+        NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+        return;
     }
+    if ((instruction >> 12) & 1)
+        crc = CRYPTO.crc32c(crc, data, 1 << size);
+    else
+        crc = crypto_crc32(crc, data, 1 << size);
+    write_register(rd, crc, FALSE);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta AESE, AESD, AESMC y AESIMC sobre registros Q.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_aes(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    int op = (instruction >> 12) & 3;
+
+    write_vector(rd, CRYPTO.aes(op, CURRENT_STATE.V[rd], CURRENT_STATE.V[rn]));
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta las instrucciones SHA de tres registros: SHA1C,
+ * SHA1P, SHA1M, SHA1SU0, SHA256H, SHA256H2 y SHA256SU1.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_sha_three(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    uint32_t rm = (instruction >> 16) & 0x1F;
+    vreg_t d = CURRENT_STATE.V[rd], n = CURRENT_STATE.V[rn], m = CURRENT_STATE.V[rm];
+
+    switch ((instruction >> 12) & 7) {
+    case 0: write_vector(rd, CRYPTO.sha1_rounds(CRYPTO_SHA1C, d, n.s[0], m)); break;
+    case 1: write_vector(rd, CRYPTO.sha1_rounds(CRYPTO_SHA1P, d, n.s[0], m)); break;
+    case 2: write_vector(rd, CRYPTO.sha1_rounds(CRYPTO_SHA1M, d, n.s[0], m)); break;
+    case 3: write_vector(rd, crypto_sha1_schedule0(d, n, m)); break;
+    case 4: write_vector(rd, CRYPTO.sha256_rounds(d, n, m, TRUE)); break;
+    case 5: write_vector(rd, CRYPTO.sha256_rounds(n, d, m, FALSE)); break;
+    case 6: write_vector(rd, CRYPTO.sha256_schedule1(d, n, m)); break;
+    default: printf("Error: SHA no soportado 0x%08X\n", instruction); break;
+    }
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta las instrucciones SHA de dos registros: SHA1H,
+ * SHA1SU1 y SHA256SU0.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_sha_two(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    vreg_t d = CURRENT_STATE.V[rd], n = CURRENT_STATE.V[rn];
+
+    switch ((instruction >> 12) & 3) {
+    case 0:
+        memset(&d, 0, sizeof(d));
+        d.s[0] = (n.s[0] << 30) | (n.s[0] >> 2);
+        write_vector(rd, d);
+        break;
+    case 1: write_vector(rd, crypto_sha1_schedule1(d, n)); break;
+    case 2: write_vector(rd, CRYPTO.sha256_schedule0(d, n)); break;
+    default: printf("Error: SHA no soportado 0x%08X\n", instruction); break;
+    }
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/*
+ * Accesos a memoria de los registros SIMD/FP (B, H, S, D o Q). Una carga
+ * pone en cero el resto del registro.
+ */
+static void load_vector(uint32_t rt, uint64_t address, int bytes) {
+    vreg_t v;
+
+    memset(&v, 0, sizeof(v));
+    if (bytes == 16) {
+        v.d[0] = load_memory(address, 8);
+        v.d[1] = load_memory(address + 8, 8);
+    } else {
+        v.d[0] = load_memory(address, bytes);
+    }
+    write_vector(rt, v);
+}
+
+static void store_vector(uint32_t rt, uint64_t address, int bytes) {
+    if (bytes == 16) {
+        store_memory(address, CURRENT_STATE.V[rt].d[0], 8);
+        store_memory(address + 8, CURRENT_STATE.V[rt].d[1], 8);
+    } else {
+        store_memory(address, CURRENT_STATE.V[rt].d[0], bytes);
+    }
+}
+
+
+/**
+ * Decodifica y ejecuta LDR/STR de registros SIMD/FP con offset sin signo
+ * escalado, con offset de 9 bits sin escalar, post o pre-indexado, o con
+ * offset en un registro (extendido y opcionalmente escalado).
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_load_store_vector(uint32_t instruction) {
+    uint32_t rt = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    uint32_t size = instruction >> 30;
+    uint32_t opc = (instruction >> 22) & 3;
+    int bytes = (opc & 2) ? 16 : 1 << size;
+    uint64_t address;
+
+    if ((opc & 2) && size != 0) {
+        printf("Error: acceso SIMD no soportado 0x%08X\n", instruction);
+        NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+        return;
+    }
+    if ((instruction >> 24) & 1) {
+        address = read_register_sp(rn) + (uint64_t)((instruction >> 10) & 0xFFF) * bytes;
+    } else if ((instruction >> 21) & 1) {
+        uint32_t shift = ((instruction >> 12) & 1) ? __builtin_ctz(bytes) : 0;
+        address = read_register_sp(rn) + extend_register(CURRENT_STATE.REGS[(instruction >> 16) & 0x1F],
+                                                         (instruction >> 13) & 7, shift);
+    } else {
+        uint32_t index = (instruction >> 10) & 3;
+        if (index == 2) {
+            printf("Error: acceso SIMD no soportado 0x%08X\n", instruction);
+            NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+            return;
+        }
+        address = indexed_address(rn, sign_extend((instruction >> 12) & 0x1FF, 9), index == 1, index != 0);
+    }
+
+    if (opc & 1)
+        load_vector(rt, address, bytes);
+    else
+        store_vector(rt, address, bytes);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta LDP/STP de registros S, D o Q (offset con signo,
+ * post o pre-indexado).
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_load_store_vector_pair(uint32_t instruction) {
+    uint32_t rt = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    uint32_t rt2 = (instruction >> 10) & 0x1F;
+    uint32_t opc = instruction >> 30;
+    uint32_t index = (instruction >> 23) & 3;
+    int bytes = 4 << opc;
+    int64_t offset = (int64_t)sign_extend((instruction >> 15) & 0x7F, 7) * bytes;
+
+    if (opc == 3) {
+        printf("Error: par SIMD no soportado 0x%08X\n", instruction);
+        NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+        return;
+    }
+    uint64_t address = indexed_address(rn, offset, index == 1, index & 1);
+    if ((instruction >> 22) & 1) {
+        load_vector(rt, address, bytes);
+        load_vector(rt2, address + bytes, bytes);
+    } else {
+        store_vector(rt, address, bytes);
+        store_vector(rt2, address + bytes, bytes);
+    }
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/*
+ * Advanced SIMD. Q (bit 30) elige 64 o 128 bits; con 64 la mitad alta del
+ * registro destino queda en cero. Las operaciones por elemento estan en
+ * neon.c.
+ */
+static vreg_t vector_result(vreg_t v, int q) {
+    if (!q)
+        v.d[1] = 0;
+    return v;
+}
+
+static void simd_unsupported(uint32_t instruction) {
+    printf("Error: instruccion SIMD no soportada 0x%08X\n", instruction);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta LD1 y ST1 (varias estructuras) de 1 a 4 registros
+ * consecutivos, sin offset o post-indexado por inmediato o por Xm.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_simd_load_store_multiple(uint32_t instruction) {
+    uint32_t rt = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    uint32_t rm = (instruction >> 16) & 0x1F;
+    int bytes = ((instruction >> 30) & 1) ? 16 : 8;
+    int registers;
+    uint64_t address = read_register_sp(rn);
+
+    switch ((instruction >> 12) & 0xF) {
+    case 0x7: registers = 1; break;
+    case 0xA: registers = 2; break;
+    case 0x6: registers = 3; break;
+    case 0x2: registers = 4; break;
+    default: simd_unsupported(instruction); return;
+    }
+    for (int r = 0; r < registers; r++) {
+        if ((instruction >> 22) & 1)
+            load_vector((rt + r) & 0x1F, address + r * bytes, bytes);
+        else
+            store_vector((rt + r) & 0x1F, address + r * bytes, bytes);
+    }
+    if ((instruction >> 23) & 1)
+        write_register_sp(rn, address + (rm == 31 ? (uint64_t)registers * bytes : (uint64_t)CURRENT_STATE.REGS[rm]), TRUE);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta las operaciones de tres registros del mismo
+ * tamano: ADD, SUB, MUL, SMAX/UMAX, SMIN/UMIN, CMEQ, CMTST, CMGT, CMGE,
+ * CMHI, CMHS y las logicas (AND, BIC, ORR/MOV, ORN, EOR, BSL, BIT, BIF).
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_simd_three_same(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    uint32_t rm = (instruction >> 16) & 0x1F;
+    int size = (instruction >> 22) & 3, q = (instruction >> 30) & 1, u = (instruction >> 29) & 1;
+    vreg_t d = CURRENT_STATE.V[rd], n = CURRENT_STATE.V[rn], m = CURRENT_STATE.V[rm], r;
+    uint32_t opcode = (instruction >> 11) & 0x1F;
+
+    if (opcode == 0x03) {
+        /* logicas: size elige la operacion */
+        for (int i = 0; i < 2; i++) {
+            switch (u << 2 | size) {
+            case 0: r.d[i] = n.d[i] & m.d[i]; break;
+            case 1: r.d[i] = n.d[i] & ~m.d[i]; break;
+            case 2: r.d[i] = n.d[i] | m.d[i]; break;
+            case 3: r.d[i] = n.d[i] | ~m.d[i]; break;
+            case 4: r.d[i] = n.d[i] ^ m.d[i]; break;
+            case 5: r.d[i] = (d.d[i] & n.d[i]) | (~d.d[i] & m.d[i]); break;
+            case 6: r.d[i] = (n.d[i] & m.d[i]) | (d.d[i] & ~m.d[i]); break;
+            default: r.d[i] = (d.d[i] & m.d[i]) | (n.d[i] & ~m.d[i]); break;
+            }
+        }
+        write_vector(rd, vector_result(r, q));
+        NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+        return;
+    }
+    if (size == 3 && !q) {
+        simd_unsupported(instruction);
+        return;
+    }
+
+    switch (opcode) {
+    case 0x10: r = NEON.arith(u ? NEON_SUB : NEON_ADD, n, m, size); break;
+    case 0x13:
+        if (u || size == 3) {
+            simd_unsupported(instruction);
+            return;
+        }
+        r = NEON.arith(NEON_MUL, n, m, size);
+        break;
+    case 0x0C:
+    case 0x0D:
+        if (size == 3) {
+            simd_unsupported(instruction);
+            return;
+        }
+        r = NEON.arith(opcode == 0x0C ? (u ? NEON_UMAX : NEON_SMAX) : (u ? NEON_UMIN : NEON_SMIN), n, m, size);
+        break;
+    case 0x11: r = NEON.compare(u ? NEON_EQ : NEON_TST, n, m, size); break;
+    case 0x06: r = NEON.compare(u ? NEON_HI : NEON_GT, n, m, size); break;
+    case 0x07: r = NEON.compare(u ? NEON_HS : NEON_GE, n, m, size); break;
+    default: simd_unsupported(instruction); return;
+    }
+    write_vector(rd, vector_result(r, q));
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta las operaciones de dos registros: comparaciones
+ * con cero (CMGT, CMGE, CMEQ, CMLE, CMLT #0), NOT/MVN y CNT.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_simd_two_misc(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    int size = (instruction >> 22) & 3, q = (instruction >> 30) & 1, u = (instruction >> 29) & 1;
+    vreg_t n = CURRENT_STATE.V[rn], zero, r;
+
+    memset(&zero, 0, sizeof(zero));
+    if (size == 3 && !q) {
+        simd_unsupported(instruction);
+        return;
+    }
+    switch ((instruction >> 12) & 0x1F) {
+    case 0x08: r = NEON.compare(u ? NEON_GE : NEON_GT, n, zero, size); break;
+    case 0x09: r = u ? NEON.compare(NEON_GE, zero, n, size) : NEON.compare(NEON_EQ, n, zero, size); break;
+    case 0x0A:
+        if (u) {
+            simd_unsupported(instruction);
+            return;
+        }
+        r = NEON.compare(NEON_GT, zero, n, size);
+        break;
+    case 0x05:
+        if (size != 0) {
+            simd_unsupported(instruction);
+            return;
+        }
+        for (int i = 0; i < 16; i++)
+            r.b[i] = u ? ~n.b[i] : __builtin_popcount(n.b[i]);
+        break;
+    default: simd_unsupported(instruction); return;
+    }
+    write_vector(rd, vector_result(r, q));
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta las reducciones ADDV, SMAXV, UMAXV, SMINV y UMINV:
+ * el resultado (un elemento) queda en el elemento 0 de Vd.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_simd_across(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    int size = (instruction >> 22) & 3, q = (instruction >> 30) & 1, u = (instruction >> 29) & 1;
+    int op;
+    vreg_t r;
+
+    switch ((instruction >> 12) & 0x1F) {
+    case 0x1B: op = u ? -1 : NEON_ADD; break;
+    case 0x0A: op = u ? NEON_UMAX : NEON_SMAX; break;
+    case 0x1A: op = u ? NEON_UMIN : NEON_SMIN; break;
+    default: op = -1; break;
+    }
+    if (op < 0 || size == 3 || (size == 2 && !q)) {
+        simd_unsupported(instruction);
+        return;
+    }
+    memset(&r, 0, sizeof(r));
+    r.d[0] = NEON.reduce(op, CURRENT_STATE.V[rn], size, q);
+    write_vector(rd, r);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta DUP (elemento y registro general), INS (elemento
+ * y registro general, alias MOV) y UMOV/SMOV (alias MOV a Wd/Xd).
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_simd_copy(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    uint32_t imm5 = (instruction >> 16) & 0x1F;
+    uint32_t imm4 = (instruction >> 11) & 0xF;
+    int q = (instruction >> 30) & 1;
+    int size = imm5 ? __builtin_ctz(imm5) : 4;
+    int index = imm5 >> (size + 1);
+    vreg_t n = CURRENT_STATE.V[rn], d = CURRENT_STATE.V[rd];
+
+    if (size > 3 || (size == 3 && !q && imm4 <= 1)) {
+        simd_unsupported(instruction);
+        return;
+    }
+    if ((instruction >> 29) & 1) {                          /* INS (elemento) */
+        neon_set_lane(&d, size, index, neon_lane(n, size, imm4 >> size));
+        write_vector(rd, d);
+    } else if (imm4 == 0x0) {                               /* DUP (elemento) */
+        write_vector(rd, vector_result(neon_dup(neon_lane(n, size, index), size), q));
+    } else if (imm4 == 0x1) {                               /* DUP (general) */
+        write_vector(rd, vector_result(neon_dup(CURRENT_STATE.REGS[rn], size), q));
+    } else if (imm4 == 0x3 && q) {                          /* INS (general) */
+        neon_set_lane(&d, size, index, CURRENT_STATE.REGS[rn]);
+        write_vector(rd, d);
+    } else if (imm4 == 0x7 && q == (size == 3)) {           /* UMOV */
+        write_register(rd, neon_lane(n, size, index), TRUE);
+    } else if (imm4 == 0x5 && size < 2 + q) {               /* SMOV */
+        int unused = 64 - (8 << size);
+        write_register(rd, (int64_t)(neon_lane(n, size, index) << unused) >> unused, q);
+    } else {
+        simd_unsupported(instruction);
+        return;
+    }
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta TBL y TBX: cada byte de Vm elige un byte de la
+ * tabla de 1 a 4 registros desde Vn. Fuera de la tabla TBL da 0 y TBX
+ * conserva el byte de Vd.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_simd_table(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    uint32_t rm = (instruction >> 16) & 0x1F;
+    int registers = ((instruction >> 13) & 3) + 1, q = (instruction >> 30) & 1;
+    vreg_t table[4], fallback;
+
+    for (int i = 0; i < registers; i++)
+        table[i] = CURRENT_STATE.V[(rn + i) & 0x1F];
+    if ((instruction >> 12) & 1)
+        fallback = CURRENT_STATE.V[rd];
+    else
+        memset(&fallback, 0, sizeof(fallback));
+    write_vector(rd, vector_result(NEON.table(table, registers, CURRENT_STATE.V[rm], fallback), q));
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/*
+ * Punto flotante escalar. type (bits 23-22) elige S (00) o D (01); el
+ * valor vive en los bits bajos del registro V y escribirlo pone en cero
+ * el resto. Las operaciones estan en fpu.c.
+ */
+static uint64_t read_fp(uint32_t r, int dbl) {
+    return dbl ? CURRENT_STATE.V[r].d[0] : CURRENT_STATE.V[r].s[0];
+}
+
+static void write_fp(uint32_t r, uint64_t value, int dbl) {
+    vreg_t v;
+
+    memset(&v, 0, sizeof(v));
+    v.d[0] = dbl ? value : (uint32_t)value;
+    write_vector(r, v);
+}
+
+static void fp_unsupported(uint32_t instruction) {
+    printf("Error: instruccion de punto flotante no soportada 0x%08X\n", instruction);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta FMUL, FDIV, FADD, FSUB, FMAX, FMIN, FMAXNM, FMINNM
+ * y FNMUL escalares.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_fp_2source(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    uint32_t rm = (instruction >> 16) & 0x1F;
+    uint32_t opcode = (instruction >> 12) & 0xF;
+    int dbl = (instruction >> 22) & 3;
+
+    if (dbl > 1 || opcode > FPU_NMUL) {
+        fp_unsupported(instruction);
+        return;
+    }
+    write_fp(rd, fpu_arith(opcode, read_fp(rn, dbl), read_fp(rm, dbl), dbl), dbl);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta FMOV (registro), FABS, FNEG, FSQRT y FCVT entre
+ * S y D.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_fp_1source(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    uint32_t opcode = (instruction >> 15) & 0x3F;
+    int dbl = (instruction >> 22) & 3;
+
+    if (dbl > 1) {
+        fp_unsupported(instruction);
+        return;
+    }
+    if (opcode <= FPU_SQRT) {
+        write_fp(rd, fpu_unary(opcode, read_fp(rn, dbl), dbl), dbl);
+    } else if ((opcode == 4 || opcode == 5) && (int)opcode - 4 != dbl) {
+        write_fp(rd, fpu_convert(read_fp(rn, dbl), !dbl), !dbl);
+    } else {
+        fp_unsupported(instruction);
+        return;
+    }
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta FMADD, FMSUB, FNMADD y FNMSUB (Ra + Rn * Rm con
+ * un solo redondeo; o1 niega el sumando y o1 != o0 el producto).
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_fp_3source(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    uint32_t ra = (instruction >> 10) & 0x1F;
+    uint32_t rm = (instruction >> 16) & 0x1F;
+    int o1 = (instruction >> 21) & 1, o0 = (instruction >> 15) & 1;
+    int dbl = (instruction >> 22) & 3;
+
+    if (dbl > 1) {
+        fp_unsupported(instruction);
+        return;
+    }
+    write_fp(rd, fpu_fused(read_fp(rn, dbl), read_fp(rm, dbl), read_fp(ra, dbl), o1 != o0, o1, dbl), dbl);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta FCMP y FCMPE, contra Rm o contra #0.0: deja el
+ * resultado en NZCV (igual 0110, menor 1000, mayor 0010, sin orden 0011).
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_fp_compare(uint32_t instruction) {
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    uint32_t rm = (instruction >> 16) & 0x1F;
+    int dbl = (instruction >> 22) & 3;
+    int nzcv;
+
+    if (dbl > 1) {
+        fp_unsupported(instruction);
+        return;
+    }
+    nzcv = fpu_compare(read_fp(rn, dbl), ((instruction >> 3) & 1) ? 0 : read_fp(rm, dbl), dbl,
+                       (instruction >> 4) & 1);
+    NEXT_STATE.FLAG_N = (nzcv >> 3) & 1;
+    NEXT_STATE.FLAG_Z = (nzcv >> 2) & 1;
+    NEXT_STATE.FLAG_C = (nzcv >> 1) & 1;
+    NEXT_STATE.FLAG_V = nzcv & 1;
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta FCSEL: Rd = cond ? Rn : Rm.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_fp_select(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    uint32_t rm = (instruction >> 16) & 0x1F;
+    int dbl = (instruction >> 22) & 3;
+
+    if (dbl > 1) {
+        fp_unsupported(instruction);
+        return;
+    }
+    write_fp(rd, read_fp(condition_holds((instruction >> 12) & 0xF) ? rn : rm, dbl), dbl);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta FMOV (inmediato) escalar.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_fp_immediate(uint32_t instruction) {
+    int dbl = (instruction >> 22) & 3;
+
+    if (dbl > 1) {
+        fp_unsupported(instruction);
+        return;
+    }
+    write_fp(instruction & 0x1F, fpu_expand_imm((instruction >> 13) & 0xFF, dbl), dbl);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta las conversiones entre registros generales y de
+ * punto flotante: SCVTF/UCVTF, FCVT[NPMZA]S/U y FMOV (Wn <-> Sn,
+ * Xn <-> Dn y Xn <-> Vn.D[1]).
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_fp_integer(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    uint32_t opcode = (instruction >> 16) & 7;
+    uint32_t rmode = (instruction >> 19) & 3;
+    uint32_t type = (instruction >> 22) & 3;
+    int sf = instruction >> 31;
+
+    if (opcode >= 6) {                                      /* FMOV */
+        if (rmode == 0 && type == (uint32_t)sf) {
+            if (opcode == 6)
+                write_register(rd, read_fp(rn, sf), sf);
+            else
+                write_fp(rd, CURRENT_STATE.REGS[rn], sf);
+        } else if (rmode == 1 && type == 2 && sf) {
+            if (opcode == 6)
+                write_register(rd, CURRENT_STATE.V[rn].d[1], TRUE);
+            else {
+                vreg_t v = CURRENT_STATE.V[rd];
+                v.d[1] = CURRENT_STATE.REGS[rn];
+                write_vector(rd, v);
+            }
+        } else {
+            fp_unsupported(instruction);
+            return;
+        }
+    } else if (type > 1) {
+        fp_unsupported(instruction);
+        return;
+    } else if (opcode == 2 || opcode == 3) {                /* SCVTF, UCVTF */
+        if (rmode != 0) {
+            fp_unsupported(instruction);
+            return;
+        }
+        write_fp(rd, fpu_from_int(CURRENT_STATE.REGS[rn], type, opcode == 3, sf), type);
+    } else {                                                /* FCVT*S, FCVT*U */
+        if (opcode >= 4 && rmode != 0) {
+            fp_unsupported(instruction);
+            return;
+        }
+        write_register(rd, fpu_to_int(read_fp(rn, type), type, opcode >= 4 ? FPU_ROUND_A : rmode,
+                                      opcode & 1, sf), sf);
+    }
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta MRS y MSR de FPCR y FPSR. FPSR se arma al leerlo
+ * (ver fpu.c).
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_fp_system_register(uint32_t instruction) {
+    uint32_t rt = instruction & 0x1F;
+    int fpsr = (instruction >> 5) & 1;
+
+    if ((instruction >> 21) & 1)
+        write_register(rt, fpsr ? fpu_read_fpsr() : CURRENT_STATE.FPCR, TRUE);
+    else if (fpsr)
+        fpu_write_fpsr(CURRENT_STATE.REGS[rt] & 0xF800009F);
+    else
+        fpu_write_fpcr(CURRENT_STATE.REGS[rt] & 0x07C00000);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/* Mascara con los bits [lsb, lsb + width) en 1. */
+static uint64_t field_mask(uint32_t lsb, uint32_t width) {
+    return (width >= 64 ? ~0ULL : (1ULL << width) - 1) << lsb;
+}
+
+
+/**
+ * Decodifica y ejecuta UBFM, SBFM y BFM, y con ellas sus alias: LSL, LSR
+ * y ASR inmediatos, UBFX/SBFX, UBFIZ/SBFIZ, BFI/BFXIL, UXTB/UXTH y
+ * SXTB/SXTH/SXTW. Si imms >= immr se extrae el campo [immr, imms] a los
+ * bits bajos; si no, los imms + 1 bits bajos se insertan en la posicion
+ * regsize - immr. El campo se mueve con BITOPS.extract / BITOPS.deposit.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_bitfield(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    uint32_t imms = (instruction >> 10) & 0x3F;
+    uint32_t immr = (instruction >> 16) & 0x3F;
+    uint32_t opc = (instruction >> 29) & 3;
+    int sf = instruction >> 31;
+    uint32_t size = sf ? 64 : 32;
+    uint64_t source = sf ? (uint64_t)CURRENT_STATE.REGS[rn] : (uint32_t)CURRENT_STATE.REGS[rn];
+    uint64_t result, mask;
+    uint32_t top;                       /* bit mas alto del campo en el resultado */
+
+    if (((instruction >> 22) & 1) != (uint32_t)sf || immr >= size || imms >= size) {
+        printf("Error: bitfield no soportado 0x%08X\n", instruction);
+        NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+        return;
+    }
+    if (imms >= immr) {
+        result = BITOPS.extract(source, field_mask(immr, imms - immr + 1));
+        mask = field_mask(0, imms - immr + 1);
+        top = imms - immr;
+    } else {
+        mask = field_mask(size - immr, imms + 1);
+        result = BITOPS.deposit(source, mask);
+        top = size - immr + imms;
+    }
+
+    if (opc == 0 && top < 63 && ((result >> top) & 1))
+        result |= ~0ULL << (top + 1);
+    else if (opc == 1)
+        result |= CURRENT_STATE.REGS[rd] & ~mask;
+    write_register(rd, result, sf);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta EXTR (y ROR inmediato, que es EXTR con Rn = Rm):
+ * los bits [lsb, lsb + regsize) de Rn:Rm.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_extr(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    uint32_t lsb = (instruction >> 10) & 0x3F;
+    uint32_t rm = (instruction >> 16) & 0x1F;
+    int sf = instruction >> 31;
+    uint64_t result;
+
+    if (((instruction >> 22) & 1) != (uint32_t)sf || (!sf && lsb >= 32)) {
+        printf("Error: EXTR no soportado 0x%08X\n", instruction);
+        NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+        return;
+    }
+    if (sf)
+        result = BITOPS.funnel(CURRENT_STATE.REGS[rn], CURRENT_STATE.REGS[rm], lsb);
+    else
+        result = ((uint64_t)(uint32_t)CURRENT_STATE.REGS[rn] << 32 | (uint32_t)CURRENT_STATE.REGS[rm]) >> lsb;
+    write_register(rd, result, sf);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta las operaciones de un registro: RBIT, REV16, REV32,
+ * REV, CLZ y CLS, en 64 o 32 bits.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_data_1source(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    uint32_t opcode = (instruction >> 10) & 0x3F;
+    int sf = instruction >> 31;
+    uint64_t x = sf ? (uint64_t)CURRENT_STATE.REGS[rn] : (uint32_t)CURRENT_STATE.REGS[rn];
+    uint64_t result;
+
+    switch (opcode) {
+    case 0:                                         /* RBIT */
+        result = bitops_reverse(x) >> (sf ? 0 : 32);
+        break;
+    case 1:                                         /* REV16 */
+        result = bitops_swap_halfwords(x);
+        break;
+    case 2:                                         /* REV32 / REV (W) */
+        result = __builtin_bswap64(x);
+        result = sf ? (result >> 32 | result << 32) : result >> 32;
+        break;
+    case 3:                                         /* REV (X) */
+        if (!sf)
+            goto unsupported;
+        result = __builtin_bswap64(x);
+        break;
+    case 4:                                         /* CLZ */
+        result = BITOPS.clz(x) - (sf ? 0 : 32);
+        break;
+    case 5:                                         /* CLS */
+        if (sf)
+            result = BITOPS.clz(x ^ (uint64_t)((int64_t)x >> 1)) - 1;
+        else
+            result = BITOPS.clz((uint32_t)(x ^ (uint64_t)((int32_t)x >> 1))) - 33;
+        break;
+    default:
+        goto unsupported;
+    }
+    write_register(rd, result, sf);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+    return;
+
+unsupported:
+    printf("Error: instruccion no soportada 0x%08X\n", instruction);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta ADR y ADRP. ADR suma al PC un offset de 21 bits;
+ * ADRP suma el offset en paginas de 4KB a la pagina del PC.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_adr(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+    int64_t imm = sign_extend(((instruction >> 5) & 0x7FFFF) << 2 | ((instruction >> 29) & 0x3), 21);
+
+    if (instruction >> 31)
+        write_register(rd, (CURRENT_STATE.PC & ~0xFFFULL) + (imm << 12), TRUE);
+    else
+        write_register(rd, CURRENT_STATE.PC + imm, TRUE);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta ADD, ADDS, SUB y SUBS con inmediato de 12 bits
+ * (opcionalmente desplazado 12 bits), en 64 o 32 bits. Rn puede ser SP, y
+ * tambien Rd si no se actualizan los flags.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_add_sub_immediate(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    uint64_t imm = (uint64_t)((instruction >> 10) & 0xFFF) << (((instruction >> 22) & 1) * 12);
+    int sf = instruction >> 31, sub = (instruction >> 30) & 1, set_flags = (instruction >> 29) & 1;
+
+    uint64_t result = add_with_carry(read_register_sp(rn), sub ? ~imm : imm, sub, sf, set_flags);
+    if (set_flags)
+        write_register(rd, result, sf);
+    else
+        write_register_sp(rd, result, sf);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta ADD, ADDS, SUB y SUBS (registro desplazado), en 64
+ * o 32 bits. CMP, CMN y NEG son alias de estas formas.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_add_sub_shifted(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    uint32_t rm = (instruction >> 16) & 0x1F;
+    int sf = instruction >> 31, sub = (instruction >> 30) & 1, set_flags = (instruction >> 29) & 1;
+
+    uint64_t operand = shift_register(CURRENT_STATE.REGS[rm], (instruction >> 22) & 3,
+                                      (instruction >> 10) & 0x3F, sf);
+    uint64_t result = add_with_carry(CURRENT_STATE.REGS[rn], sub ? ~operand : operand, sub, sf, set_flags);
+    write_register(rd, result, sf);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta ADD, ADDS, SUB y SUBS (registro extendido): Rm se
+ * extiende (UXTB..SXTX) y se desplaza hasta 4 bits. Rn puede ser SP.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_add_sub_extended(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    uint32_t rm = (instruction >> 16) & 0x1F;
+    int sf = instruction >> 31, sub = (instruction >> 30) & 1, set_flags = (instruction >> 29) & 1;
+
+    uint64_t operand = extend_register(CURRENT_STATE.REGS[rm], (instruction >> 13) & 7,
+                                       (instruction >> 10) & 7);
+    uint64_t result = add_with_carry(read_register_sp(rn), sub ? ~operand : operand, sub, sf, set_flags);
+    if (set_flags)
+        write_register(rd, result, sf);
+    else
+        write_register_sp(rd, result, sf);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta las operaciones logicas entre registros (AND, BIC,
+ * ORR, ORN, EOR, EON, ANDS, BICS) con Rm desplazado. MOV (registro), MVN
+ * y TST son alias. Solo ANDS y BICS actualizan los flags (C = V = 0).
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_logical_shifted(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    uint32_t rm = (instruction >> 16) & 0x1F;
+    uint32_t opc = (instruction >> 29) & 3;
+    int sf = instruction >> 31;
+    uint64_t a = CURRENT_STATE.REGS[rn], result;
+
+    uint64_t operand = shift_register(CURRENT_STATE.REGS[rm], (instruction >> 22) & 3,
+                                      (instruction >> 10) & 0x3F, sf);
+    if ((instruction >> 21) & 1)
+        operand = ~operand;
+    switch (opc) {
+    case 0: result = a & operand; break;
+    case 1: result = a | operand; break;
+    case 2: result = a ^ operand; break;
+    default: result = a & operand; break;
+    }
+    if (!sf)
+        result = (uint32_t)result;
+    if (opc == 3) {
+        set_nz(result, sf);
+        NEXT_STATE.FLAG_C = 0;
+        NEXT_STATE.FLAG_V = 0;
+    }
+    write_register(rd, result, sf);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta CSEL, CSINC, CSINV y CSNEG (y sus alias CSET,
+ * CSETM, CINC, CINV, CNEG): Rd = cond ? Rn : f(Rm).
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_conditional_select(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    uint32_t rm = (instruction >> 16) & 0x1F;
+    uint32_t cond = (instruction >> 12) & 0xF;
+    int sf = instruction >> 31;
+    uint64_t result;
+
+    if (condition_holds(cond)) {
+        result = CURRENT_STATE.REGS[rn];
+    } else {
+        result = CURRENT_STATE.REGS[rm];
+        if ((instruction >> 30) & 1)
+            result = ~result;
+        if ((instruction >> 10) & 1)
+            result++;
+    }
+    write_register(rd, result, sf);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta TBZ y TBNZ: salta si el bit b5:b40 de Rt es cero
+ * (o distinto de cero). Offset de 14 bits.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_tbz(uint32_t instruction) {
+    uint32_t rt = instruction & 0x1F;
+    uint32_t bit = ((instruction >> 31) << 5) | ((instruction >> 19) & 0x1F);
+    int32_t offset = sign_extend(((instruction >> 5) & 0x3FFF) << 2, 16);
+    int set = (CURRENT_STATE.REGS[rt] >> bit) & 1;
+
+    if (set == (int)((instruction >> 24) & 1))
+        NEXT_STATE.PC = CURRENT_STATE.PC + offset;
+    else
+        NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta LDP, STP y LDPSW (enteros) en sus tres formas:
+ * offset con signo, post-indexado y pre-indexado, y LDNP/STNP (sin
+ * asignacion en cache, que aca es lo mismo que el offset con signo). El
+ * offset de 7 bits se escala por el tamano del registro.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_load_store_pair(uint32_t instruction) {
+    uint32_t rt = instruction & 0x1F;
+    uint32_t rn = (instruction >> 5) & 0x1F;
+    uint32_t rt2 = (instruction >> 10) & 0x1F;
+    uint32_t opc = instruction >> 30;
+    uint32_t index = (instruction >> 23) & 3;
+    int load = (instruction >> 22) & 1;
+    int bytes = (opc == 2) ? 8 : 4;
+    int64_t offset = (int64_t)sign_extend((instruction >> 15) & 0x7F, 7) * bytes;
+
+    if (opc == 3 || (index == 0 && opc == 1)) {
+        printf("Error: par de registros no soportado 0x%08X\n", instruction);
+        NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+        return;
+    }
+    uint64_t address = indexed_address(rn, offset, index == 1, index & 1);
+    if (load) {
+        uint64_t first = load_memory(address, bytes), second = load_memory(address + bytes, bytes);
+        if (opc == 1) {
+            first = (int64_t)(int32_t)first;
+            second = (int64_t)(int32_t)second;
+        }
+        write_register(rt, first, TRUE);
+        write_register(rt2, second, TRUE);
+    } else {
+        store_memory(address, CURRENT_STATE.REGS[rt], bytes);
+        store_memory(address + bytes, CURRENT_STATE.REGS[rt2], bytes);
+    }
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta LDR/STR (y LDRB, LDRSH, ...) con offset sin signo
+ * de 12 bits escalado por el tamano del acceso.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_load_store_unsigned(uint32_t instruction) {
+    uint32_t size = instruction >> 30;
+    uint64_t offset = (uint64_t)((instruction >> 10) & 0xFFF) << size;
+
+    load_store(size, (instruction >> 22) & 3, instruction & 0x1F,
+               read_register_sp((instruction >> 5) & 0x1F) + offset);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta LDR/STR con offset de 9 bits con signo: sin
+ * escalar (LDUR/STUR), post-indexado, pre-indexado o sin privilegios
+ * (LDTR/STTR, que sin niveles de excepcion se comportan como LDUR/STUR).
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_load_store_imm9(uint32_t instruction) {
+    uint32_t index = (instruction >> 10) & 3;
+    int64_t offset = sign_extend((instruction >> 12) & 0x1FF, 9);
+
+    uint64_t address = indexed_address((instruction >> 5) & 0x1F, offset, index == 1, index & 1);
+    load_store(instruction >> 30, (instruction >> 22) & 3, instruction & 0x1F, address);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta LDR/STR con offset en registro: Rm extendido
+ * (UXTW, LSL, SXTW, SXTX) y opcionalmente escalado por el tamano.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_load_store_register(uint32_t instruction) {
+    uint32_t size = instruction >> 30;
+    uint32_t rm = (instruction >> 16) & 0x1F;
+    uint32_t shift = ((instruction >> 12) & 1) ? size : 0;
+    uint64_t offset = extend_register(CURRENT_STATE.REGS[rm], (instruction >> 13) & 7, shift);
+
+    load_store(size, (instruction >> 22) & 3, instruction & 0x1F,
+               read_register_sp((instruction >> 5) & 0x1F) + offset);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+
+/**
+ * Decodifica y ejecuta LDR (literal) de registros generales y S, D o Q,
+ * y LDRSW (literal): carga desde PC + offset de 19 bits. PRFM (literal)
+ * no tiene efecto.
+ *
+ * Params: instruction (uint32_t): Instrucción codificada en 32 bits.
+ */
+void decode_load_literal(uint32_t instruction) {
+    uint32_t opc = instruction >> 30;
+    uint64_t address = CURRENT_STATE.PC + sign_extend(((instruction >> 5) & 0x7FFFF) << 2, 21);
+
+    if ((instruction >> 26) & 1) {
+        if (opc == 3)
+            printf("Error: LDR (literal) SIMD no soportado 0x%08X\n", instruction);
+        else
+            load_vector(instruction & 0x1F, address, 4 << opc);
+    } else if (opc == 0)
+        load_store(2, 1, instruction & 0x1F, address);
+    else if (opc == 1)
+        load_store(3, 1, instruction & 0x1F, address);
+    else if (opc == 2)
+        load_store(2, 2, instruction & 0x1F, address);
+    NEXT_STATE.PC = CURRENT_STATE.PC + 4;
+}
+
+/*
+ * Indice de busqueda: para cada valor de los 11 bits altos, las entradas
+ * de INSTRUCTION_SET que pueden coincidir, en el orden de la tabla.
+ */
+static uint16_t BUCKET_START[2048 + 1];
+static uint16_t *BUCKET_ENTRIES;
+
+static int entry_may_match(int i, uint32_t top) {
+    uint32_t high_mask = INSTRUCTION_SET[i].mask & 0xFFE00000;
+    return ((top << 21) & high_mask) == (INSTRUCTION_SET[i].value & high_mask);
+}
+
+static void build_buckets() {
+    uint32_t n = 0;
+
+    for (uint32_t top = 0; top < 2048; top++)
+        for (int i = 0; i < INSTRUCTION_SET_SIZE; i++)
+            n += entry_may_match(i, top);
+    BUCKET_ENTRIES = malloc(n * sizeof(uint16_t));
+    n = 0;
+    for (uint32_t top = 0; top < 2048; top++) {
+        BUCKET_START[top] = n;
+        for (int i = 0; i < INSTRUCTION_SET_SIZE; i++)
+            if (entry_may_match(i, top))
+                BUCKET_ENTRIES[n++] = i;
+    }
+    BUCKET_START[2048] = n;
+}
+
+
+static int add_effect_register(int *regs, int n, uint32_t reg, int vector) {
+    if (vector)
+        regs[n++] = EFFECT_VECTOR_BASE + reg;
+    else if (reg != 31)
+        regs[n++] = reg;
+    return n;
+}
+
+
+/**
+ * Registros que lee una instruccion segun sus efectos: Rd/Rt, Rt2, Rn, Rm
+ * y Ra. El registro 31 de los enteros (XZR o SP) no se cuenta.
+ *
+ * Params: instruction (uint32_t): Instruccion codificada en 32 bits.
+ *         effects (uint32_t): Efectos EFFECT_* de la instruccion.
+ *         regs (int *): Salida, al menos EFFECT_MAX_REGISTERS elementos.
+ *
+ * Returns: int: Cantidad de registros escritos en regs.
+ */
+int effect_sources(uint32_t instruction, uint32_t effects, int *regs) {
+    int n = 0;
+
+    int vd = (effects & EFFECT_VECTOR_RD) != 0, vn = (effects & EFFECT_VECTOR_RN) != 0;
+
+    if (effects & EFFECT_READS_RD)
+        n = add_effect_register(regs, n, instruction & 0x1F, vd);
+    if (effects & EFFECT_READS_RN)
+        n = add_effect_register(regs, n, (instruction >> 5) & 0x1F, vn);
+    if (effects & EFFECT_READS_RM)
+        n = add_effect_register(regs, n, (instruction >> 16) & 0x1F, vn);
+    if (effects & EFFECT_READS_RA)
+        n = add_effect_register(regs, n, (instruction >> 10) & 0x1F, vn);
+    if (effects & EFFECT_READS_RT2)
+        n = add_effect_register(regs, n, (instruction >> 10) & 0x1F, vd);
+    return n;
+}
+
+
+/**
+ * Registros de resultado de una instruccion segun sus efectos: Rd/Rt, Rt2
+ * y X30 en BL/BLR. La base actualizada por EFFECT_WRITEBACK no se incluye: esta lista
+ * antes que el resultado de un load y cada modelo la trata aparte.
+ *
+ * Params: instruction (uint32_t): Instruccion codificada en 32 bits.
+ *         effects (uint32_t): Efectos EFFECT_* de la instruccion.
+ *         regs (int *): Salida, al menos EFFECT_MAX_REGISTERS elementos.
+ *
+ * Returns: int: Cantidad de registros escritos en regs.
+ */
+int effect_destinations(uint32_t instruction, uint32_t effects, int *regs) {
+    int n = 0;
+
+    int vd = (effects & EFFECT_VECTOR_RD) != 0;
+
+    if (effects & EFFECT_WRITES_RD)
+        n = add_effect_register(regs, n, instruction & 0x1F, vd);
+    if (effects & EFFECT_WRITES_RT2)
+        n = add_effect_register(regs, n, (instruction >> 10) & 0x1F, vd);
+    if (effects & EFFECT_WRITES_LINK)
+        n = add_effect_register(regs, n, 30, FALSE);
+    return n;
+}
+
+
+/**
+ * Busca una instruccion en INSTRUCTION_SET: la primera entrada con
+ * (instruction & mask) == value, entre las candidatas para sus 11 bits
+ * altos.
+ *
+ * Params: instruction (uint32_t): Instruccion codificada en 32 bits.
+ *
+ * Returns: int: Indice en INSTRUCTION_SET, o -1 si no se reconoce.
+ */
+int lookup_instruction(uint32_t instruction) {
+    uint32_t top = instruction >> 21;
+
+    if (BUCKET_ENTRIES == NULL)
+        build_buckets();
+    for (uint32_t k = BUCKET_START[top]; k < BUCKET_START[top + 1]; k++) {
+        int i = BUCKET_ENTRIES[k];
+        if ((instruction & INSTRUCTION_SET[i].mask) == INSTRUCTION_SET[i].value)
+            return i;
+    }
+    return -1;
+}
+
+void decode_instruction(){
+
+    printf("Decoding instruction\n");
+    uint32_t instruction = mem_peek_32(CURRENT_STATE.PC);
+    if (HPROF_ACTIVE)
+        hprof_mark(HPROF_FETCH);
+    printf("Instruction: 0x%X\n", instruction);
+
+    // Posibles opcodes con diferentes tamaños según el formato de instrucción
+    uint32_t opcode_11 = (instruction >> 21) & 0x7FF;  // 11 bits (R, I, D, IW)
+    uint32_t opcode_8  = (instruction >> 24) & 0xFF;   // 8 bits (CB)
+    uint32_t opcode_6  = (instruction >> 26) & 0x3F;   // 6 bits (B)
+
+    printf("Opcodes: 11-bit: 0x%X, 8-bit: 0x%X, 6-bit: 0x%X\n", opcode_11, opcode_8, opcode_6);
+
+    // Buscar el opcode en el conjunto de instrucciones
+    int i = lookup_instruction(instruction);
+    if (LIVE_ENABLED)
+        live_count(i);
+    if (i < 0) {
+        if (HPROF_ACTIVE) {
+            hprof_mark(HPROF_DECODE);
+            hprof_execute(-1);
+        }
+        return;
+    }
+
+    printf("Match found\n");
+    if (HPROF_ACTIVE)
+        hprof_mark(HPROF_DECODE);
+    void (*decode_function)(uint32_t) = INSTRUCTION_SET[i].function;
+    if (ILP_ENABLED)
+        ilp_begin(instruction, INSTRUCTION_SET[i].effects);
+    decode_function(instruction);
+    NEXT_STATE.REGS[31] = 0;
+    if (ILP_ENABLED)
+        ilp_end();
+    if (BBV_ENABLED)
+        bbv_instruction(CURRENT_STATE.PC, INSTRUCTION_SET[i].effects);
+    if (HPROF_ACTIVE)
+        hprof_execute(i);
+}
+
+
+/*
+ * Camino rapido: cada palabra del segmento de texto se decodifica una sola
+ * vez. PREDECODED guarda el indice en INSTRUCTION_SET + 1 (0 = todavia sin
+ * decodificar, PREDECODE_UNKNOWN = instruccion no reconocida). Las
+ * escrituras al segmento de texto invalidan la entrada y agregan a LEADERS
+ * los bloques que abra la palabra nueva (predecode_invalidate).
+ *
+ * predecode_program decodifica de una vez el programa cargado y marca los
+ * comienzos de bloque basico en LEADERS (destinos de saltos directos e
+ * instrucciones que siguen a un salto o HLT). Las tres tablas pueden venir
+ * de un archivo mapeado (predecode_attach, ver pdcache.c); predecode_reset
+ * vuelve siempre a las tablas propias.
+ *
+ * FUSED marca las palabras donde empieza una superinstruccion (indice en
+ * FUSIONS + 1): una secuencia frecuente que process_fused ejecuta entera
+ * en un solo paso. No es parte del cache; se recalcula al predecodificar.
+ * Despues de un predecode_reset (checkpoint, time travel) process_fused
+ * vuelve a llamar a predecode_program con el ultimo programa antes de
+ * usarla. Solo la aprovecha el camino rapido de sample sin hooks
+ * activos: go y run muestran cada instruccion y pasan los analizadores,
+ * asi que ejecutan de a una.
+ */
+static uint16_t PREDECODED_STORAGE[PREDECODE_WORDS];
+static uint32_t PREDECODED_WORDS_STORAGE[PREDECODE_WORDS];
+static uint64_t LEADERS_STORAGE[PREDECODE_WORDS / 64];
+static uint8_t FUSED[PREDECODE_WORDS];
+
+static uint16_t *PREDECODED = PREDECODED_STORAGE;
+static uint32_t *PREDECODED_WORDS = PREDECODED_WORDS_STORAGE;
+static uint64_t *LEADERS = LEADERS_STORAGE;
+
+/* ultimo programa predecodificado, para reconstruir FUSED */
+static uint64_t PROGRAM_WORDS, PROGRAM_ENTRY = MEM_TEXT_START;
+static int FUSED_STALE;
+
+
+/*
+ * Superinstrucciones. Cada componente se ejecuta con su propio handler, y
+ * entre uno y otro fused_commit lleva a CURRENT_STATE lo que el anterior
+ * dejo en NEXT_STATE (Rd, SP, flags y PC: todo lo que escriben los
+ * componentes admitidos), asi que el estado en cada frontera es el mismo
+ * que instruccion por instruccion. Lo que se ahorra es el despacho: la
+ * busqueda en la tabla, los hooks del ciclo y la copia del estado entero.
+ */
+static void fused_commit(uint32_t instruction) {
+    uint32_t rd = instruction & 0x1F;
+
+    NEXT_STATE.REGS[31] = 0;
+    CURRENT_STATE.REGS[rd] = NEXT_STATE.REGS[rd];
+    CURRENT_STATE.SP = NEXT_STATE.SP;
+    CURRENT_STATE.FLAG_N = NEXT_STATE.FLAG_N;
+    CURRENT_STATE.FLAG_Z = NEXT_STATE.FLAG_Z;
+    CURRENT_STATE.FLAG_C = NEXT_STATE.FLAG_C;
+    CURRENT_STATE.FLAG_V = NEXT_STATE.FLAG_V;
+    CURRENT_STATE.PC = NEXT_STATE.PC;
+}
+
+#define FUSED_PAIR(name, first, second) \
+    static void name(const uint32_t *words) { \
+        first(words[0]); fused_commit(words[0]); second(words[1]); \
+    }
+#define FUSED_TRIPLE(name, first, second, third) \
+    static void name(const uint32_t *words) { \
+        first(words[0]); fused_commit(words[0]); \
+        second(words[1]); fused_commit(words[1]); third(words[2]); \
+    }
+
+/* comparacion + B.cond */
+FUSED_PAIR(fused_subs_immediate_b_cond, decode_subs_immediate, decode_b_cond)
+FUSED_PAIR(fused_subs_extended_b_cond, decode_subs_extended, decode_b_cond)
+FUSED_PAIR(fused_adds_immediate_b_cond, decode_adds_immediate, decode_b_cond)
+FUSED_PAIR(fused_adds_extended_b_cond, decode_adds_extended, decode_b_cond)
+FUSED_PAIR(fused_ands_b_cond, decode_ands, decode_b_cond)
+FUSED_PAIR(fused_add_sub_immediate_b_cond, decode_add_sub_immediate, decode_b_cond)
+FUSED_PAIR(fused_add_sub_shifted_b_cond, decode_add_sub_shifted, decode_b_cond)
+FUSED_PAIR(fused_logical_shifted_b_cond, decode_logical_shifted, decode_b_cond)
+/* contador de un lazo + CBZ/CBNZ */
+FUSED_PAIR(fused_add_immediate_cbnz, decode_add_immediate, decode_cbnz)
+FUSED_PAIR(fused_add_immediate_cbz, decode_add_immediate, decode_cbz)
+FUSED_PAIR(fused_add_sub_immediate_cbnz, decode_add_sub_immediate, decode_cbnz)
+FUSED_PAIR(fused_add_sub_immediate_cbz, decode_add_sub_immediate, decode_cbz)
+/* constantes de 32 y 48/64 bits */
+FUSED_TRIPLE(fused_movz_movk_movk, decode_movz, decode_movk, decode_movk)
+FUSED_PAIR(fused_movz_movk, decode_movz, decode_movk)
+/* lectura-modificacion-escritura de una variable en memoria */
+FUSED_TRIPLE(fused_ldur_add_immediate_stur, decode_ldur, decode_add_immediate, decode_stur)
+FUSED_TRIPLE(fused_ldur_add_register_stur, decode_ldur, decode_add_extended_register, decode_stur)
+FUSED_TRIPLE(fused_ldur_add_sub_immediate_stur, decode_ldur, decode_add_sub_immediate, decode_stur)
+FUSED_TRIPLE(fused_ldur_add_sub_shifted_stur, decode_ldur, decode_add_sub_shifted, decode_stur)
+
+/* ADDS/SUBS inmediata del camino rapido: con shift 2 o 3 no avanzan el PC. */
+static int immediate_shift_valid(const uint32_t *words) {
+    return ((words[0] >> 23) & 1) == 0;
+}
+
+typedef struct {
+    int length;
+    void *components[3];      /* handler de INSTRUCTION_SET de cada instruccion */
+    int (*applies)(const uint32_t *words);      /* condicion extra, o NULL */
+    void (*function)(const uint32_t *words);
+    const char *name;
+} fusion_t;
+
+/* Gana la primera que coincide: las triples van antes que sus prefijos. */
+static const fusion_t FUSIONS[] = {
+    {2, {&decode_subs_immediate, &decode_b_cond}, &immediate_shift_valid, &fused_subs_immediate_b_cond, "subs_immediate+b_cond"},
+    {2, {&decode_subs_extended, &decode_b_cond}, NULL, &fused_subs_extended_b_cond, "subs_extended+b_cond"},
+    {2, {&decode_adds_immediate, &decode_b_cond}, &immediate_shift_valid, &fused_adds_immediate_b_cond, "adds_immediate+b_cond"},
+    {2, {&decode_adds_extended, &decode_b_cond}, NULL, &fused_adds_extended_b_cond, "adds_extended+b_cond"},
+    {2, {&decode_ands, &decode_b_cond}, NULL, &fused_ands_b_cond, "ands+b_cond"},
+    {2, {&decode_add_sub_immediate, &decode_b_cond}, NULL, &fused_add_sub_immediate_b_cond, "add_sub_immediate+b_cond"},
+    {2, {&decode_add_sub_shifted, &decode_b_cond}, NULL, &fused_add_sub_shifted_b_cond, "add_sub_shifted+b_cond"},
+    {2, {&decode_logical_shifted, &decode_b_cond}, NULL, &fused_logical_shifted_b_cond, "logical_shifted+b_cond"},
+    {2, {&decode_add_immediate, &decode_cbnz}, NULL, &fused_add_immediate_cbnz, "add_immediate+cbnz"},
+    {2, {&decode_add_immediate, &decode_cbz}, NULL, &fused_add_immediate_cbz, "add_immediate+cbz"},
+    {2, {&decode_add_sub_immediate, &decode_cbnz}, NULL, &fused_add_sub_immediate_cbnz, "add_sub_immediate+cbnz"},
+    {2, {&decode_add_sub_immediate, &decode_cbz}, NULL, &fused_add_sub_immediate_cbz, "add_sub_immediate+cbz"},
+    {3, {&decode_movz, &decode_movk, &decode_movk}, NULL, &fused_movz_movk_movk, "movz+movk+movk"},
+    {2, {&decode_movz, &decode_movk}, NULL, &fused_movz_movk, "movz+movk"},
+    {3, {&decode_ldur, &decode_add_immediate, &decode_stur}, NULL, &fused_ldur_add_immediate_stur, "ldur+add_immediate+stur"},
+    {3, {&decode_ldur, &decode_add_extended_register, &decode_stur}, NULL, &fused_ldur_add_register_stur, "ldur+add_register+stur"},
+    {3, {&decode_ldur, &decode_add_sub_immediate, &decode_stur}, NULL, &fused_ldur_add_sub_immediate_stur, "ldur+add_sub_immediate+stur"},
+    {3, {&decode_ldur, &decode_add_sub_shifted, &decode_stur}, NULL, &fused_ldur_add_sub_shifted_stur, "ldur+add_sub_shifted+stur"},
+};
+
+static const int FUSIONS_SIZE = sizeof(FUSIONS) / sizeof(FUSIONS[0]);
+
+
+/* Superinstruccion que empieza en la palabra w (indice en FUSIONS + 1), o 0. */
+static uint8_t fusion_at(uint64_t w) {
+    for (int k = 0; k < FUSIONS_SIZE; k++) {
+        const fusion_t *f = &FUSIONS[k];
+        int j;
+
+        if (w + f->length > PREDECODE_WORDS)
+            continue;
+        for (j = 0; j < f->length; j++) {
+            uint16_t entry = PREDECODED[w + j];
+            if (entry == 0 || entry == PREDECODE_UNKNOWN ||
+                    INSTRUCTION_SET[entry - 1].function != f->components[j])
+                break;
+            /* un destino de salto corta la secuencia */
+            if (j > 0 && predecode_block_leader(MEM_TEXT_START + 4 * (w + j)))
+                break;
+        }
+        if (j == f->length && (f->applies == NULL || f->applies(&PREDECODED_WORDS[w])))
+            return k + 1;
+    }
+    return 0;
+}
+
+/* Marca las superinstrucciones de las primeras nwords palabras. */
+static void fuse_program(uint64_t nwords) {
+    for (uint64_t w = 0; w < nwords; w++)
+        FUSED[w] = PREDECODED[w] ? fusion_at(w) : 0;
+}
+
+
+/**
+ * Descarta toda la predecodificacion (el segmento de texto cambio entero,
+ * por ejemplo al restaurar un checkpoint).
+ */
+void predecode_reset() {
+    PREDECODED = PREDECODED_STORAGE;
+    PREDECODED_WORDS = PREDECODED_WORDS_STORAGE;
+    LEADERS = LEADERS_STORAGE;
+    memset(PREDECODED_STORAGE, 0, sizeof(PREDECODED_STORAGE));
+    memset(LEADERS_STORAGE, 0, sizeof(LEADERS_STORAGE));
+    memset(FUSED, 0, sizeof(FUSED));
+    FUSED_STALE = TRUE;
+}
+
+
+/**
+ * Reemplaza las tablas de predecodificacion (por ejemplo, por las de un
+ * archivo mapeado). Cada una tiene PREDECODE_WORDS entradas (LEADERS, una
+ * por bit).
+ */
+void predecode_attach(uint16_t *entries, uint32_t *words, uint64_t *leaders) {
+    PREDECODED = entries;
+    PREDECODED_WORDS = words;
+    LEADERS = leaders;
+    PROGRAM_WORDS = PREDECODE_WORDS;
+    fuse_program(PREDECODE_WORDS);
+    FUSED_STALE = FALSE;
+}
+
+
+/**
+ * Devuelve las tablas de predecodificacion en uso.
+ */
+void predecode_tables(uint16_t **entries, uint32_t **words, uint64_t **leaders) {
+    *entries = PREDECODED;
+    *words = PREDECODED_WORDS;
+    *leaders = LEADERS;
+}
+
+/* Marca un comienzo de bloque y corta las superinstrucciones que lo cruzan. */
+static void mark_leader(uint64_t address) {
+    uint64_t offset = address - MEM_TEXT_START;
+
+    if (offset < MEM_TEXT_SIZE && (offset & 3) == 0) {
+        LEADERS[offset >> 8] |= 1ULL << ((offset >> 2) & 63);
+        for (uint64_t w = offset >> 2 >= 2 ? (offset >> 2) - 2 : 0; w < offset >> 2; w++)
+            FUSED[w] = 0;
+    }
+}
+
+/* Destino de un salto directo (B, BL, B.cond, CBZ/CBNZ, TBZ/TBNZ), o 0. */
+static uint64_t branch_target(uint64_t pc, uint32_t instruction) {
+    if ((instruction & 0x7C000000) == 0x14000000)
+        return pc + ((int64_t)((uint64_t)instruction << 38) >> 36);
+    if ((instruction & 0xFF000010) == 0x54000000 || (instruction & 0x7E000000) == 0x34000000)
+        return pc + ((int64_t)((uint64_t)(instruction >> 5) << 45) >> 43);
+    if ((instruction & 0x7E000000) == 0x36000000)
+        return pc + ((int64_t)((uint64_t)(instruction >> 5) << 50) >> 48);
+    return 0;
+}
+
+/* Despues de un salto o HLT empieza un bloque, y otro en el destino. */
+static void mark_successors(uint64_t pc, uint32_t instruction, int i) {
+    if ((i >= 0 && (INSTRUCTION_SET[i].effects & EFFECT_BRANCH)) ||
+            (instruction & 0xFFE0001F) == 0xD4400000) {
+        mark_leader(pc + 4);
+        mark_leader(branch_target(pc, instruction));
+    }
+}
+
+
+/**
+ * Invalida la predecodificacion de las palabras que toca una escritura
+ * de 32 bits (dos si no esta alineada). Si la palabra nueva es un salto,
+ * ademas marca en LEADERS los bloques que abre; las marcas viejas quedan
+ * (un comienzo de bloque de mas solo evita alguna fusion).
+ *
+ * Params: address (uint64_t): Direccion escrita.
+ */
+void predecode_invalidate(uint64_t address) {
+    uint64_t offset = address - MEM_TEXT_START;
+
+    if (offset < MEM_TEXT_SIZE)
+        PREDECODED[offset >> 2] = 0;
+    if (offset + 3 < MEM_TEXT_SIZE)
+        PREDECODED[(offset + 3) >> 2] = 0;
+    /* y las superinstrucciones que las incluyen (empiezan hasta 2 antes) */
+    for (uint64_t w = offset >> 2; offset < MEM_TEXT_SIZE && w <= (offset + 3) >> 2 &&
+            w < PREDECODE_WORDS; w++) {
+        uint64_t pc = MEM_TEXT_START + 4 * w;
+        uint32_t instruction = mem_peek_32(pc);
+
+        for (uint64_t k = w >= 2 ? w - 2 : 0; k <= w; k++)
+            FUSED[k] = 0;
+        mark_successors(pc, instruction, lookup_instruction(instruction));
+    }
+}
+
+
+/**
+ * Decodifica las primeras palabras del segmento de texto y arma el mapa
+ * de bloques basicos.
+ *
+ * Params: nwords (uint64_t): Palabras del programa.
+ *         entry (uint64_t): PC inicial, que siempre empieza un bloque.
+ */
+void predecode_program(uint64_t nwords, uint64_t entry) {
+    predecode_reset();
+    if (nwords > PREDECODE_WORDS)
+        nwords = PREDECODE_WORDS;
+    PROGRAM_WORDS = nwords;
+    PROGRAM_ENTRY = entry;
+
+    mark_leader(entry);
+    for (uint64_t w = 0; w < nwords; w++) {
+        uint64_t pc = MEM_TEXT_START + 4 * w;
+        uint32_t instruction = mem_peek_32(pc);
+        int i = lookup_instruction(instruction);
+
+        PREDECODED[w] = (i < 0) ? PREDECODE_UNKNOWN : i + 1;
+        PREDECODED_WORDS[w] = instruction;
+        mark_successors(pc, instruction, i);
+    }
+    fuse_program(nwords);
+    FUSED_STALE = FALSE;
+}
+
+
+/**
+ * Indica si una direccion empieza un bloque basico segun el mapa de
+ * predecode_program.
+ */
+int predecode_block_leader(uint64_t pc) {
+    uint64_t offset = pc - MEM_TEXT_START;
+
+    return offset < MEM_TEXT_SIZE && (LEADERS[offset >> 8] >> ((offset >> 2) & 63) & 1);
+}
+
+
+/**
+ * Obtiene una instruccion y su indice en INSTRUCTION_SET, usando (y
+ * completando) la tabla de predecodificacion si el PC cae en el
+ * segmento de texto.
+ *
+ * Params: pc (uint64_t): Direccion de la instruccion.
+ *         instruction (uint32_t *): Salida, instruccion codificada.
+ *
+ * Returns: int: Indice en INSTRUCTION_SET, o -1 si no se reconoce.
+ */
+int predecode(uint64_t pc, uint32_t *instruction) {
+    uint64_t offset = pc - MEM_TEXT_START;
+    int i;
+
+    if (offset < MEM_TEXT_SIZE && (offset & 3) == 0) {
+        uint16_t entry = PREDECODED[offset >> 2];
+        if (entry == 0) {
+            *instruction = mem_peek_32(pc);
+            if (HPROF_ACTIVE)
+                hprof_mark(HPROF_FETCH);
+            i = lookup_instruction(*instruction);
+            PREDECODED[offset >> 2] = (i < 0) ? PREDECODE_UNKNOWN : i + 1;
+            PREDECODED_WORDS[offset >> 2] = *instruction;
+        } else {
+            *instruction = PREDECODED_WORDS[offset >> 2];
+            if (HPROF_ACTIVE)
+                hprof_mark(HPROF_FETCH);
+            i = (entry == PREDECODE_UNKNOWN) ? -1 : entry - 1;
+        }
+    } else {
+        *instruction = mem_peek_32(pc);
+        if (HPROF_ACTIVE)
+            hprof_mark(HPROF_FETCH);
+        i = lookup_instruction(*instruction);
+    }
+    return i;
+}
+
+
+/**
+ * Ejecuta una instruccion por el camino predecodificado: sin mensajes
+ * de depuracion ni analizadores. Igual que decode_instruction, una
+ * instruccion no reconocida no modifica el estado.
+ *
+ * Returns: int: Indice en INSTRUCTION_SET de la instruccion ejecutada, o -1.
+ */
+int process_instruction_fast() {
+    uint32_t instruction;
+    int i = predecode(CURRENT_STATE.PC, &instruction);
+
+    if (HPROF_ACTIVE)
+        hprof_mark(HPROF_DECODE);
+    if (LIVE_ENABLED)
+        live_count(i);
+    if (i < 0) {
+        if (HPROF_ACTIVE)
+            hprof_execute(-1);
+        return -1;
+    }
+
+    ((void (*)(uint32_t))INSTRUCTION_SET[i].function)(instruction);
+    NEXT_STATE.REGS[31] = 0;
+    if (HPROF_ACTIVE)
+        hprof_execute(i);
+    return i;
+}
+
+
+/**
+ * Ejecuta la superinstruccion que empieza en el PC, si la hay y no tiene
+ * mas de budget instrucciones. Como process_instruction_fast, deja el
+ * resultado en NEXT_STATE; las fronteras intermedias no pasan por los
+ * hooks del ciclo, asi que solo se usa cuando ninguno esta activo.
+ *
+ * Params: budget (uint64_t): Maximo de instrucciones a ejecutar.
+ *
+ * Returns: int: Instrucciones ejecutadas, o 0 si no habia superinstruccion.
+ */
+int process_fused(uint64_t budget) {
+    uint64_t offset = CURRENT_STATE.PC - MEM_TEXT_START;
+    const fusion_t *f;
+
+    if (FUSED_STALE)
+        predecode_program(PROGRAM_WORDS, PROGRAM_ENTRY);
+    if (offset >= MEM_TEXT_SIZE || (offset & 3) || FUSED[offset >> 2] == 0)
+        return 0;
+    f = &FUSIONS[FUSED[offset >> 2] - 1];
+    if ((uint64_t)f->length > budget)
+        return 0;
+    f->function(&PREDECODED_WORDS[offset >> 2]);
+    NEXT_STATE.REGS[31] = 0;
+    return f->length;
+}
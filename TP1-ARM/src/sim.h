@@ -0,0 +1,73 @@
+/***************************************************************/
+/*                                                             */
+/*   Tabla de instrucciones del simulador                      */
+/*                                                             */
+/***************************************************************/
+
+#ifndef _SIM_SIM_H_
+#define _SIM_SIM_H_
+
+#include <inttypes.h>
+
+/*
+ * Efectos de cada instruccion sobre el estado arquitectonico. Los campos
+ * Rd/Rt (bits 0-4), Rn (bits 5-9) y Rm (bits 16-20) son los del formato.
+ */
+#define EFFECT_WRITES_RD    (1 << 0)
+#define EFFECT_READS_RD     (1 << 1)    /* Rt de los stores y de CBZ/CBNZ */
+#define EFFECT_READS_RN     (1 << 2)
+#define EFFECT_READS_RM     (1 << 3)
+#define EFFECT_SETS_FLAGS   (1 << 4)
+#define EFFECT_READS_FLAGS  (1 << 5)
+#define EFFECT_LOAD         (1 << 6)
+#define EFFECT_STORE        (1 << 7)
+#define EFFECT_BRANCH       (1 << 8)
+#define EFFECT_MULTIPLY     (1 << 9)
+#define EFFECT_DIVIDE       (1 << 10)
+#define EFFECT_READS_RA     (1 << 11)   /* bits 14-10: acumulador de MADD/MSUB */
+#define EFFECT_READS_RT2    (1 << 12)   /* bits 14-10: segundo registro de STP */
+#define EFFECT_WRITES_RT2   (1 << 13)   /* bits 14-10: segundo registro de LDP */
+#define EFFECT_WRITEBACK    (1 << 14)   /* actualiza la base Rn (pre/post-indexado) */
+#define EFFECT_VECTOR_RD    (1 << 15)   /* Rd/Rt/Rt2 son registros V */
+#define EFFECT_VECTOR_RN    (1 << 16)   /* Rn/Rm/Ra son registros V */
+#define EFFECT_FP           (1 << 17)   /* operacion de punto flotante */
+#define EFFECT_WRITES_LINK  (1 << 18)   /* escribe X30 (BL, BLR) */
+
+/*
+ * Registros que puede leer o escribir una instruccion segun sus efectos:
+ * 0-30 son X0-X30 y 32-63 son V0-V31. De LD1/ST1 y TBL con varios
+ * registros solo se cuenta el primero.
+ */
+#define EFFECT_MAX_REGISTERS 4
+#define EFFECT_REGISTERS     64
+#define EFFECT_VECTOR_BASE   32
+
+typedef struct instruction_information{
+    uint32_t mask;            /* bits fijos del formato */
+    uint32_t value;           /* valor de esos bits */
+    void* function;
+    uint32_t effects;
+    const char *name;
+} inst_info;
+
+extern inst_info INSTRUCTION_SET[];
+extern const int INSTRUCTION_SET_SIZE;
+
+/* Una entrada de predecodificacion por palabra del segmento de texto. */
+#define PREDECODE_WORDS     (MEM_TEXT_SIZE / 4)
+#define PREDECODE_UNKNOWN   0xFFFF
+
+int  lookup_instruction(uint32_t instruction);
+int  effect_sources(uint32_t instruction, uint32_t effects, int *regs);
+int  effect_destinations(uint32_t instruction, uint32_t effects, int *regs);
+void predecode_invalidate(uint64_t address);
+void predecode_reset();
+void predecode_attach(uint16_t *entries, uint32_t *words, uint64_t *leaders);
+void predecode_tables(uint16_t **entries, uint32_t **words, uint64_t **leaders);
+void predecode_program(uint64_t nwords, uint64_t entry);
+int  predecode_block_leader(uint64_t pc);
+int  predecode(uint64_t pc, uint32_t *instruction);
+int  process_instruction_fast();
+int  process_fused(uint64_t budget);
+
+#endif
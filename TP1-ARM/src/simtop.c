@@ -0,0 +1,121 @@
+/***************************************************************/
+/*                                                             */
+/*   simtop: muestra los contadores en vivo de un simulador    */
+/*                                                             */
+/*   Uso: simtop <pid|nombre> [intervalo_ms]                   */
+/*                                                             */
+/*   Solo lee la pagina compartida: no interrumpe al           */
+/*   simulador ni le agrega trabajo.                           */
+/*                                                             */
+/***************************************************************/
+
+#define SIMTOP
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "live.h"
+
+#define TOP_OPCODES 12
+
+static live_page_t SNAPSHOT, PREVIOUS;
+
+#define LOAD(field) __atomic_load_n(&page->field, __ATOMIC_RELAXED)
+
+/**
+ * Copia una vista consistente de la pagina (lado lector del seqlock).
+ */
+static void read_snapshot(const live_page_t *page, live_page_t *out) {
+    uint32_t before, after;
+
+    do {
+        while ((before = __atomic_load_n(&page->sequence, __ATOMIC_ACQUIRE)) & 1)
+            ;
+        out->running = LOAD(running);
+        out->instructions = LOAD(instructions);
+        out->instructions_per_second = LOAD(instructions_per_second);
+        out->pc = LOAD(pc);
+        out->mem_reads = LOAD(mem_reads);
+        out->mem_writes = LOAD(mem_writes);
+        for (uint32_t i = 0; i < page->nopcodes; i++)
+            out->opcodes[i] = LOAD(opcodes[i]);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&page->sequence, __ATOMIC_RELAXED);
+    } while (before != after);
+}
+
+static void show(const live_page_t *page) {
+    int order[LIVE_MAX_OPCODES], n = page->nopcodes;
+    uint64_t delta[LIVE_MAX_OPCODES];
+
+    for (int i = 0; i < n; i++) {
+        order[i] = i;
+        delta[i] = SNAPSHOT.opcodes[i] - PREVIOUS.opcodes[i];
+    }
+    /* pocos opcodes: insercion por total acumulado */
+    for (int i = 1; i < n; i++)
+        for (int j = i; j > 0 && SNAPSHOT.opcodes[order[j]] > SNAPSHOT.opcodes[order[j - 1]]; j--) {
+            int t = order[j]; order[j] = order[j - 1]; order[j - 1] = t;
+        }
+
+    printf("\033[H\033[J");
+    printf("arm-sim pid %u  %s\n\n", page->pid, SNAPSHOT.running ? "running" : "halted");
+    printf("Instructions      : %" PRIu64 "\n", SNAPSHOT.instructions);
+    printf("Instructions/sec  : %" PRIu64 "\n", SNAPSHOT.instructions_per_second);
+    printf("PC                : 0x%" PRIx64 "\n", SNAPSHOT.pc);
+    printf("Memory reads      : %" PRIu64 "\n", SNAPSHOT.mem_reads);
+    printf("Memory writes     : %" PRIu64 "\n\n", SNAPSHOT.mem_writes);
+    printf("%-24s %16s %12s\n", "opcode", "total", "interval");
+    for (int i = 0; i < n && i < TOP_OPCODES; i++) {
+        if (SNAPSHOT.opcodes[order[i]] == 0) break;
+        printf("%-24.*s %16" PRIu64 " %12" PRIu64 "\n", LIVE_NAME_LENGTH, page->names[order[i]],
+               SNAPSHOT.opcodes[order[i]], delta[order[i]]);
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[]) {
+    char path[64];
+    const live_page_t *page;
+    int fd, interval = argc > 2 ? atoi(argv[2]) : 500;
+
+    if (argc < 2) {
+        printf("Usage: %s <pid|name> [interval_ms]\n", argv[0]);
+        exit(1);
+    }
+    if (isdigit((unsigned char)argv[1][0]))
+        snprintf(path, sizeof(path), "/arm-sim.%s", argv[1]);
+    else
+        snprintf(path, sizeof(path), "/%s", argv[1][0] == '/' ? argv[1] + 1 : argv[1]);
+
+    fd = shm_open(path, O_RDONLY, 0);
+    if (fd < 0) {
+        perror(path);
+        exit(1);
+    }
+    page = mmap(NULL, sizeof(live_page_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (page == MAP_FAILED) {
+        perror(path);
+        exit(1);
+    }
+    while (__atomic_load_n(&page->magic, __ATOMIC_ACQUIRE) != LIVE_MAGIC)
+        usleep(1000);
+    if (page->version != LIVE_VERSION) {
+        printf("Error: %s has version %u, expected %u\n", path, page->version, LIVE_VERSION);
+        exit(1);
+    }
+
+    read_snapshot(page, &PREVIOUS);
+    do {
+        usleep(interval * 1000);
+        read_snapshot(page, &SNAPSHOT);
+        show(page);
+        PREVIOUS = SNAPSHOT;
+    } while (SNAPSHOT.running);
+    return 0;
+}
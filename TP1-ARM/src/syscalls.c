@@ -0,0 +1,719 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include "shell.h"
+#include "sim.h"
+#include "dirty.h"
+#include "breakpoint.h"
+#include "syscalls.h"
+
+/*
+ * Llamadas al sistema de Linux AArch64: numero en X8, argumentos en
+ * X0-X5 y resultado (o -errno) en X0.
+ *
+ * - read/write/writev pasan a los descriptores del host. La salida a los
+ *   descriptores 1 y 2 se acumula en un buffer que se vacia al llenarse,
+ *   al leer de la entrada, al terminar el programa y al volver al shell
+ *   (syscall_flush). El descriptor 0 se lee del FILE stdin del shell, de
+ *   a una linea como una terminal: el programa y los comandos comparten
+ *   el mismo buffer, y la entrada del programa empieza en la linea que
+ *   sigue al comando que lo puso a correr (syscall_shell_command).
+ *   Los errores del host se traducen a los errno de Linux AArch64.
+ * - brk crece desde el final de los datos cargados y mmap (solo anonimo)
+ *   asigna el hueco libre mas alto entre el heap y el final del segmento
+ *   de datos. munmap libera cualquier parte de una asignacion.
+ * - getrandom usa un generador con semilla fija: las corridas se repiten.
+ *
+ * Mientras time travel graba la historia (SYSCALLS_RECORDING), las
+ * llamadas cuyo resultado depende del host (read, write, writev y
+ * clock_gettime) se registran: X0 y los bytes que copiaron a la memoria
+ * simulada. La re-ejecucion (SYSCALLS_REPLAYING) toma esos resultados del
+ * registro sin volver a llamar al host, asi reconstruye la misma historia.
+ */
+
+#define SYS_READ            63
+#define SYS_WRITE           64
+#define SYS_WRITEV          66
+#define SYS_EXIT            93
+#define SYS_EXIT_GROUP      94
+#define SYS_CLOCK_GETTIME   113
+#define SYS_BRK             214
+#define SYS_MUNMAP          215
+#define SYS_MMAP            222
+#define SYS_GETRANDOM       278
+
+#define E_INTR      4
+#define E_IO        5
+#define E_BADF      9
+#define E_AGAIN     11
+#define E_NOMEM     12
+#define E_ACCES     13
+#define E_FAULT     14
+#define E_NODEV     19
+#define E_ISDIR     21
+#define E_INVAL     22
+#define E_NOSPC     28
+#define E_PIPE      32
+#define E_NOSYS     38
+
+#define GUEST_MAP_ANONYMOUS 0x20
+#define GUEST_MAP_FIXED     0x10
+#define GUEST_PAGE          4096
+#define RANDOM_SEED         0x5EED5EED5EED5EEDULL
+#define OUTPUT_BUFFER_SIZE  65536
+
+syscall_state_t SYSCALL_STATE = {
+    .brk_start = MEM_DATA_START,
+    .brk = MEM_DATA_START,
+    .mmap_top = MEM_DATA_START + MEM_DATA_SIZE,
+    .random_state = RANDOM_SEED,
+    .exited = FALSE,
+};
+int SYSCALLS_RECORDING = FALSE;
+int SYSCALLS_REPLAYING = FALSE;
+
+static uint8_t OUTPUT[OUTPUT_BUFFER_SIZE];
+static uint32_t OUTPUT_USED;
+static uint8_t WARNED[512];
+/* queda el final de la linea del ultimo comando del shell en stdin */
+static int COMMAND_LINE_PENDING;
+
+/* Una llamada registrada, con a lo sumo un bloque copiado a la memoria. */
+typedef struct {
+    uint64_t instruction;           /* INSTRUCTION_COUNT del SVC */
+    uint64_t number;
+    int64_t result;
+    uint64_t address, length;       /* bytes copiados a la memoria simulada */
+    uint64_t data;                  /* su posicion en LOG_BYTES */
+} syscall_record_t;
+
+/* Ordenado por instruccion. RECORDING: indice de la llamada en curso, o -1. */
+static syscall_record_t *LOG;
+static uint64_t LOG_COUNT, LOG_CAPACITY;
+static uint8_t *LOG_BYTES;
+static uint64_t LOG_BYTES_USED, LOG_BYTES_CAPACITY;
+static int64_t RECORDING = -1;
+
+
+static uint64_t page_align(uint64_t value) {
+    return (value + GUEST_PAGE - 1) & ~(uint64_t)(GUEST_PAGE - 1);
+}
+
+/*
+ * Puntero a [address, address + length) en la memoria simulada si el rango
+ * cae entero en una region; region recibe su indice.
+ */
+static uint8_t *guest_pointer(uint64_t address, uint64_t length, int *region) {
+    for (int i = 0; i < MEM_NREGIONS; i++) {
+        uint64_t offset = address - MEM_REGIONS[i].start;
+        if (address >= MEM_REGIONS[i].start && offset <= MEM_REGIONS[i].size &&
+                length <= MEM_REGIONS[i].size - offset) {
+            *region = i;
+            return MEM_REGIONS[i].mem + offset;
+        }
+    }
+    return NULL;
+}
+
+/* Avisa a los que siguen escrituras (dirty, predecode, watchpoints). */
+static void guest_written(int region, uint64_t address, uint64_t length) {
+    uint64_t offset = address - MEM_REGIONS[region].start;
+
+    if (length == 0)
+        return;
+    if (DIRTY_TRACKING) {
+        for (uint64_t o = offset & ~(uint64_t)(DIRTY_PAGE_SIZE - 1); o < offset + length; o += DIRTY_PAGE_SIZE)
+            dirty_write(region, o);
+    }
+    if (MEM_REGIONS[region].start == MEM_TEXT_START) {
+        for (uint64_t a = address & ~3ULL; a < address + length; a += 4)
+            predecode_invalidate(a);
+    }
+    if (WATCHPOINTS_SET) {
+        for (uint64_t a = address & ~3ULL; a < address + length; a += 4)
+            watch_access(a, TRUE);
+    }
+}
+
+static void guest_read(uint64_t address, uint64_t length) {
+    if (WATCHPOINTS_SET) {
+        for (uint64_t a = address & ~3ULL; a < address + length; a += 4)
+            watch_access(a, FALSE);
+    }
+}
+
+static int copy_to_guest(uint64_t address, const void *data, uint64_t length) {
+    int region;
+    uint8_t *target = guest_pointer(address, length, &region);
+
+    if (target == NULL)
+        return FALSE;
+    memcpy(target, data, length);
+    guest_written(region, address, length);
+    return TRUE;
+}
+
+/* Indice del registro de la llamada en la instruccion dada, o -1. */
+static int64_t find_record(uint64_t instruction) {
+    int64_t low = 0, high = (int64_t)LOG_COUNT - 1;
+
+    while (low <= high) {
+        int64_t middle = (low + high) / 2;
+        if (LOG[middle].instruction == instruction)
+            return middle;
+        if (LOG[middle].instruction < instruction)
+            low = middle + 1;
+        else
+            high = middle - 1;
+    }
+    return -1;
+}
+
+/* Descarta lo registrado desde la instruccion dada (la historia cambia). */
+static void truncate_log(uint64_t instruction) {
+    while (LOG_COUNT > 0 && LOG[LOG_COUNT - 1].instruction >= instruction)
+        LOG_COUNT--;
+    LOG_BYTES_USED = LOG_COUNT ? LOG[LOG_COUNT - 1].data + LOG[LOG_COUNT - 1].length : 0;
+}
+
+static int64_t begin_record(uint64_t number) {
+    syscall_record_t *r;
+
+    if (LOG_COUNT == LOG_CAPACITY) {
+        LOG_CAPACITY = LOG_CAPACITY ? 2 * LOG_CAPACITY : 64;
+        LOG = realloc(LOG, LOG_CAPACITY * sizeof(syscall_record_t));
+    }
+    r = &LOG[LOG_COUNT];
+    r->instruction = INSTRUCTION_COUNT;
+    r->number = number;
+    r->result = 0;
+    r->address = r->length = 0;
+    r->data = LOG_BYTES_USED;
+    return LOG_COUNT++;
+}
+
+/* Registra los bytes que la llamada en curso copio a la memoria simulada. */
+static void log_guest_write(uint64_t address, const uint8_t *data, uint64_t length) {
+    syscall_record_t *r;
+
+    if (RECORDING < 0 || length == 0)
+        return;
+    if (LOG_BYTES_USED + length > LOG_BYTES_CAPACITY) {
+        while (LOG_BYTES_USED + length > LOG_BYTES_CAPACITY)
+            LOG_BYTES_CAPACITY = LOG_BYTES_CAPACITY ? 2 * LOG_BYTES_CAPACITY : 4096;
+        LOG_BYTES = realloc(LOG_BYTES, LOG_BYTES_CAPACITY);
+    }
+    r = &LOG[RECORDING];
+    memcpy(LOG_BYTES + LOG_BYTES_USED, data, length);
+    r->address = address;
+    r->length = length;
+    LOG_BYTES_USED += length;
+}
+
+/* Llamadas cuyo resultado depende del host y no del estado simulado. */
+static int host_dependent(uint64_t number) {
+    return number == SYS_READ || number == SYS_WRITE || number == SYS_WRITEV ||
+           number == SYS_CLOCK_GETTIME;
+}
+
+static uint64_t next_random() {
+    uint64_t z = (SYSCALL_STATE.random_state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+
+/* ------------------------------------------------------------------ */
+/* E/S                                                                */
+/* ------------------------------------------------------------------ */
+
+/* -errno de Linux AArch64 para un errno del host. */
+static int64_t host_error(int error) {
+    switch (error) {
+    case EINTR:     return -E_INTR;
+    case EBADF:     return -E_BADF;
+    case EAGAIN:    return -E_AGAIN;
+    case ENOMEM:    return -E_NOMEM;
+    case EACCES:    return -E_ACCES;
+    case EFAULT:    return -E_FAULT;
+    case EISDIR:    return -E_ISDIR;
+    case EINVAL:    return -E_INVAL;
+    case ENOSPC:    return -E_NOSPC;
+    case EPIPE:     return -E_PIPE;
+    default:        return -E_IO;
+    }
+}
+
+static void write_all(int fd, const uint8_t *data, uint64_t length) {
+    while (length > 0) {
+        ssize_t n = write(fd, data, length);
+        if (n <= 0)
+            return;
+        data += n;
+        length -= n;
+    }
+}
+
+static int64_t host_write(int64_t fd, const uint8_t *data, uint64_t length) {
+    if (fd == 1) {
+        if (OUTPUT_USED + length > OUTPUT_BUFFER_SIZE)
+            syscall_flush();
+        if (length >= OUTPUT_BUFFER_SIZE) {
+            write_all(1, data, length);
+        } else {
+            memcpy(OUTPUT + OUTPUT_USED, data, length);
+            OUTPUT_USED += length;
+        }
+        return length;
+    }
+    if (fd == 2) {
+        /* sin buffer, pero despues de lo que ya se escribio a stdout */
+        syscall_flush();
+        write_all(2, data, length);
+        return length;
+    }
+    {
+        ssize_t n = write(fd, data, length);
+        return n < 0 ? host_error(errno) : n;
+    }
+}
+
+static int64_t sys_write(int64_t fd, uint64_t buffer, uint64_t length) {
+    int region;
+    const uint8_t *data = guest_pointer(buffer, length, &region);
+
+    if (data == NULL)
+        return -E_FAULT;
+    guest_read(buffer, length);
+    return host_write(fd, data, length);
+}
+
+static int64_t sys_writev(int64_t fd, uint64_t iov, int64_t count) {
+    int64_t total = 0;
+
+    for (int64_t i = 0; i < count; i++) {
+        int region;
+        const uint8_t *entry = guest_pointer(iov + 16 * i, 16, &region);
+        uint64_t base, length;
+        int64_t n;
+
+        if (entry == NULL)
+            return -E_FAULT;
+        memcpy(&base, entry, 8);
+        memcpy(&length, entry + 8, 8);
+        n = sys_write(fd, base, length);
+        if (n < 0)
+            return total ? total : n;
+        total += n;
+    }
+    return total;
+}
+
+/*
+ * Lee del FILE stdin hasta length bytes o el fin de la linea. Lo que quedo
+ * del comando del shell (blancos y el fin de linea) no es del programa.
+ */
+static int64_t read_stdin(uint8_t *data, uint64_t length) {
+    uint64_t n = 0;
+    int c;
+
+    if (COMMAND_LINE_PENDING) {
+        COMMAND_LINE_PENDING = FALSE;
+        while ((c = getc(stdin)) == ' ' || c == '\t');
+        if (c != '\n' && c != EOF)
+            ungetc(c, stdin);
+    }
+    while (n < length && (c = getc(stdin)) != EOF) {
+        data[n++] = c;
+        if (c == '\n')
+            break;
+    }
+    if (n == 0 && ferror(stdin)) {
+        int error = errno;
+        clearerr(stdin);
+        return host_error(error);
+    }
+    /* un EOF de la terminal corta esta lectura, no al shell */
+    clearerr(stdin);
+    return n;
+}
+
+static int64_t sys_read(int64_t fd, uint64_t buffer, uint64_t length) {
+    int region;
+    uint8_t *data = guest_pointer(buffer, length, &region);
+    int64_t n;
+
+    if (data == NULL)
+        return -E_FAULT;
+    if (fd == 0) {
+        syscall_flush();
+        n = read_stdin(data, length);
+    } else {
+        n = read(fd, data, length);
+        if (n < 0)
+            n = host_error(errno);
+    }
+    if (n < 0)
+        return n;
+    guest_written(region, buffer, n);
+    log_guest_write(buffer, data, n);
+    return n;
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Memoria                                                            */
+/* ------------------------------------------------------------------ */
+
+static int64_t sys_brk(uint64_t address) {
+    int region;
+    uint8_t *data;
+
+    if (address < SYSCALL_STATE.brk_start || address > SYSCALL_STATE.mmap_top)
+        return SYSCALL_STATE.brk;
+    /* lo que se vuelve a pedir despues de achicar el heap empieza en cero */
+    if (address > SYSCALL_STATE.brk) {
+        data = guest_pointer(SYSCALL_STATE.brk, address - SYSCALL_STATE.brk, &region);
+        if (data == NULL)
+            return SYSCALL_STATE.brk;
+        memset(data, 0, address - SYSCALL_STATE.brk);
+        guest_written(region, SYSCALL_STATE.brk, address - SYSCALL_STATE.brk);
+    }
+    SYSCALL_STATE.brk = address;
+    return address;
+}
+
+/*
+ * Asignaciones de mmap: intervalos [start, end) de paginas, ordenados y
+ * sin solaparse. mmap_top es el comienzo del mas bajo y limita a brk.
+ */
+static void update_mmap_top() {
+    SYSCALL_STATE.mmap_top = SYSCALL_STATE.nmappings ? SYSCALL_STATE.mappings[0].start
+                                                     : MEM_DATA_START + MEM_DATA_SIZE;
+}
+
+/* Quita [start, end) de las asignaciones; FALSE si partir una no entra. */
+static int remove_mapping(uint64_t start, uint64_t end) {
+    syscall_state_t *s = &SYSCALL_STATE;
+
+    for (int i = 0; i < s->nmappings; i++) {
+        uint64_t low = s->mappings[i].start, high = s->mappings[i].end;
+
+        if (high <= start || low >= end)
+            continue;
+        if (low < start && high > end) {
+            if (s->nmappings == SYSCALL_MAX_MAPPINGS)
+                return FALSE;
+            memmove(&s->mappings[i + 2], &s->mappings[i + 1],
+                    (s->nmappings - i - 1) * sizeof(s->mappings[0]));
+            s->mappings[i].end = start;
+            s->mappings[i + 1].start = end;
+            s->mappings[i + 1].end = high;
+            s->nmappings++;
+            return TRUE;
+        }
+        if (low < start) {
+            s->mappings[i].end = start;
+        } else if (high > end) {
+            s->mappings[i].start = end;
+        } else {
+            memmove(&s->mappings[i], &s->mappings[i + 1],
+                    (s->nmappings - i - 1) * sizeof(s->mappings[0]));
+            s->nmappings--;
+            i--;
+        }
+    }
+    return TRUE;
+}
+
+/* Agrega [start, end), que no se solapa con ninguna; FALSE si no entra. */
+static int add_mapping(uint64_t start, uint64_t end) {
+    syscall_state_t *s = &SYSCALL_STATE;
+    int i = 0;
+
+    while (i < s->nmappings && s->mappings[i].start < start)
+        i++;
+    if (i > 0 && s->mappings[i - 1].end == start) {
+        s->mappings[i - 1].end = end;
+        if (i < s->nmappings && s->mappings[i].start == end) {
+            s->mappings[i - 1].end = s->mappings[i].end;
+            memmove(&s->mappings[i], &s->mappings[i + 1],
+                    (s->nmappings - i - 1) * sizeof(s->mappings[0]));
+            s->nmappings--;
+        }
+        return TRUE;
+    }
+    if (i < s->nmappings && s->mappings[i].start == end) {
+        s->mappings[i].start = start;
+        return TRUE;
+    }
+    if (s->nmappings == SYSCALL_MAX_MAPPINGS)
+        return FALSE;
+    memmove(&s->mappings[i + 1], &s->mappings[i], (s->nmappings - i) * sizeof(s->mappings[0]));
+    s->mappings[i].start = start;
+    s->mappings[i].end = end;
+    s->nmappings++;
+    return TRUE;
+}
+
+/* Comienzo del hueco libre mas alto de length bytes sobre el heap, o 0. */
+static uint64_t find_free(uint64_t length) {
+    uint64_t floor = page_align(SYSCALL_STATE.brk);
+    uint64_t top = MEM_DATA_START + MEM_DATA_SIZE;
+
+    for (int i = SYSCALL_STATE.nmappings - 1; i >= -1; i--) {
+        uint64_t low = i >= 0 ? SYSCALL_STATE.mappings[i].end : floor;
+        if (top >= low && top - low >= length)
+            return top - length;
+        if (i >= 0)
+            top = SYSCALL_STATE.mappings[i].start;
+    }
+    return 0;
+}
+
+static int64_t sys_mmap(uint64_t address, uint64_t length, int64_t flags, int64_t fd) {
+    int region;
+    uint8_t *data;
+
+    if (length == 0)
+        return -E_INVAL;
+    if (!(flags & GUEST_MAP_ANONYMOUS))
+        return fd < 0 ? -E_BADF : -E_NODEV;
+    length = page_align(length);
+
+    if (flags & GUEST_MAP_FIXED) {
+        /* reemplaza lo que hubiera, pero nunca el programa ni el heap */
+        if (address & (GUEST_PAGE - 1))
+            return -E_INVAL;
+        if (address < page_align(SYSCALL_STATE.brk) ||
+                address + length > MEM_DATA_START + MEM_DATA_SIZE || address + length < address)
+            return -E_NOMEM;
+        if (!remove_mapping(address, address + length))
+            return -E_NOMEM;
+    } else {
+        address = find_free(length);
+        if (address == 0)
+            return -E_NOMEM;
+    }
+    data = guest_pointer(address, length, &region);
+    if (data == NULL || !add_mapping(address, address + length))
+        return -E_NOMEM;
+    update_mmap_top();
+    memset(data, 0, length);
+    guest_written(region, address, length);
+    return address;
+}
+
+static int64_t sys_munmap(uint64_t address, uint64_t length) {
+    if ((address & (GUEST_PAGE - 1)) || length == 0)
+        return -E_INVAL;
+    if (!remove_mapping(address, address + page_align(length)))
+        return -E_NOMEM;
+    update_mmap_top();
+    return 0;
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Varios                                                             */
+/* ------------------------------------------------------------------ */
+
+static int64_t sys_clock_gettime(int64_t clock, uint64_t result) {
+    struct timespec now;
+    int64_t value[2];
+
+    if (clock_gettime((clockid_t)clock, &now) != 0)
+        return -E_INVAL;
+    value[0] = now.tv_sec;
+    value[1] = now.tv_nsec;
+    if (!copy_to_guest(result, value, sizeof(value)))
+        return -E_FAULT;
+    log_guest_write(result, (const uint8_t *)value, sizeof(value));
+    return 0;
+}
+
+static int64_t sys_getrandom(uint64_t buffer, uint64_t length) {
+    int region;
+    uint8_t *data = guest_pointer(buffer, length, &region);
+
+    if (data == NULL)
+        return -E_FAULT;
+    for (uint64_t i = 0; i < length; i += 8) {
+        uint64_t value = next_random();
+        memcpy(data + i, &value, length - i < 8 ? length - i : 8);
+    }
+    guest_written(region, buffer, length);
+    return length;
+}
+
+static void sys_exit(int64_t code) {
+    SYSCALL_STATE.exited = TRUE;
+    SYSCALL_STATE.exit_code = code & 0xFF;
+    RUN_BIT = FALSE;
+    if (!SYSCALLS_REPLAYING) {
+        syscall_flush();
+        printf("\nProgram exited with code %d\n", SYSCALL_STATE.exit_code);
+    }
+}
+
+
+/**
+ * Reinicia el estado del sistema operativo para un programa nuevo.
+ *
+ * Params: data_end (uint64_t): Fin de los datos cargados; ahi empieza brk.
+ */
+void syscall_reset(uint64_t data_end) {
+    SYSCALL_STATE.brk_start = SYSCALL_STATE.brk = page_align(data_end);
+    SYSCALL_STATE.mmap_top = MEM_DATA_START + MEM_DATA_SIZE;
+    SYSCALL_STATE.random_state = RANDOM_SEED;
+    SYSCALL_STATE.exited = FALSE;
+    SYSCALL_STATE.exit_code = 0;
+    SYSCALL_STATE.nmappings = 0;
+}
+
+
+/**
+ * Descarta el registro de llamadas (la historia de time travel empieza o
+ * termina).
+ */
+void syscall_log_clear() {
+    free(LOG);
+    free(LOG_BYTES);
+    LOG = NULL;
+    LOG_BYTES = NULL;
+    LOG_COUNT = LOG_CAPACITY = 0;
+    LOG_BYTES_USED = LOG_BYTES_CAPACITY = 0;
+    RECORDING = -1;
+}
+
+
+/**
+ * Arma la pila inicial de un proceso de Linux (argc, argv, envp y auxv)
+ * al final del segmento de pila y deja SP apuntando a argc.
+ *
+ * Params: name (const char *): argv[0].
+ *         entry (uint64_t): Punto de entrada (AT_ENTRY).
+ *         phdr, phnum (uint64_t): Tabla de program headers en memoria
+ *                                 (AT_PHDR/AT_PHNUM), 0 si no esta cargada.
+ */
+void syscall_setup_process(const char *name, uint64_t entry, uint64_t phdr, uint64_t phnum) {
+    static const char PLATFORM[] = "aarch64";
+    uint64_t top = ((uint64_t)MEM_STACK_START + MEM_STACK_SIZE) & ~15ULL;
+    uint64_t name_address, platform_address, random_address, sp;
+    uint64_t vector[64];
+    int n = 0;
+    uint8_t random[16];
+
+    /* cadenas y bytes de AT_RANDOM arriba de todo */
+    name_address = (top - strlen(name) - 1) & ~15ULL;
+    copy_to_guest(name_address, name, strlen(name) + 1);
+    platform_address = (name_address - sizeof(PLATFORM)) & ~15ULL;
+    copy_to_guest(platform_address, PLATFORM, sizeof(PLATFORM));
+    random_address = platform_address - sizeof(random);
+    for (int i = 0; i < (int)sizeof(random); i++)
+        random[i] = next_random();
+    copy_to_guest(random_address, random, sizeof(random));
+
+    vector[n++] = 1;                        /* argc */
+    vector[n++] = name_address;             /* argv */
+    vector[n++] = 0;
+    vector[n++] = 0;                        /* envp */
+#define AUX(type, value) do { vector[n++] = (type); vector[n++] = (value); } while (0)
+    if (phdr != 0) {
+        AUX(3, phdr);                       /* AT_PHDR */
+        AUX(4, 56);                         /* AT_PHENT */
+        AUX(5, phnum);                      /* AT_PHNUM */
+    }
+    AUX(6, GUEST_PAGE);                     /* AT_PAGESZ */
+    AUX(9, entry);                          /* AT_ENTRY */
+    AUX(11, 0);                             /* AT_UID */
+    AUX(12, 0);                             /* AT_EUID */
+    AUX(13, 0);                             /* AT_GID */
+    AUX(14, 0);                             /* AT_EGID */
+    AUX(15, platform_address);              /* AT_PLATFORM */
+    AUX(16, 0);                             /* AT_HWCAP */
+    AUX(23, 0);                             /* AT_SECURE */
+    AUX(25, random_address);                /* AT_RANDOM */
+    AUX(0, 0);                              /* AT_NULL */
+#undef AUX
+
+    sp = (random_address - 8 * n) & ~15ULL;
+    copy_to_guest(sp, vector, 8 * n);
+    CURRENT_STATE.SP = sp;
+}
+
+
+/**
+ * Ejecuta la llamada al sistema pedida por SVC #0.
+ */
+void syscall_handle() {
+    int64_t *x = CURRENT_STATE.REGS;
+    uint64_t number = x[8];
+    int64_t result;
+
+    if (SYSCALLS_RECORDING && host_dependent(number)) {
+        int64_t i = find_record(INSTRUCTION_COUNT);
+
+        /* la misma llamada de la historia: el resultado original, sin el host */
+        if (SYSCALLS_REPLAYING && i >= 0 && LOG[i].number == number) {
+            if (LOG[i].length)
+                copy_to_guest(LOG[i].address, LOG_BYTES + LOG[i].data, LOG[i].length);
+            NEXT_STATE.REGS[0] = LOG[i].result;
+            return;
+        }
+        truncate_log(INSTRUCTION_COUNT);
+        RECORDING = begin_record(number);
+    }
+
+    switch (number) {
+    case SYS_READ:          result = sys_read(x[0], x[1], x[2]); break;
+    case SYS_WRITE:         result = sys_write(x[0], x[1], x[2]); break;
+    case SYS_WRITEV:        result = sys_writev(x[0], x[1], x[2]); break;
+    case SYS_EXIT:
+    case SYS_EXIT_GROUP:    sys_exit(x[0]); return;
+    case SYS_CLOCK_GETTIME: result = sys_clock_gettime(x[0], x[1]); break;
+    case SYS_BRK:           result = sys_brk(x[0]); break;
+    case SYS_MUNMAP:        result = sys_munmap(x[0], x[1]); break;
+    case SYS_MMAP:          result = sys_mmap(x[0], x[1], x[3], x[4]); break;
+    case SYS_GETRANDOM:     result = sys_getrandom(x[0], x[1]); break;
+    default:
+        if (!SYSCALLS_REPLAYING && (number >= sizeof(WARNED) || !WARNED[number])) {
+            if (number < sizeof(WARNED))
+                WARNED[number] = TRUE;
+            syscall_flush();
+            printf("Warning: unsupported syscall %" PRIu64 " at PC 0x%" PRIx64 "\n",
+                   number, CURRENT_STATE.PC);
+        }
+        result = -E_NOSYS;
+    }
+    NEXT_STATE.REGS[0] = result;
+    if (RECORDING >= 0) {
+        LOG[RECORDING].result = result;
+        RECORDING = -1;
+    }
+}
+
+
+/**
+ * Escribe la salida del programa que quedo en el buffer.
+ */
+void syscall_flush() {
+    if (OUTPUT_USED == 0)
+        return;
+    fflush(stdout);
+    write_all(1, OUTPUT, OUTPUT_USED);
+    OUTPUT_USED = 0;
+}
+
+
+/**
+ * El shell acaba de leer un comando: si el programa lee de la entrada,
+ * empieza en la linea siguiente.
+ */
+void syscall_shell_command() {
+    COMMAND_LINE_PENDING = TRUE;
+}
@@ -0,0 +1,37 @@
+/***************************************************************/
+/*                                                             */
+/*   Emulacion de llamadas al sistema de Linux (SVC #0)        */
+/*                                                             */
+/***************************************************************/
+
+#ifndef _SIM_SYSCALLS_H_
+#define _SIM_SYSCALLS_H_
+
+#include <inttypes.h>
+
+#define SYSCALL_MAX_MAPPINGS 32
+
+/* Estado del "sistema operativo" que no esta en CPU_State ni en memoria. */
+typedef struct {
+    uint64_t brk_start, brk;        /* comienzo y fin actual del heap */
+    uint64_t mmap_top;              /* comienzo de la asignacion de mmap mas baja */
+    uint64_t random_state;          /* generador de getrandom */
+    int32_t exited, exit_code;
+    int32_t nmappings;              /* asignaciones de mmap, ordenadas por direccion */
+    struct {
+        uint64_t start, end;
+    } mappings[SYSCALL_MAX_MAPPINGS];
+} syscall_state_t;
+
+extern syscall_state_t SYSCALL_STATE;
+extern int SYSCALLS_RECORDING;      /* guardar los resultados que dependen del host */
+extern int SYSCALLS_REPLAYING;      /* la re-ejecucion los toma de lo guardado */
+
+void syscall_reset(uint64_t data_end);
+void syscall_log_clear();
+void syscall_setup_process(const char *name, uint64_t entry, uint64_t phdr, uint64_t phnum);
+void syscall_handle();
+void syscall_flush();
+void syscall_shell_command();
+
+#endif
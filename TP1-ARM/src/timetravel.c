@@ -0,0 +1,368 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "shell.h"
+#include "sim.h"
+#include "dirty.h"
+#include "timetravel.h"
+#include "syscalls.h"
+#include "fpu.h"
+
+/*
+ * Historia de la ejecucion para ir a cualquier instruccion anterior.
+ *
+ * Cada `interval` instrucciones se toma un snapshot: el estado de la CPU
+ * y una copia de las paginas escritas desde el snapshot anterior (segun
+ * dirty.c). Cada pagina guarda su lista de versiones ordenada por id de
+ * snapshot, asi el contenido de la pagina en el snapshot s es la ultima
+ * version con id <= s (busqueda binaria). Las paginas en cero no ocupan
+ * memoria (data == NULL).
+ *
+ * Ir a la instruccion k restaura el ultimo snapshot anterior a k y
+ * re-ejecuta hasta k, lo que cuesta a lo sumo `interval` instrucciones
+ * mas la copia de las paginas que difieren. Cuando la historia llega a
+ * MAX_SNAPSHOTS se descarta un snapshot de cada dos y se duplica el
+ * intervalo: la memoria queda acotada y el costo de un salto crece solo
+ * con el logaritmo de la longitud de la ejecucion.
+ */
+
+#define MAX_SNAPSHOTS 4096
+
+typedef struct {
+    uint32_t id;
+    int run_bit;
+    uint64_t instruction_count;
+    CPU_State state;
+    syscall_state_t os;
+} snapshot_t;
+
+typedef struct {
+    uint32_t id;
+    uint8_t *data;              /* NULL = pagina en cero */
+} version_t;
+
+typedef struct {
+    version_t *versions;
+    int count, capacity;
+} page_history_t;
+
+int TIMETRAVEL_ENABLED = FALSE;
+int (*TIMETRAVEL_STOP_CONDITION)() = NULL;
+
+static snapshot_t *SNAPSHOTS;
+static int NSNAPSHOTS;
+static uint32_t NEXT_ID;
+static uint32_t EPOCH;          /* epoca del ultimo snapshot */
+static uint64_t INTERVAL;
+static page_history_t *PAGES[MEM_NREGIONS];
+static uint64_t STORED_PAGES;
+
+
+static uint8_t *page_address(int region, uint64_t page) {
+    return MEM_REGIONS[region].mem + (page << DIRTY_PAGE_SHIFT);
+}
+
+static int page_equals(const uint8_t *data, const uint8_t *current) {
+    static const uint8_t ZERO[DIRTY_PAGE_SIZE];
+    return memcmp(data ? data : ZERO, current, DIRTY_PAGE_SIZE) == 0;
+}
+
+/* Indice de la ultima version con id <= id, o -1. */
+static int find_version(page_history_t *h, uint32_t id) {
+    int low = 0, high = h->count - 1, found = -1;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        if (h->versions[middle].id <= id) {
+            found = middle;
+            low = middle + 1;
+        } else
+            high = middle - 1;
+    }
+    return found;
+}
+
+static void add_version(page_history_t *h, uint32_t id, const uint8_t *current) {
+    version_t *v;
+    static const uint8_t ZERO[DIRTY_PAGE_SIZE];
+
+    if (h->count > 0 && page_equals(h->versions[h->count - 1].data, current))
+        return;
+    if (h->count == h->capacity) {
+        h->capacity = h->capacity ? 2 * h->capacity : 4;
+        h->versions = realloc(h->versions, h->capacity * sizeof(version_t));
+    }
+    v = &h->versions[h->count++];
+    v->id = id;
+    v->data = NULL;
+    if (memcmp(current, ZERO, DIRTY_PAGE_SIZE) != 0) {
+        v->data = malloc(DIRTY_PAGE_SIZE);
+        memcpy(v->data, current, DIRTY_PAGE_SIZE);
+        STORED_PAGES++;
+    }
+}
+
+static void drop_version(version_t *v) {
+    if (v->data) {
+        free(v->data);
+        STORED_PAGES--;
+    }
+}
+
+/**
+ * Toma un snapshot. El primero copia todas las paginas; los siguientes,
+ * solo las escritas desde el anterior.
+ */
+static void take_snapshot() {
+    snapshot_t *s = &SNAPSHOTS[NSNAPSHOTS++];
+    uint32_t since = EPOCH;
+
+    s->id = NEXT_ID++;
+    s->run_bit = RUN_BIT;
+    s->instruction_count = INSTRUCTION_COUNT;
+    fpu_flush();
+    s->state = CURRENT_STATE;
+    s->os = SYSCALL_STATE;
+    EPOCH = dirty_advance();
+
+    for (int r = 0; r < MEM_NREGIONS; r++)
+        for (uint64_t p = 0; p < dirty_pages(r); p++)
+            if (NSNAPSHOTS == 1 || dirty_since(r, p, since))
+                add_version(&PAGES[r][p], s->id, page_address(r, p));
+}
+
+/**
+ * Descarta los snapshots en posiciones impares (salvo el ultimo). Una
+ * version de un snapshot descartado pasa al siguiente, salvo que ese ya
+ * tenga la suya.
+ */
+static void thin_snapshots() {
+    int kept = 0;
+
+    for (int r = 0; r < MEM_NREGIONS; r++) {
+        for (uint64_t p = 0; p < dirty_pages(r); p++) {
+            page_history_t *h = &PAGES[r][p];
+            int out = 0, position = 0;
+            for (int v = 0; v < h->count; v++) {
+                while (SNAPSHOTS[position].id < h->versions[v].id)
+                    position++;
+                if (position % 2 == 1 && position + 1 < NSNAPSHOTS) {
+                    if (v + 1 < h->count && h->versions[v + 1].id == SNAPSHOTS[position + 1].id) {
+                        drop_version(&h->versions[v]);
+                        continue;
+                    }
+                    h->versions[v].id = SNAPSHOTS[position + 1].id;
+                }
+                h->versions[out++] = h->versions[v];
+            }
+            h->count = out;
+        }
+    }
+    for (int i = 0; i < NSNAPSHOTS; i++)
+        if (i % 2 == 0 || i + 1 == NSNAPSHOTS)
+            SNAPSHOTS[kept++] = SNAPSHOTS[i];
+    NSNAPSHOTS = kept;
+    INTERVAL *= 2;
+}
+
+/**
+ * Vuelve al snapshot en la posicion dada y descarta los posteriores (la
+ * re-ejecucion los vuelve a tomar).
+ */
+static void restore_snapshot(int position) {
+    snapshot_t *s = &SNAPSHOTS[position];
+    int text_changed = FALSE;
+
+    for (int r = 0; r < MEM_NREGIONS; r++) {
+        for (uint64_t p = 0; p < dirty_pages(r); p++) {
+            page_history_t *h = &PAGES[r][p];
+            int v = find_version(h, s->id);
+            /* sin versiones posteriores ni escrituras, la pagina ya es la del snapshot */
+            if (v == h->count - 1 && !dirty_since(r, p, EPOCH))
+                continue;
+            if (h->versions[v].data)
+                memcpy(page_address(r, p), h->versions[v].data, DIRTY_PAGE_SIZE);
+            else
+                memset(page_address(r, p), 0, DIRTY_PAGE_SIZE);
+            dirty_touch(r, p);
+            while (h->count > v + 1)
+                drop_version(&h->versions[--h->count]);
+            if (MEM_REGIONS[r].start == MEM_TEXT_START)
+                text_changed = TRUE;
+        }
+    }
+    if (text_changed)
+        predecode_reset();
+
+    CURRENT_STATE = NEXT_STATE = s->state;
+    fpu_resume();
+    SYSCALL_STATE = s->os;
+    INSTRUCTION_COUNT = s->instruction_count;
+    RUN_BIT = s->run_bit;
+    NSNAPSHOTS = position + 1;
+    EPOCH = dirty_advance();
+}
+
+/* Ultimo snapshot tomado en la instruccion `count` o antes. */
+static int find_snapshot(uint64_t count) {
+    int low = 0, high = NSNAPSHOTS - 1, found = 0;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        if (SNAPSHOTS[middle].instruction_count <= count) {
+            found = middle;
+            low = middle + 1;
+        } else
+            high = middle - 1;
+    }
+    return found;
+}
+
+/* Re-ejecuta sin analizadores ni mensajes, hasta `target` o HLT. */
+static void replay(uint64_t target) {
+    SYSCALLS_REPLAYING = TRUE;
+    fpu_resume();
+    while (INSTRUCTION_COUNT < target && RUN_BIT) {
+        process_instruction_fast();
+        commit_state();
+        INSTRUCTION_COUNT++;
+        timetravel_tick();
+    }
+    fpu_suspend();
+    SYSCALLS_REPLAYING = FALSE;
+}
+
+static void free_history() {
+    for (int r = 0; r < MEM_NREGIONS; r++) {
+        if (PAGES[r] == NULL) continue;
+        for (uint64_t p = 0; p < dirty_pages(r); p++) {
+            for (int v = 0; v < PAGES[r][p].count; v++)
+                drop_version(&PAGES[r][p].versions[v]);
+            free(PAGES[r][p].versions);
+        }
+        free(PAGES[r]);
+        PAGES[r] = NULL;
+    }
+    free(SNAPSHOTS);
+    SNAPSHOTS = NULL;
+    NSNAPSHOTS = 0;
+}
+
+
+/**
+ * Empieza a grabar la historia desde el estado actual.
+ *
+ * Params: interval (uint64_t): Instrucciones entre snapshots (>= 1).
+ */
+void timetravel_start(uint64_t interval) {
+    if (TIMETRAVEL_ENABLED)
+        timetravel_stop();
+    dirty_acquire();
+    SNAPSHOTS = malloc(MAX_SNAPSHOTS * sizeof(snapshot_t));
+    for (int r = 0; r < MEM_NREGIONS; r++)
+        PAGES[r] = calloc(dirty_pages(r), sizeof(page_history_t));
+    NEXT_ID = 0;
+    INTERVAL = interval;
+    take_snapshot();
+    syscall_log_clear();
+    SYSCALLS_RECORDING = TRUE;
+    TIMETRAVEL_ENABLED = TRUE;
+}
+
+
+/**
+ * Deja de grabar y libera la historia.
+ */
+void timetravel_stop() {
+    if (!TIMETRAVEL_ENABLED)
+        return;
+    TIMETRAVEL_ENABLED = FALSE;
+    SYSCALLS_RECORDING = FALSE;
+    syscall_log_clear();
+    free_history();
+    dirty_release();
+}
+
+
+/**
+ * Fin de ciclo: toma un snapshot cada INTERVAL instrucciones.
+ */
+void timetravel_tick() {
+    if (INSTRUCTION_COUNT - SNAPSHOTS[NSNAPSHOTS - 1].instruction_count < INTERVAL)
+        return;
+    if (NSNAPSHOTS == MAX_SNAPSHOTS)
+        thin_snapshots();
+    take_snapshot();
+}
+
+
+/**
+ * Lleva la maquina al estado previo a ejecutar la instruccion `target`
+ * (contando desde 0), hacia atras o hacia adelante.
+ *
+ * Params: target (uint64_t): Valor de INSTRUCTION_COUNT buscado.
+ *
+ * Returns: int: TRUE si se llego; FALSE si es anterior a la historia o
+ *               el programa termina antes.
+ */
+int timetravel_goto(uint64_t target) {
+    if (target < SNAPSHOTS[0].instruction_count) {
+        printf("Instruction %" PRIu64 " is before the start of the history (%" PRIu64 ")\n",
+               target, SNAPSHOTS[0].instruction_count);
+        return FALSE;
+    }
+    if (target < INSTRUCTION_COUNT)
+        restore_snapshot(find_snapshot(target));
+    replay(target);
+    return INSTRUCTION_COUNT == target;
+}
+
+
+/**
+ * Retrocede hasta la ultima instruccion anterior a la actual en la que
+ * se cumple TIMETRAVEL_STOP_CONDITION, o hasta el inicio de la historia.
+ *
+ * Returns: int: TRUE si se detuvo por la condicion.
+ */
+int timetravel_reverse_continue() {
+    uint64_t end = INSTRUCTION_COUNT;
+
+    while (TIMETRAVEL_STOP_CONDITION && end > SNAPSHOTS[0].instruction_count) {
+        uint64_t found = end;
+        restore_snapshot(find_snapshot(end - 1));
+        SYSCALLS_REPLAYING = TRUE;
+        while (INSTRUCTION_COUNT < end && RUN_BIT) {
+            if (TIMETRAVEL_STOP_CONDITION())
+                found = INSTRUCTION_COUNT;
+            process_instruction_fast();
+            commit_state();
+            INSTRUCTION_COUNT++;
+            timetravel_tick();
+        }
+        fpu_suspend();
+        SYSCALLS_REPLAYING = FALSE;
+        if (found != end)
+            return timetravel_goto(found);
+        end = SNAPSHOTS[find_snapshot(end - 1)].instruction_count;
+    }
+    timetravel_goto(SNAPSHOTS[0].instruction_count);
+    return FALSE;
+}
+
+
+/**
+ * Imprime el estado de la historia grabada.
+ *
+ * Params: out (FILE *): Archivo de salida.
+ */
+void timetravel_report(FILE *out) {
+    fprintf(out, "\nExecution history :\n");
+    fprintf(out, "-------------------------------------\n");
+    if (!TIMETRAVEL_ENABLED) {
+        fprintf(out, "not recording\n\n");
+        return;
+    }
+    fprintf(out, "Instructions        : %" PRIu64 " .. %" PRIu64 "\n",
+            SNAPSHOTS[0].instruction_count, INSTRUCTION_COUNT);
+    fprintf(out, "Snapshots           : %d (every %" PRIu64 " instructions)\n", NSNAPSHOTS, INTERVAL);
+    fprintf(out, "Stored pages        : %" PRIu64 " (%" PRIu64 " KB)\n\n",
+            STORED_PAGES, STORED_PAGES * DIRTY_PAGE_SIZE / 1024);
+}
@@ -0,0 +1,26 @@
+/***************************************************************/
+/*                                                             */
+/*   Ejecucion reversa: snapshots periodicos y re-ejecucion    */
+/*                                                             */
+/***************************************************************/
+
+#ifndef _SIM_TIMETRAVEL_H_
+#define _SIM_TIMETRAVEL_H_
+
+#include <stdio.h>
+#include <inttypes.h>
+
+extern int TIMETRAVEL_ENABLED;
+
+/* Condicion de parada de reverse-continue, evaluada antes de cada
+ * instruccion re-ejecutada. NULL: retroceder hasta el inicio. */
+extern int (*TIMETRAVEL_STOP_CONDITION)();
+
+void timetravel_start(uint64_t interval);
+void timetravel_stop();
+void timetravel_tick();
+int  timetravel_goto(uint64_t target);
+int  timetravel_reverse_continue();
+void timetravel_report(FILE *out);
+
+#endif
@@ -0,0 +1,246 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "shell.h"
+#include "sim.h"
+#include "timing.h"
+
+/*
+ * Modelo de tiempos para las ventanas detalladas.
+ *
+ * Pipeline escalar en orden de 5 etapas: una instruccion por ciclo mas
+ *   - burbujas por dependencia con la instruccion anterior (load-use, MUL,
+ *     DIV y punto flotante),
+ *   - penalidad por salto mal predicho (se resuelve en EX),
+ *   - penalidad por fallo en la cache de instrucciones o de datos.
+ * Caches L1I y L1D asociativas por conjuntos con reemplazo LRU y
+ * write-allocate. Predictor bimodal de contadores de 2 bits y un BTB de
+ * destino unico para los saltos indirectos (BR).
+ *
+ * El estado de las caches y del predictor se conserva entre ventanas:
+ * la fase de calentamiento de cada ventana lo actualiza sin medir.
+ */
+
+#define LINE_SHIFT          6
+#define L1I_SETS            128     /* 32KB, 4 vias */
+#define L1I_WAYS            4
+#define L1D_SETS            64      /* 32KB, 8 vias */
+#define L1D_WAYS            8
+#define PREDICTOR_ENTRIES   4096
+#define BTB_ENTRIES         256
+
+#define MISS_PENALTY        20
+#define MISPREDICT_PENALTY  2
+#define LOAD_USE_PENALTY    1
+#define MUL_PENALTY         2
+#define DIV_PENALTY         10
+#define FP_PENALTY          3
+
+typedef struct {
+    int sets, ways;
+    uint64_t *tags;         /* linea + 1 (0 = invalida) */
+    uint64_t *last_use;
+    uint64_t clock;
+    uint64_t accesses, misses;
+} cache_t;
+
+int TIMING_ENABLED = FALSE;
+
+static int MEASURING;
+static cache_t L1I, L1D;
+static uint8_t COUNTERS[PREDICTOR_ENTRIES];
+static uint64_t BTB[BTB_ENTRIES];
+
+/* instruccion anterior en el pipeline */
+static int PREV_DESTS[EFFECT_MAX_REGISTERS];   /* registros destino */
+static int PREV_NDESTS;
+static int PREV_PENALTY;            /* burbujas si la siguiente lo usa */
+
+static uint64_t PENDING_CYCLES;     /* fallos de datos de la instruccion en curso */
+static uint64_t CYCLES, INSTRUCTIONS;
+static uint64_t BRANCHES, MISPREDICTS, STALLS;
+
+
+static void cache_init(cache_t *c, int sets, int ways) {
+    free(c->tags);
+    free(c->last_use);
+    memset(c, 0, sizeof(*c));
+    c->sets = sets;
+    c->ways = ways;
+    c->tags = calloc(sets * ways, sizeof(uint64_t));
+    c->last_use = calloc(sets * ways, sizeof(uint64_t));
+}
+
+/**
+ * Accede a una linea de la cache.
+ *
+ * Returns: int: TRUE si fue un fallo.
+ */
+static int cache_access(cache_t *c, uint64_t address) {
+    uint64_t line = address >> LINE_SHIFT;
+    uint64_t *tags = c->tags + (line % c->sets) * c->ways;
+    uint64_t *last_use = c->last_use + (line % c->sets) * c->ways;
+    int victim = 0;
+
+    c->clock++;
+    if (MEASURING) c->accesses++;
+    for (int w = 0; w < c->ways; w++) {
+        if (tags[w] == line + 1) {
+            last_use[w] = c->clock;
+            return FALSE;
+        }
+        if (last_use[w] < last_use[victim])
+            victim = w;
+    }
+    if (MEASURING) c->misses++;
+    tags[victim] = line + 1;
+    last_use[victim] = c->clock;
+    return TRUE;
+}
+
+/**
+ * Returns: int: TRUE si la instruccion lee algun destino de la anterior.
+ */
+static int reads_previous(uint32_t instruction, uint32_t effects) {
+    int regs[EFFECT_MAX_REGISTERS];
+    int n = effect_sources(instruction, effects, regs);
+
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < PREV_NDESTS; j++)
+            if (regs[i] == PREV_DESTS[j])
+                return TRUE;
+    return FALSE;
+}
+
+/**
+ * Predice y entrena el salto de la instruccion.
+ *
+ * Returns: int: TRUE si la prediccion fue incorrecta.
+ */
+static int predict_branch(uint64_t pc, uint32_t effects, uint64_t next_pc) {
+    int taken = next_pc != pc + 4;
+
+    if (!(effects & EFFECT_BRANCH))
+        return FALSE;
+    if (MEASURING) BRANCHES++;
+
+    if (effects & EFFECT_READS_FLAGS || effects & EFFECT_READS_RD) {
+        /* condicional: bimodal */
+        uint8_t *counter = &COUNTERS[(pc >> 2) % PREDICTOR_ENTRIES];
+        int predicted = *counter >= 2;
+        if (taken && *counter < 3) (*counter)++;
+        if (!taken && *counter > 0) (*counter)--;
+        return predicted != taken;
+    }
+    if (effects & EFFECT_READS_RN) {
+        /* indirecto: ultimo destino visto */
+        uint64_t *target = &BTB[(pc >> 2) % BTB_ENTRIES];
+        int hit = *target == next_pc;
+        *target = next_pc;
+        return !hit;
+    }
+    return FALSE;   /* B: destino conocido en decode */
+}
+
+
+/**
+ * Vacia caches, predictor y estadisticas.
+ */
+void timing_reset() {
+    cache_init(&L1I, L1I_SETS, L1I_WAYS);
+    cache_init(&L1D, L1D_SETS, L1D_WAYS);
+    memset(COUNTERS, 1, sizeof(COUNTERS));
+    memset(BTB, 0, sizeof(BTB));
+    PREV_NDESTS = 0;
+    PREV_PENALTY = 0;
+    PENDING_CYCLES = 0;
+    CYCLES = INSTRUCTIONS = 0;
+    BRANCHES = MISPREDICTS = STALLS = 0;
+    MEASURING = FALSE;
+}
+
+
+/**
+ * Activa o desactiva la medicion. Sin medir, el modelo solo se calienta.
+ *
+ * Params: measuring (int): TRUE para acumular ciclos y estadisticas.
+ */
+void timing_set_measuring(int measuring) {
+    MEASURING = measuring;
+}
+
+
+/**
+ * Acceso a datos de la instruccion en curso. Lecturas y escrituras se
+ * tratan igual: la L1D asigna linea en ambos casos.
+ *
+ * Params: address (uint64_t): Direccion accedida.
+ */
+void timing_mem_access(uint64_t address) {
+    if (cache_access(&L1D, address))
+        PENDING_CYCLES += MISS_PENALTY;
+}
+
+
+/**
+ * Cuenta los ciclos de una instruccion ya ejecutada.
+ *
+ * Params: pc (uint64_t): PC de la instruccion.
+ *         instruction (uint32_t): Instruccion codificada en 32 bits.
+ *         effects (uint32_t): Efectos EFFECT_* de la instruccion.
+ *         next_pc (uint64_t): PC de la siguiente instruccion ejecutada.
+ */
+void timing_instruction(uint64_t pc, uint32_t instruction, uint32_t effects, uint64_t next_pc) {
+    uint64_t cycles = 1 + PENDING_CYCLES;
+
+    if (cache_access(&L1I, pc))
+        cycles += MISS_PENALTY;
+    if (PREV_PENALTY > 0 && reads_previous(instruction, effects)) {
+        cycles += PREV_PENALTY;
+        if (MEASURING) STALLS += PREV_PENALTY;
+    }
+    if (predict_branch(pc, effects, next_pc)) {
+        cycles += MISPREDICT_PENALTY;
+        if (MEASURING) MISPREDICTS++;
+    }
+
+    /* la base de un writeback sale de una suma: no genera burbujas */
+    PREV_NDESTS = effect_destinations(instruction, effects, PREV_DESTS);
+    PREV_PENALTY = 0;
+    if (effects & EFFECT_LOAD) PREV_PENALTY = LOAD_USE_PENALTY;
+    if (effects & EFFECT_FP) PREV_PENALTY = FP_PENALTY;
+    if (effects & EFFECT_MULTIPLY) PREV_PENALTY = MUL_PENALTY;
+    if (effects & EFFECT_DIVIDE) PREV_PENALTY = DIV_PENALTY;
+    PENDING_CYCLES = 0;
+
+    if (MEASURING) {
+        CYCLES += cycles;
+        INSTRUCTIONS++;
+    }
+}
+
+
+/**
+ * Returns: uint64_t: Ciclos acumulados mientras se midio.
+ */
+uint64_t timing_cycles() {
+    return CYCLES;
+}
+
+
+/**
+ * Imprime las estadisticas de las ventanas medidas.
+ *
+ * Params: out (FILE *): Archivo de salida.
+ */
+void timing_report(FILE *out) {
+    fprintf(out, "Measured instructions : %" PRIu64 "\n", INSTRUCTIONS);
+    fprintf(out, "Measured cycles       : %" PRIu64 "\n", CYCLES);
+    fprintf(out, "L1I miss rate         : %.4f (%" PRIu64 "/%" PRIu64 ")\n",
+            L1I.accesses ? (double)L1I.misses / L1I.accesses : 0.0, L1I.misses, L1I.accesses);
+    fprintf(out, "L1D miss rate         : %.4f (%" PRIu64 "/%" PRIu64 ")\n",
+            L1D.accesses ? (double)L1D.misses / L1D.accesses : 0.0, L1D.misses, L1D.accesses);
+    fprintf(out, "Branch mispredicts    : %.4f (%" PRIu64 "/%" PRIu64 ")\n",
+            BRANCHES ? (double)MISPREDICTS / BRANCHES : 0.0, MISPREDICTS, BRANCHES);
+    fprintf(out, "Dependency stalls     : %" PRIu64 "\n", STALLS);
+}
@@ -0,0 +1,22 @@
+/***************************************************************/
+/*                                                             */
+/*   Modelo de tiempos: pipeline en orden, caches y predictor  */
+/*                                                             */
+/***************************************************************/
+
+#ifndef _SIM_TIMING_H_
+#define _SIM_TIMING_H_
+
+#include <stdio.h>
+#include <inttypes.h>
+
+extern int TIMING_ENABLED;
+
+void     timing_reset();
+void     timing_set_measuring(int measuring);
+void     timing_mem_access(uint64_t address);
+void     timing_instruction(uint64_t pc, uint32_t instruction, uint32_t effects, uint64_t next_pc);
+uint64_t timing_cycles();
+void     timing_report(FILE *out);
+
+#endif
@@ -0,0 +1,5 @@
+callgraph on
+go
+callgraph report
+callgraph dump callgraph.out
+quit
@@ -0,0 +1,19 @@
+.text
+.globl _start
+_start:
+  mov x0, #3
+  bl rec
+  bl leaf
+  hlt #0
+rec:
+  stp x29, x30, [sp, #-16]!
+  cbz x0, 1f
+  sub x0, x0, #1
+  bl rec
+  bl leaf
+1:
+  ldp x29, x30, [sp], #16
+  ret
+leaf:
+  add x1, x1, #1
+  ret
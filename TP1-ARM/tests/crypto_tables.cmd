@@ -0,0 +1,4 @@
+save resume.ckpt
+go
+rdump
+quit
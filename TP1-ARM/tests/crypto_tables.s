@@ -0,0 +1,36 @@
+.arch armv8-a+crc+crypto
+.text
+.globl _start
+_start:
+movz w1, 0x1234
+movz w2, 0
+crc32w w9, w2, w1
+crc32cw w10, w2, w1
+movz x3, 0xcdef
+movk x3, 0x89ab, lsl 16
+movk x3, 0x4567, lsl 32
+movk x3, 0x0123, lsl 48
+movn w4, 0
+crc32x w11, w4, x3
+crc32cx w12, w4, x3
+movz x5, 0x3d19
+movk x5, 0xbee3, lsl 16
+movk x5, 0xf4a0, lsl 32
+movk x5, 0x2be2, lsl 48
+movz x6, 0xc69a
+movk x6, 0x2a8d, lsl 16
+movk x6, 0xf8e9, lsl 32
+movk x6, 0x0848, lsl 48
+mov v0.d[0], x5
+mov v0.d[1], x6
+mov v1.d[0], xzr
+mov v1.d[1], xzr
+aese v0.16b, v1.16b
+aesmc v0.16b, v0.16b
+umov x13, v0.d[0]
+umov x14, v0.d[1]
+aesimc v0.16b, v0.16b
+aesd v0.16b, v1.16b
+umov x15, v0.d[0]
+umov x16, v0.d[1]
+hlt 0
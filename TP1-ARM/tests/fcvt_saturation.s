@@ -0,0 +1,25 @@
+.text
+movz x0, 0x7e37, lsl 48
+fmov d0, x0
+fcvtzs x1, d0
+fneg d1, d0
+fcvtzs x2, d1
+fcvtzu x3, d1
+fcvtzu x4, d0
+movz x5, 0x41e6, lsl 48
+fmov d5, x5
+fcvtzs w5, d5
+fcvtzu w6, d5
+movz x7, 0x7ff8, lsl 48
+fmov d7, x7
+fcvtzs x7, d7
+fcvtzu w8, d7
+fmov d9, -2.5
+fcvtzs w9, d9
+fcvtas x10, d9
+fcvtms x11, d9
+fcvtps x12, d9
+fcvtns x13, d9
+fcvtzu x14, d9
+mrs x15, fpsr
+hlt 0
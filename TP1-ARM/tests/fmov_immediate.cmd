@@ -0,0 +1,3 @@
+go
+rdump
+quit
@@ -0,0 +1,22 @@
+.text
+fmov d0, 1.0
+fmov x0, d0
+fmov d1, -2.5
+fmov x1, d1
+fmov d2, 0.125
+fmov x2, d2
+fmov d3, 31.0
+fmov x3, d3
+fmov d4, -0.1875
+fmov x4, d4
+fmov s5, 1.0
+fmov w5, s5
+fmov s6, -31.0
+fmov w6, s6
+fmov s7, 0.125
+fmov w7, s7
+fmov s8, 1.9375
+fmov w8, s8
+fmov d9, 16.0
+fmov x9, d9
+hlt 0
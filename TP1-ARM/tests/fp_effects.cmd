@@ -0,0 +1,4 @@
+ilp on
+go
+ilp report
+quit
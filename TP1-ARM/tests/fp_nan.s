@@ -0,0 +1,33 @@
+.text
+movz x0, 0x7ff0, lsl 48
+movk x0, 0x1234
+fmov d0, x0
+movz x1, 0x7ff8, lsl 48
+movk x1, 0x5678
+fmov d1, x1
+fmov d2, 1.0
+fadd d3, d1, d2
+fmov x3, d3
+fadd d4, d2, d0
+fmov x4, d4
+fmul d5, d1, d0
+fmov x5, d5
+fmaxnm d6, d1, d2
+fmov x6, d6
+fmax d7, d2, d1
+fmov x7, d7
+movz w8, 0x7f80, lsl 16
+movk w8, 0x0042
+fmov s8, w8
+fsub s9, s8, s8
+fmov w9, s9
+mrs x10, fpsr
+movz x11, 0x0200, lsl 16
+msr fpcr, x11
+fadd d12, d1, d2
+fmov x12, d12
+fsqrt d13, d13
+fmov d14, -1.0
+fsqrt d14, d14
+fmov x14, d14
+hlt 0
@@ -0,0 +1,2 @@
+sample 11 0 10
+quit
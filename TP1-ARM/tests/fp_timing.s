@@ -0,0 +1,12 @@
+.text
+fmov d0, 1.0
+fmov d1, 2.0
+fdiv d2, d0, d1
+fmadd d3, d2, d2, d0
+fcvtzs x4, d3
+add x5, x4, 1
+scvtf d6, x5
+msr fpcr, x5
+mrs x7, fpcr
+add x8, x7, 1
+hlt 0
@@ -0,0 +1,11 @@
+save start.ckpt
+sample 1000000 0 1
+rdump
+mdump 0x10000000 0x10000010
+restore start.ckpt
+go
+rdump
+mdump 0x10000000 0x10000010
+restore start.ckpt
+sample 1000000 0 1
+quit
@@ -0,0 +1,20 @@
+.text
+movz x1, 0x1000, lsl 16
+movz x2, 50
+movz x5, 0
+loop:
+movz x3, 0
+inner:
+add x4, x1, x3
+ldur x6, [x4, 0]
+add x6, x6, 1
+stur x6, [x4, 0]
+add x3, x3, 64
+cmp x3, 1024
+b.lt inner
+movz x7, 0x1234
+movk x7, 0x5678, lsl 16
+add x5, x5, x7
+subs x2, x2, 1
+cbnz x2, loop
+hlt 0
@@ -0,0 +1,13 @@
+.text
+movz x0, 0x1000, lsl 16
+ldr x1, [x0]
+bl next
+next:
+add x2, x30, 1
+add x2, x2, 1
+add x2, x2, 1
+add x2, x2, 1
+add x2, x2, 1
+add x2, x2, 1
+add x2, x2, 1
+hlt 0
@@ -0,0 +1,4 @@
+go
+rdump
+mdump 0x10000000 0x10000048
+quit
@@ -0,0 +1,17 @@
+.text
+movz x0, 0x1000, lsl 16
+movz x1, 0x1111
+movz x2, 0x2222
+stp x1, x2, [x0]
+stp x2, x1, [x0, 16]!
+stnp x1, x2, [x0, 16]
+ldnp x3, x4, [x0, 16]
+ldp x5, x6, [x0], 16
+sttr x6, [x0, 8]
+ldtr x7, [x0, 8]
+ldr x8, [x0, -8]!
+ldr x9, [x0], 8
+movn w12, 0
+stp w12, w2, [x0, 32]
+ldpsw x10, x11, [x0, 32]
+hlt 0
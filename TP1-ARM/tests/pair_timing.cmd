@@ -0,0 +1,2 @@
+sample 13 0 12
+quit
@@ -0,0 +1,14 @@
+.text
+movz x0, 0x1000, lsl 16
+ldp x1, x2, [x0]
+add x3, x2, 1
+add x3, x3, 1
+ldr x4, [x0, 8]!
+add x5, x0, 1
+add x5, x5, 1
+add x5, x5, 1
+add x5, x5, 1
+add x5, x5, 1
+add x5, x5, 1
+add x5, x5, 1
+hlt 0
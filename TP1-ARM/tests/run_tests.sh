@@ -0,0 +1,80 @@
+#!/bin/sh
+#
+# Pruebas de regresion del simulador. Cada prueba es un programa NAME.s,
+# los comandos del shell NAME.cmd y la salida esperada NAME.expected
+# (sin las trazas de decodificacion). Uso: run_tests.sh [sim]
+#
+# Los programas que definen _start se ensamblan como objetos ELF (con
+# simbolos); el resto pasa por asm2hex. Los archivos *.out que escribe la
+# prueba (por ejemplo "callgraph dump") se agregan al final de la salida.
+# Si existe NAME.resume, despues se lanza "sim -r resume.ckpt" (el
+# checkpoint que guardo NAME.cmd) con esos comandos y se agrega su salida.
+#
+# Para regenerar una salida esperada: run_tests.sh -u NAME
+#
+
+UPDATE=
+SIM=
+if [ "$1" = "-u" ]; then
+    UPDATE=$2
+elif [ -n "$1" ]; then
+    SIM=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+fi
+
+cd "$(dirname "$0")" || exit 1
+TESTS=$(pwd)
+SIM=${SIM:-$TESTS/../src/sim}
+
+WORK=$(mktemp -d) || exit 1
+trap 'rm -rf "$WORK"' EXIT
+
+# sin las trazas de decodificacion ni la ruta del directorio de trabajo
+filter() {
+    grep -v "^Processing instruction\|^Decoding instruction\|^Instruction: \|^Opcodes: \|^Match found" |
+        sed "s|$dir/build/||g"
+}
+
+run_test() {
+    dir=$WORK/$1
+    rm -rf "$dir"
+    mkdir "$dir" "$dir/build"
+    cp "$TESTS/$1.s" "$dir/build/$1.s"
+    if grep -q "^_start:" "$TESTS/$1.s"; then
+        program=$dir/build/$1.o
+        "$TESTS/../aarch64-linux-android-4.9/bin/aarch64-linux-android-as" "$dir/build/$1.s" -o "$program" || return 1
+    else
+        program=$dir/build/$1.x
+        python3 "$TESTS/../inputs/asm2hex" "$dir/build/$1.s" || return 1
+    fi
+    (cd "$dir" && ARM_SIM_CACHE=off timeout 10 "$SIM" "$program" < "$TESTS/$1.cmd" 2>&1) | filter
+    if [ -f "$TESTS/$1.resume" ]; then
+        echo "==> sim -r resume.ckpt <=="
+        (cd "$dir" && ARM_SIM_CACHE=off timeout 10 "$SIM" -r resume.ckpt < "$TESTS/$1.resume" 2>&1) | filter
+    fi
+    for f in "$dir"/*; do
+        if [ -f "$f" ] && [ "${f%.out}" != "$f" ]; then
+            echo "==> $(basename "$f") <=="
+            cat "$f"
+        fi
+    done
+}
+
+if [ -n "$UPDATE" ]; then
+    run_test "$UPDATE" > "$TESTS/$UPDATE.expected"
+    exit $?
+fi
+
+passed=0
+failed=0
+for s in "$TESTS"/*.s; do
+    name=$(basename "$s" .s)
+    if run_test "$name" > "$WORK/$name.out" && diff -u "$TESTS/$name.expected" "$WORK/$name.out" > "$WORK/$name.diff"; then
+        passed=$((passed + 1))
+    else
+        echo "FAIL: $name"
+        cat "$WORK/$name.diff"
+        failed=$((failed + 1))
+    fi
+done
+echo "$passed passed, $failed failed"
+[ "$failed" -eq 0 ]
@@ -0,0 +1,2 @@
+sample 200 20 50
+quit
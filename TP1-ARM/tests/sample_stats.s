@@ -0,0 +1,9 @@
+.text
+movz x0, 2000
+loop:
+mul x4, x2, x2
+add x5, x4, 1
+add x6, x6, 1
+subs x0, x0, 1
+b.ne loop
+hlt 0
@@ -0,0 +1,5 @@
+go
+hello
+world
+rdump
+quit
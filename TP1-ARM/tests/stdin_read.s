@@ -0,0 +1,19 @@
+.text
+movz x9, 0x1000, lsl 16
+movz x10, 2
+loop:
+movz x0, 0
+add x1, x9, 0
+movz x2, 16
+movz x8, 63
+svc 0
+add x2, x0, 0
+movz x0, 1
+add x1, x9, 0
+movz x8, 64
+svc 0
+subs x10, x10, 1
+b.ne loop
+movz x0, 0
+movz x8, 93
+svc 0
@@ -0,0 +1,12 @@
+.text
+movz x0, 0x1000, lsl 16
+ldr q0, [x0]
+add v1.4s, v0.4s, v0.4s
+add v2.4s, v1.4s, v0.4s
+umov w3, v2.s[1]
+add x3, x3, 1
+str q2, [x0, 16]
+ldp q4, q5, [x0], 32
+mul v6.4s, v5.4s, v5.4s
+add x7, x0, 1
+hlt 0
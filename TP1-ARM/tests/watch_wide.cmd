@@ -0,0 +1,5 @@
+watch 0x10000100 0x10000107 rw
+go
+go
+rdump
+quit
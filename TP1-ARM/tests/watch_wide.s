@@ -0,0 +1,7 @@
+.text
+movz x1, 0x1000, lsl 16
+add x1, x1, 0x100
+movz x2, 0x1234
+str x2, [x1]
+ldr x3, [x1]
+hlt 0